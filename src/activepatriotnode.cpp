@@ -277,7 +277,7 @@ OperationResult initPatriotnode(const std::string& _strPatriotNodePrivKey, const
 
     if (patriotnodeSync.IsBlockchainSynced()) {
         // Check if the patriotnode already exists in the list
-        CPatriotnode* pmn = mnodeman.Find(pubkey);
+        PatriotnodeRef pmn = mnodeman.Find(pubkey);
         if (pmn) activePatriotnode.EnableHotColdPatriotNode(pmn->vin, pmn->addr);
     }
 
@@ -299,7 +299,7 @@ void CActivePatriotnode::ManageStatus()
     LogPrint(BCLog::PATRIOTNODE, "CActivePatriotnode::ManageStatus() - Begin\n");
 
     // If a DPN has been registered with same collateral, disable me.
-    CPatriotnode* pmn = mnodeman.Find(pubKeyPatriotnode);
+    PatriotnodeRef pmn = mnodeman.Find(pubKeyPatriotnode);
     if (pmn && deterministicPNManager->GetListAtChainTip().HasPNByCollateral(pmn->vin.prevout)) {
         LogPrintf("%s: Disabling active legacy Patriotnode %s as the collateral is now registered with a DPN\n",
                          __func__, pmn->vin.prevout.ToString());
@@ -411,7 +411,7 @@ bool CActivePatriotnode::SendPatriotnodePing(std::string& errorMessage)
     }
 
     // Update lastPing for our patriotnode in Patriotnode list
-    CPatriotnode* pmn = mnodeman.Find(vin->prevout);
+    PatriotnodeRef pmn = mnodeman.Find(vin->prevout);
     if (pmn != NULL) {
         if (pmn->IsPingedWithin(PatriotnodePingSeconds(), mnp.sigTime)) {
             errorMessage = "Too early to send Patriotnode Ping";
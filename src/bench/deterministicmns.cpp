@@ -0,0 +1,126 @@
+// Copyright (c) 2021 The TrumpCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+
+#include "arith_uint256.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "evo/deterministicmns.h"
+#include "hash.h"
+#include "random.h"
+
+// Payee selection on a deterministic patriotnode list of NUM_PNS nodes, as done
+// for every connected block: pick the next payee and mark it as paid, and
+// project the next payees as getpatriotnodewinners does.
+// Also lookups of the list at random heights of a chain, stored in an in-memory
+// evoDb as ProcessBlock does (a snapshot once per day, a diff for every block),
+// starting from a cold cache.
+
+static const int NUM_PNS = 5000;
+static const unsigned int NUM_PROJECTED = 20;
+static const int CHAIN_HEIGHT = 5000;
+static const int NUM_LOOKUPS = 200;
+
+static CKeyID MakeKeyID(int i, int nKey)
+{
+    const std::vector<unsigned char> vch = {(unsigned char)nKey, (unsigned char)(i >> 16), (unsigned char)(i >> 8), (unsigned char)i};
+    return CKeyID(Hash160(vch));
+}
+
+static CDeterministicPNList CreateList()
+{
+    CDeterministicPNList list(UINT256_ZERO, NUM_PNS, 0);
+    for (int i = 0; i < NUM_PNS; i++) {
+        auto dmn = std::make_shared<CDeterministicPN>(i);
+        dmn->proTxHash = ArithToUint256(arith_uint256(i + 1));
+        dmn->collateralOutpoint = COutPoint(dmn->proTxHash, 0);
+        dmn->nOperatorReward = 0;
+        auto state = std::make_shared<CDeterministicPNState>();
+        state->nRegisteredHeight = i % 500;
+        state->keyIDOwner = MakeKeyID(i, 0);
+        state->keyIDOperator = MakeKeyID(i, 1);
+        state->keyIDVoting = state->keyIDOwner;
+        dmn->pdmnState = state;
+        list.AddPN(dmn);
+    }
+    return list;
+}
+
+static void DeterministicPNListPayee(benchmark::State& state)
+{
+    CDeterministicPNList list = CreateList();
+    int nHeight = list.GetHeight();
+    while (state.KeepRunning()) {
+        auto payee = list.GetPNPayee();
+        auto newState = std::make_shared<CDeterministicPNState>(*payee->pdmnState);
+        newState->nLastPaidHeight = ++nHeight;
+        list.UpdatePN(payee, newState);
+    }
+}
+
+static void DeterministicPNListProjectedPayees(benchmark::State& state)
+{
+    const CDeterministicPNList list = CreateList();
+    while (state.KeepRunning()) {
+        auto payees = list.GetProjectedPNPayees(NUM_PROJECTED);
+        assert(payees.size() == NUM_PROJECTED);
+    }
+}
+
+static void DeterministicPNListRandomLookups(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V6_0, 1);
+
+    std::vector<uint256> vHashes(CHAIN_HEIGHT + 1);
+    std::vector<CBlockIndex> vBlocks(CHAIN_HEIGHT + 1);
+    for (int i = 0; i <= CHAIN_HEIGHT; i++) {
+        vHashes[i] = ArithToUint256(arith_uint256(i + 1));
+        CBlockIndex& index = vBlocks[i];
+        index.nHeight = i;
+        index.pprev = i > 0 ? &vBlocks[i - 1] : nullptr;
+        index.phashBlock = &vHashes[i];
+        index.BuildSkip();
+    }
+
+    // The list is created at the activation height, then every block pays a PN
+    CEvoDB db(1 << 20, true, true);
+    CDeterministicPNList list = CreateList();
+    list.SetBlockHash(vHashes[1]);
+    list.SetHeight(1);
+    db.Write(std::make_pair(DB_LIST_DIFF, vHashes[1]), CDeterministicPNList().BuildDiff(list));
+    db.Write(std::make_pair(DB_LIST_SNAPSHOT, vHashes[1]), list);
+    for (int i = 2; i <= CHAIN_HEIGHT; i++) {
+        CDeterministicPNList newList = list;
+        newList.SetBlockHash(vHashes[i]);
+        newList.SetHeight(i);
+        auto payee = newList.GetPNPayee();
+        auto newState = std::make_shared<CDeterministicPNState>(*payee->pdmnState);
+        newState->nLastPaidHeight = i;
+        newList.UpdatePN(payee, newState);
+        db.Write(std::make_pair(DB_LIST_DIFF, vHashes[i]), list.BuildDiff(newList));
+        if (i % 1440 == 0) {
+            db.Write(std::make_pair(DB_LIST_SNAPSHOT, vHashes[i]), newList);
+        }
+        list = newList;
+    }
+
+    while (state.KeepRunning()) {
+        CDeterministicPNManager manager(db);
+        manager.UpdatedBlockTip(&vBlocks[CHAIN_HEIGHT]);
+        FastRandomContext rng(true);
+        for (int i = 0; i < NUM_LOOKUPS; i++) {
+            const int nHeight = 1 + rng.randrange(CHAIN_HEIGHT);
+            auto mnList = manager.GetListForBlock(&vBlocks[nHeight]);
+            assert(mnList.GetHeight() == nHeight);
+        }
+    }
+
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V6_0, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+}
+
+BENCHMARK(DeterministicPNListPayee);
+BENCHMARK(DeterministicPNListProjectedPayees);
+BENCHMARK(DeterministicPNListRandomLookups);
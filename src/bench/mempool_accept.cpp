@@ -0,0 +1,135 @@
+// Copyright (c) 2021 The TrumpCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "coins.h"
+#include "consensus/validation.h"
+#include "keystore.h"
+#include "sapling/transaction_builder.h"
+#include "sapling/zip32.h"
+#include "scheduler.h"
+#include "script/sigcache.h"
+#include "script/sign.h"
+#include "script/standard.h"
+#include "txmempool.h"
+#include "util/system.h"
+#include "validation.h"
+#include "validationinterface.h"
+
+// Cost of AcceptToMemoryPool on a mixed load of transparent P2PKH spends and
+// transparent-to-shielded transactions (when the Sapling parameters are available),
+// against a fake chain and an in-memory coins view.
+
+static const int CHAIN_HEIGHT = 400;
+static const int NUM_TRANSPARENT_TXS = 200;
+static const int NUM_SHIELDED_TXS = 20;
+
+static void MempoolAcceptMixed(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    const Consensus::Params& consensus = Params().GetConsensus();
+    InitSignatureCache();
+
+    CScheduler scheduler;
+    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
+    // Fake chain, only headers: ATMP needs the tip, its median time past and the
+    // height of the coins view best block.
+    std::vector<uint256> vHashes(CHAIN_HEIGHT + 1);
+    std::vector<CBlockIndex> vBlocks(CHAIN_HEIGHT + 1);
+    const int64_t nNow = GetTime();
+    for (int i = 0; i <= CHAIN_HEIGHT; i++) {
+        vHashes[i] = ArithToUint256(arith_uint256(i + 1));
+        CBlockIndex& index = vBlocks[i];
+        index.nHeight = i;
+        index.nTime = nNow - (CHAIN_HEIGHT - i) * 60;
+        index.pprev = i > 0 ? &vBlocks[i - 1] : nullptr;
+        index.phashBlock = &vHashes[i];
+        index.BuildSkip();
+    }
+
+    CCoinsView coinsBase;
+    std::unique_ptr<CCoinsViewCache> pcoinsTipOld = std::move(pcoinsTip);
+    pcoinsTip.reset(new CCoinsViewCache(&coinsBase));
+    {
+        LOCK(cs_main);
+        for (int i = 0; i <= CHAIN_HEIGHT; i++) {
+            mapBlockIndex.emplace(vHashes[i], &vBlocks[i]);
+        }
+        chainActive.SetTip(&vBlocks[CHAIN_HEIGHT]);
+        pindexBestHeader = chainActive.Tip();
+        pcoinsTip->SetBestBlock(vHashes[CHAIN_HEIGHT]);
+    }
+
+    // One P2PKH coin per transaction
+    CBasicKeyStore keystore;
+    CKey key;
+    key.MakeNewKey(true);
+    keystore.AddKey(key);
+    const CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+    const CAmount nCoinValue = 10 * COIN;
+
+    std::vector<CTransactionRef> vTxs;
+    for (int i = 0; i < NUM_TRANSPARENT_TXS + NUM_SHIELDED_TXS; i++) {
+        const COutPoint prevout(ArithToUint256(arith_uint256(1000000 + i)), 0);
+        pcoinsTip->AddCoin(prevout, Coin(CTxOut(nCoinValue, scriptPubKey), 1, false, false), false);
+        if (i < NUM_TRANSPARENT_TXS) {
+            CMutableTransaction mtx;
+            mtx.vin.emplace_back(prevout);
+            mtx.vout.emplace_back(nCoinValue - COIN / 100, scriptPubKey);
+            bool ok = SignSignature(keystore, scriptPubKey, mtx, 0, nCoinValue, SIGHASH_ALL);
+            assert(ok);
+            vTxs.emplace_back(MakeTransactionRef(mtx));
+        }
+    }
+
+    bool fShielded = true;
+    try {
+        initZKSNARKS();
+    } catch (const std::exception& e) {
+        LogPrintf("%s: Sapling parameters not available (%s), transparent transactions only\n", __func__, e.what());
+        fShielded = false;
+    }
+    if (fShielded) {
+        std::vector<unsigned char, secure_allocator<unsigned char>> rawSeed(32);
+        HDSeed seed(rawSeed);
+        auto sk = libzcash::SaplingExtendedSpendingKey::Master(seed);
+        auto pa = sk.DefaultAddress();
+        for (int i = NUM_TRANSPARENT_TXS; i < NUM_TRANSPARENT_TXS + NUM_SHIELDED_TXS; i++) {
+            const COutPoint prevout(ArithToUint256(arith_uint256(1000000 + i)), 0);
+            TransactionBuilder builder(consensus, CHAIN_HEIGHT + 1, &keystore);
+            builder.SetFee(COIN);
+            builder.AddTransparentInput(prevout, scriptPubKey, nCoinValue);
+            builder.AddSaplingOutput(sk.expsk.ovk, pa, nCoinValue - COIN);
+            vTxs.emplace_back(MakeTransactionRef(builder.Build().GetTxOrThrow()));
+        }
+    }
+
+    while (state.KeepRunning()) {
+        for (const CTransactionRef& tx : vTxs) {
+            CValidationState valState;
+            bool fMissingInputs = false;
+            bool ok = AcceptToMemoryPool(mempool, valState, tx, true, &fMissingInputs);
+            assert(ok);
+        }
+        mempool.clear();
+    }
+
+    GetMainSignals().FlushBackgroundCallbacks();
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(nullptr);
+        pindexBestHeader = nullptr;
+        for (const uint256& hash : vHashes) {
+            mapBlockIndex.erase(hash);
+        }
+        pcoinsTip = std::move(pcoinsTipOld);
+    }
+}
+
+BENCHMARK(MempoolAcceptMixed);
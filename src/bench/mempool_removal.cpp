@@ -0,0 +1,124 @@
+// Copyright (c) 2021 The TrumpCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+
+#include "policy/feerate.h"
+#include "txmempool.h"
+
+// Cost of updating the mempool dependency state when a block confirms part of
+// a cluster (removeForBlock) and when a block is disconnected and its
+// transactions are re-added below their in-mempool descendants
+// (UpdateTransactionsFromBlock), for long chains and wide fan-outs.
+
+static const int CHAIN_LENGTH = 500;
+static const int FANOUT_WIDTH = 1000;
+
+static void AddTx(CTxMemPool& pool, const CTransactionRef& tx)
+{
+    pool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, 1000, 0, 1, false, 1));
+}
+
+// A chain of CHAIN_LENGTH transactions, each spending the only output of the previous one.
+static std::vector<CTransactionRef> CreateChain()
+{
+    std::vector<CTransactionRef> vtx;
+    uint256 prevHash = uint256S("0x01");
+    for (int i = 0; i < CHAIN_LENGTH; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(COutPoint(prevHash, 0), CScript() << OP_TRUE);
+        mtx.vout.emplace_back(COIN - i * 1000, CScript() << OP_TRUE);
+        vtx.emplace_back(MakeTransactionRef(mtx));
+        prevHash = vtx.back()->GetHash();
+    }
+    return vtx;
+}
+
+// A parent with FANOUT_WIDTH outputs, each one spent by a child which has
+// a single descendant of its own.
+static std::vector<CTransactionRef> CreateFanout()
+{
+    std::vector<CTransactionRef> vtx;
+    CMutableTransaction parent;
+    parent.vin.emplace_back(COutPoint(uint256S("0x01"), 0), CScript() << OP_TRUE);
+    for (int i = 0; i < FANOUT_WIDTH; i++) {
+        parent.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    }
+    vtx.emplace_back(MakeTransactionRef(parent));
+    const uint256 parentHash = vtx.front()->GetHash();
+    for (int i = 0; i < FANOUT_WIDTH; i++) {
+        CMutableTransaction child;
+        child.vin.emplace_back(COutPoint(parentHash, i), CScript() << OP_TRUE);
+        child.vout.emplace_back(COIN - 1000, CScript() << OP_TRUE);
+        vtx.emplace_back(MakeTransactionRef(child));
+    }
+    for (int i = 1; i <= FANOUT_WIDTH; i++) {
+        CMutableTransaction grandchild;
+        grandchild.vin.emplace_back(COutPoint(vtx[i]->GetHash(), 0), CScript() << OP_TRUE);
+        grandchild.vout.emplace_back(COIN - 2000, CScript() << OP_TRUE);
+        vtx.emplace_back(MakeTransactionRef(grandchild));
+    }
+    return vtx;
+}
+
+// Add vtx to the mempool and connect a block with the first nInBlock of them.
+static void RemoveForBlock(benchmark::State& state, const std::vector<CTransactionRef>& vtx, size_t nInBlock)
+{
+    const std::vector<CTransactionRef> vBlockTxs(vtx.begin(), vtx.begin() + nInBlock);
+    CTxMemPool pool(CFeeRate(1000));
+    while (state.KeepRunning()) {
+        for (const CTransactionRef& tx : vtx) {
+            AddTx(pool, tx);
+        }
+        pool.removeForBlock(vBlockTxs, 2);
+        pool.clear();
+    }
+}
+
+// Add all but the first nInBlock transactions of vtx to the mempool, then
+// disconnect a block with the first nInBlock of them.
+static void ReaddForReorg(benchmark::State& state, const std::vector<CTransactionRef>& vtx, size_t nInBlock)
+{
+    std::vector<uint256> vHashUpdate;
+    for (size_t i = 0; i < nInBlock; i++) {
+        vHashUpdate.emplace_back(vtx[i]->GetHash());
+    }
+    CTxMemPool pool(CFeeRate(1000));
+    while (state.KeepRunning()) {
+        for (size_t i = nInBlock; i < vtx.size(); i++) {
+            AddTx(pool, vtx[i]);
+        }
+        for (size_t i = 0; i < nInBlock; i++) {
+            AddTx(pool, vtx[i]);
+        }
+        pool.UpdateTransactionsFromBlock(vHashUpdate);
+        pool.clear();
+    }
+}
+
+static void MempoolRemoveForBlockChain(benchmark::State& state)
+{
+    RemoveForBlock(state, CreateChain(), CHAIN_LENGTH / 2);
+}
+
+static void MempoolRemoveForBlockFanout(benchmark::State& state)
+{
+    // The parent and half of its children are confirmed
+    RemoveForBlock(state, CreateFanout(), FANOUT_WIDTH / 2 + 1);
+}
+
+static void MempoolReorgChain(benchmark::State& state)
+{
+    ReaddForReorg(state, CreateChain(), CHAIN_LENGTH / 2);
+}
+
+static void MempoolReorgFanout(benchmark::State& state)
+{
+    ReaddForReorg(state, CreateFanout(), FANOUT_WIDTH / 2 + 1);
+}
+
+BENCHMARK(MempoolRemoveForBlockChain);
+BENCHMARK(MempoolRemoveForBlockFanout);
+BENCHMARK(MempoolReorgChain);
+BENCHMARK(MempoolReorgFanout);
@@ -0,0 +1,83 @@
+// Copyright (c) 2021 The TrumpCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+
+#include "policy/fees.h"
+#include "random.h"
+#include "txmempool.h"
+
+#include <list>
+
+// Replays a recorded stream of mempool arrivals and block confirmations through
+// the fee estimator, with wallets asking for estimates between blocks.
+// The stream is generated once, deterministically: higher feerate transactions
+// get confirmed sooner, and one in ten transactions is shielded.
+
+static const int NUM_BLOCKS = 300;
+static const int TXS_PER_BLOCK = 200;
+static const int ESTIMATES_PER_BLOCK = 500;
+
+struct FeeEstimatorStream
+{
+    // Entries must not move: the estimator is handed pointers to them
+    std::list<CTxMemPoolEntry> entries;
+    // vArrivals[h] entered the mempool at height h, vConfirmed[h] got mined at height h
+    std::vector<std::vector<const CTxMemPoolEntry*>> vArrivals;
+    std::vector<std::vector<const CTxMemPoolEntry*>> vConfirmed;
+};
+
+static FeeEstimatorStream RecordStream()
+{
+    FeeEstimatorStream stream;
+    stream.vArrivals.resize(NUM_BLOCKS + 1);
+    stream.vConfirmed.resize(NUM_BLOCKS + 10 + MAX_BLOCK_CONFIRMS);
+    FastRandomContext rng(true);
+    for (int nHeight = 1; nHeight <= NUM_BLOCKS; nHeight++) {
+        for (int i = 0; i < TXS_PER_BLOCK; i++) {
+            CMutableTransaction mtx;
+            mtx.vin.emplace_back(COutPoint(uint256S("0x01"), nHeight * TXS_PER_BLOCK + i));
+            mtx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+            const bool fShielded = i % 10 == 0;
+            if (fShielded) {
+                mtx.nVersion = CTransaction::TxVersion::SAPLING;
+                mtx.sapData = SaplingTxData();
+                mtx.sapData->vShieldedOutput.emplace_back();
+            }
+            // Feerate level 0 to 9, the higher the sooner it gets confirmed
+            const int nLevel = rng.randrange(10);
+            const CTransactionRef tx = MakeTransactionRef(mtx);
+            CAmount nFee = (nLevel + 1) * tx->GetTotalSize();
+            if (fShielded) nFee *= DEFAULT_SHIELDEDTXFEE_K;
+            stream.entries.emplace_back(tx, nFee, 0, nHeight, false, 1);
+            const CTxMemPoolEntry* entry = &stream.entries.back();
+            stream.vArrivals[nHeight].push_back(entry);
+            const int nDelay = 1 + rng.randrange(10 - nLevel) + (rng.randrange(20) == 0 ? rng.randrange(MAX_BLOCK_CONFIRMS) : 0);
+            stream.vConfirmed[nHeight + nDelay].push_back(entry);
+        }
+    }
+    return stream;
+}
+
+static void FeeEstimatorReplay(benchmark::State& state)
+{
+    const FeeEstimatorStream stream = RecordStream();
+    CTxMemPool pool(CFeeRate(1000));
+    while (state.KeepRunning()) {
+        CBlockPolicyEstimator estimator(CFeeRate(1000));
+        for (int nHeight = 1; nHeight <= NUM_BLOCKS; nHeight++) {
+            std::vector<const CTxMemPoolEntry*> vConfirmed = stream.vConfirmed[nHeight];
+            estimator.processBlock(nHeight, vConfirmed);
+            for (const CTxMemPoolEntry* entry : stream.vArrivals[nHeight]) {
+                estimator.processTransaction(*entry, true);
+            }
+            for (int i = 0; i < ESTIMATES_PER_BLOCK; i++) {
+                int answerFound;
+                estimator.estimateSmartFee(1 + i % 12, &answerFound, pool, i % 10 == 0);
+            }
+        }
+    }
+}
+
+BENCHMARK(FeeEstimatorReplay);
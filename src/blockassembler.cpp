@@ -39,6 +39,9 @@
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
 
+// Age after which the staker selects its transactions from scratch again
+static const int64_t MAX_TX_SELECTION_AGE = 60;
+
 class ScoreCompare
 {
 public:
@@ -162,8 +165,10 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
                                                bool fProofOfStake,
                                                std::vector<CStakeableOutput>* availableCoins,
                                                bool fNoMempoolTx,
-                                               bool fTestValidity)
+                                               bool fTestValidity,
+                                               CTxSelection* pSelectionCache)
 {
+    int64_t nTimeStart = GetTimeMicros();
     resetBlock();
 
     pblocktemplate.reset(new CBlockTemplate());
@@ -171,9 +176,6 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     if(!pblocktemplate) return nullptr;
     pblock = &pblocktemplate->block; // pointer for convenience
 
-    pblocktemplate->vTxFees.push_back(-1); // updated at end
-    pblocktemplate->vTxSigOps.push_back(-1); // updated at end
-
     CBlockIndex* pindexPrev = WITH_LOCK(cs_main, return chainActive.Tip());
     assert(pindexPrev);
     nHeight = pindexPrev->nHeight + 1;
@@ -190,12 +192,30 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
                         : CreateCoinbaseTx(pblock, scriptPubKeyIn, pindexPrev))) {
         return nullptr;
     }
+    int64_t nTime1 = GetTimeMicros();
 
+    // Select the mempool transactions only once the kernel is found. The staker passes its
+    // previous selection, so that a new kernel only needs the transactions that arrived since.
+    CTxSelection selection;
+    nTxsReused = 0;
+    nTimeSaplingRoot = 0;
     if (!fNoMempoolTx) {
         // Add transactions from mempool
         LOCK2(cs_main,mempool.cs);
-        addPackageTxs();
+        // the staker moves on to the new tip, instead of caching a selection that can't be reused
+        if (pSelectionCache && chainActive.Tip() != pindexPrev) return nullptr;
+        std::vector<CTransactionRef> vKernelTxs = std::move(pblock->vtx);
+        pblock->vtx.clear();
+        SelectTxs(pindexPrev, pSelectionCache, selection);
+        pblock->vtx = std::move(vKernelTxs);
     }
+    int64_t nTime2 = GetTimeMicros();
+
+    pblocktemplate->vTxFees.push_back(-1); // updated at end
+    pblocktemplate->vTxSigOps.push_back(-1); // updated at end
+    pblock->vtx.insert(pblock->vtx.end(), selection.vtx.begin(), selection.vtx.end());
+    pblocktemplate->vTxFees.insert(pblocktemplate->vTxFees.end(), selection.vTxFees.begin(), selection.vTxFees.end());
+    pblocktemplate->vTxSigOps.insert(pblocktemplate->vTxSigOps.end(), selection.vTxSigOps.begin(), selection.vTxSigOps.end());
 
     if (!fProofOfStake) {
         // Coinbase can get the fees.
@@ -216,8 +236,16 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblock->nBits = GetNextWorkRequired(pindexPrev, pblock);
     pblock->nNonce = 0;
     pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(*(pblock->vtx[0]));
-    appendSaplingTreeRoot();
+    if (fNoMempoolTx) {
+        // The coinbase and the coinstake have no shielded outputs
+        int64_t nTimeRootStart = GetTimeMicros();
+        pblock->hashFinalSaplingRoot = WITH_LOCK(cs_main, return CalculateSaplingTreeRoot(pblock, nHeight, chainparams));
+        nTimeSaplingRoot = GetTimeMicros() - nTimeRootStart;
+    } else {
+        pblock->hashFinalSaplingRoot = selection.hashFinalSaplingRoot;
+    }
 
+    int64_t nTime3 = GetTimeMicros();
     if (fProofOfStake) { // this is only for PoS because the IncrementExtraNonce does it for PoW
         pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
         LogPrintf("CPUMiner : proof-of-stake block found %s \n", pblock->GetHash().GetHex());
@@ -226,6 +254,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
             return nullptr;
         }
     }
+    int64_t nTime4 = GetTimeMicros();
 
     {
         LOCK(cs_main);
@@ -238,10 +267,98 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
                     strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
         }
     }
+    int64_t nTime5 = GetTimeMicros();
+
+    LogPrint(BCLog::BENCH, "CreateNewBlock() timings: %s %.2fms, template %.2fms (%u txs, %u reused), sapling root %.2fms, sign %.2fms, validity test %.2fms, total %.2fms\n",
+             fProofOfStake ? "coinstake" : "coinbase", 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime2 - nTime1), nBlockTx, nTxsReused,
+             0.001 * nTimeSaplingRoot, 0.001 * (nTime4 - nTime3), 0.001 * (nTime5 - nTime4), 0.001 * (nTime5 - nTimeStart));
 
     return std::move(pblocktemplate);
 }
 
+void BlockAssembler::SelectTxs(const CBlockIndex* pindexPrev, CTxSelection* pCache, CTxSelection& selection)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(mempool.cs);
+    assert(pblock->vtx.empty());
+
+    const bool fShieldedAllowed = !sporkManager.IsSporkActive(SPORK_20_SAPLING_MAINTENANCE);
+    const bool fColdStakingAllowed = !sporkManager.IsSporkActive(SPORK_19_COLDSTAKING_MAINTENANCE);
+    const unsigned int nMempoolUpdated = mempool.GetTransactionsUpdated();
+    const int64_t nNow = GetTime();
+
+    // The previous selection can only be extended if it is recent (the fees of its transactions
+    // may have been prioritised since), and if it leaves room in the block (otherwise the new
+    // transactions may be better than the selected ones).
+    bool fReuse = pCache &&
+                  pCache->hashPrevBlock == pindexPrev->GetBlockHash() &&
+                  pCache->nBlockMaxSize == nBlockMaxSize &&
+                  pCache->fShieldedAllowed == fShieldedAllowed &&
+                  pCache->fColdStakingAllowed == fColdStakingAllowed &&
+                  nNow - pCache->nTimeBuilt < MAX_TX_SELECTION_AGE &&
+                  pCache->nBlockSize < (uint64_t)nBlockMaxSize * 9 / 10;
+    if (fReuse && pCache->nMempoolUpdated == nMempoolUpdated) {
+        // Nothing was added to or removed from the mempool since
+        selection = *pCache;
+        nTxsReused = selection.vtx.size();
+    } else {
+        if (fReuse) {
+            for (const CTransactionRef& tx : pCache->vtx) {
+                CTxMemPool::txiter it = mempool.mapTx.find(tx->GetHash());
+                if (it == mempool.mapTx.end()) {
+                    fReuse = false;
+                    break;
+                }
+                inBlock.insert(it);
+            }
+        }
+        if (fReuse) {
+            // Only append the best of what arrived since
+            pblock->vtx = pCache->vtx;
+            pblocktemplate->vTxFees = pCache->vTxFees;
+            pblocktemplate->vTxSigOps = pCache->vTxSigOps;
+            nBlockSize = pCache->nBlockSize;
+            nBlockTx = pCache->nBlockTx;
+            nBlockSigOps = pCache->nBlockSigOps;
+            nFees = pCache->nFees;
+            nSizeShielded = pCache->nSizeShielded;
+            nTxsReused = pCache->vtx.size();
+        } else {
+            resetBlock();
+        }
+        addPackageTxs();
+
+        selection.hashPrevBlock = pindexPrev->GetBlockHash();
+        selection.nMempoolUpdated = nMempoolUpdated;
+        selection.nTimeBuilt = fReuse ? pCache->nTimeBuilt : nNow;
+        selection.nBlockMaxSize = nBlockMaxSize;
+        selection.fShieldedAllowed = fShieldedAllowed;
+        selection.fColdStakingAllowed = fColdStakingAllowed;
+        selection.vtx = std::move(pblock->vtx);
+        selection.vTxFees = std::move(pblocktemplate->vTxFees);
+        selection.vTxSigOps = std::move(pblocktemplate->vTxSigOps);
+        selection.nBlockSize = nBlockSize;
+        selection.nBlockTx = nBlockTx;
+        selection.nBlockSigOps = nBlockSigOps;
+        selection.nFees = nFees;
+        selection.nSizeShielded = nSizeShielded;
+        int64_t nTimeRootStart = GetTimeMicros();
+        selection.hashFinalSaplingRoot = CalculateSaplingTreeRoot(selection.vtx, nHeight, chainparams);
+        nTimeSaplingRoot = GetTimeMicros() - nTimeRootStart;
+        pblock->vtx.clear();
+        pblocktemplate->vTxFees.clear();
+        pblocktemplate->vTxSigOps.clear();
+
+        if (pCache) *pCache = selection;
+    }
+
+    nBlockSize = selection.nBlockSize;
+    nBlockTx = selection.nBlockTx;
+    nBlockSigOps = selection.nBlockSigOps;
+    nFees = selection.nFees;
+    nSizeShielded = selection.nSizeShielded;
+}
+
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
 {
     for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
@@ -457,6 +574,11 @@ void BlockAssembler::addPackageTxs()
 
         for (size_t i = 0; i < sortedEntries.size(); ++i) {
             CTxMemPool::txiter& iterSortedEntries = sortedEntries[i];
+            // Don't add P2CS outputs if in maintenance (SPORK_19), the block would be rejected.
+            // They may have entered the mempool before the spork was activated.
+            if (iterSortedEntries->HasP2CSOutputs() && sporkManager.IsSporkActive(SPORK_19_COLDSTAKING_MAINTENANCE)) {
+                break;
+            }
             if (iterSortedEntries->IsShielded()) {
                 // Don't add SHIELD transactions if in maintenance (SPORK_20)
                 if (sporkManager.IsSporkActive(SPORK_20_SAPLING_MAINTENANCE)) {
@@ -479,20 +601,19 @@ void BlockAssembler::addPackageTxs()
     }
 }
 
-void BlockAssembler::appendSaplingTreeRoot()
+uint256 CalculateSaplingTreeRoot(CBlock* pblock, int nHeight, const CChainParams& chainparams)
 {
-    // Update header
-    pblock->hashFinalSaplingRoot = CalculateSaplingTreeRoot(pblock, nHeight, chainparams);
+    return CalculateSaplingTreeRoot(pblock->vtx, nHeight, chainparams);
 }
 
-uint256 CalculateSaplingTreeRoot(CBlock* pblock, int nHeight, const CChainParams& chainparams)
+uint256 CalculateSaplingTreeRoot(const std::vector<CTransactionRef>& vtx, int nHeight, const CChainParams& chainparams)
 {
     if (NetworkUpgradeActive(nHeight, chainparams.GetConsensus(), Consensus::UPGRADE_V5_0)) {
         SaplingMerkleTree sapling_tree;
         assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(), sapling_tree));
 
         // Update the Sapling commitment tree.
-        for (const auto &tx : pblock->vtx) {
+        for (const auto &tx : vtx) {
             if (tx->IsShieldedTx()) {
                 for (const OutputDescription &odesc : tx->sapData->vShieldedOutput) {
                     sapling_tree.append(odesc.cmu);
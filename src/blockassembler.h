@@ -31,6 +31,31 @@ struct CBlockTemplate
     std::vector<int64_t> vTxSigOps;
 };
 
+/**
+ * Mempool transactions selected for a block on top of hashPrevBlock, and the Sapling root they
+ * lead to. Each staker thread keeps its last selection and tops it up with the transactions that
+ * entered the mempool since, instead of running the whole selection again for every found kernel.
+ */
+struct CTxSelection
+{
+    uint256 hashPrevBlock;
+    unsigned int nMempoolUpdated{0};
+    int64_t nTimeBuilt{0};
+    unsigned int nBlockMaxSize{0};
+    bool fShieldedAllowed{false};
+    bool fColdStakingAllowed{false};
+
+    std::vector<CTransactionRef> vtx;
+    std::vector<CAmount> vTxFees;
+    std::vector<int64_t> vTxSigOps;
+    uint64_t nBlockSize{0};
+    uint64_t nBlockTx{0};
+    unsigned int nBlockSigOps{0};
+    CAmount nFees{0};
+    unsigned int nSizeShielded{0};
+    uint256 hashFinalSaplingRoot;
+};
+
 // Container for tracking updates to ancestor feerate as we include (parent)
 // transactions in a block
 struct CTxMemPoolModifiedEntry {
@@ -159,15 +184,22 @@ private:
     // Whether should print priority by default or not
     const bool defaultPrintPriority{false};
 
+    // Transactions taken from the previous selection, and time spent on the Sapling root, for the last SelectTxs
+    size_t nTxsReused{0};
+    int64_t nTimeSaplingRoot{0};
+
 public:
     BlockAssembler(const CChainParams& chainparams, const bool defaultPrintPriority);
-    /** Construct a new block template with coinbase to scriptPubKeyIn */
+    /** Construct a new block template with coinbase to scriptPubKeyIn.
+      * The mempool transactions are selected after the coinbase or coinstake, extending
+      * the caller's previous selection in pSelectionCache when given. */
     std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn,
                                    CWallet* pwallet = nullptr,
                                    bool fProofOfStake = false,
                                    std::vector<CStakeableOutput>* availableCoins = nullptr,
                                    bool fNoMempoolTx = false,
-                                   bool fTestValidity = true);
+                                   bool fTestValidity = true,
+                                   CTxSelection* pSelectionCache = nullptr);
 
 private:
     // utility functions
@@ -179,8 +211,10 @@ private:
     // Methods for how to add transactions to a block.
     /** Add transactions based on feerate including unconfirmed ancestors */
     void addPackageTxs();
-    /** Add the tip updated incremental merkle tree to the header */
-    void appendSaplingTreeRoot();
+    /** Select the mempool transactions for a block on top of pindexPrev, starting from the
+      * previous selection in pCache, if any, and storing the new one there. Must be called
+      * while the block has no transactions. */
+    void SelectTxs(const CBlockIndex* pindexPrev, CTxSelection* pCache, CTxSelection& selection);
 
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
@@ -212,5 +246,6 @@ CMutableTransaction CreateCoinbaseTx(const CScript& scriptPubKeyIn, CBlockIndex*
 
 // Visible for testing purposes only
 uint256 CalculateSaplingTreeRoot(CBlock* pblock, int nHeight, const CChainParams& chainparams);
+uint256 CalculateSaplingTreeRoot(const std::vector<CTransactionRef>& vtx, int nHeight, const CChainParams& chainparams);
 
 #endif // TrumpCoin_BLOCKASSEMBLER_H
@@ -0,0 +1,106 @@
+// Copyright (c) 2021 The TrumpCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockreadcache.h"
+
+CBlockReadCache g_blockreadcache;
+
+void CBlockReadCache::SetMaxBlocks(size_t nMaxBlocksIn)
+{
+    LOCK(cs);
+    nMaxBlocks = nMaxBlocksIn;
+    while (lruBlocks.size() > nMaxBlocks) {
+        mapBlocks.erase(lruBlocks.back().first);
+        lruBlocks.pop_back();
+    }
+}
+
+std::shared_ptr<const CBlock> CBlockReadCache::GetBlock(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapBlocks.find(hash);
+    if (it == mapBlocks.end()) {
+        nMisses++;
+        return nullptr;
+    }
+    nHits++;
+    lruBlocks.splice(lruBlocks.begin(), lruBlocks, it->second);
+    return it->second->second;
+}
+
+void CBlockReadCache::AddBlock(const uint256& hash, const std::shared_ptr<const CBlock>& pblock)
+{
+    LOCK(cs);
+    if (nMaxBlocks == 0 || mapBlocks.count(hash)) {
+        return;
+    }
+    lruBlocks.emplace_front(hash, pblock);
+    mapBlocks.emplace(hash, lruBlocks.begin());
+    if (lruBlocks.size() > nMaxBlocks) {
+        mapBlocks.erase(lruBlocks.back().first);
+        lruBlocks.pop_back();
+    }
+}
+
+std::shared_ptr<const FlatFileMapping> CBlockReadCache::GetMapping(const FlatFileSeq& seq, const FlatFilePos& pos, bool fUndo)
+{
+    LOCK(cs);
+    auto& mapFiles = fUndo ? mapUndoFiles : mapBlockFiles;
+    auto it = mapFiles.find(pos.nFile);
+    if (it != mapFiles.end()) {
+        return it->second;
+    }
+    if (mapFiles.size() >= MAX_MAPPED_BLOCK_FILES) {
+        // Recent blocks are the ones most likely to be read again: drop the oldest file
+        mapFiles.erase(mapFiles.begin());
+    }
+    // Failures are remembered too (as nullptr), so that the file isn't retried on every read
+    return mapFiles.emplace(pos.nFile, seq.Map(pos)).first->second;
+}
+
+void CBlockReadCache::CountRead(bool fMapped)
+{
+    LOCK(cs);
+    if (fMapped) {
+        nMappedReads++;
+    } else {
+        nFileReads++;
+    }
+}
+
+void CBlockReadCache::Clear()
+{
+    LOCK(cs);
+    lruBlocks.clear();
+    mapBlocks.clear();
+    mapBlockFiles.clear();
+    mapUndoFiles.clear();
+}
+
+void CBlockReadCache::DropFile(int nFile)
+{
+    LOCK(cs);
+    mapBlockFiles.erase(nFile);
+    mapUndoFiles.erase(nFile);
+}
+
+CBlockReadCache::Stats CBlockReadCache::GetStats() const
+{
+    LOCK(cs);
+    Stats stats;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    stats.nMappedReads = nMappedReads;
+    stats.nFileReads = nFileReads;
+    stats.nBlocks = lruBlocks.size();
+    for (const auto* mapFiles : {&mapBlockFiles, &mapUndoFiles}) {
+        for (const auto& it : *mapFiles) {
+            if (it.second) {
+                stats.nMappedFiles++;
+                stats.nMappedBytes += it.second->size();
+            }
+        }
+    }
+    return stats;
+}
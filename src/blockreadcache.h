@@ -0,0 +1,88 @@
+// Copyright (c) 2021 The TrumpCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TrumpCoin_BLOCKREADCACHE_H
+#define TrumpCoin_BLOCKREADCACHE_H
+
+#include "flatfile.h"
+#include "primitives/block.h"
+#include "saltedhasher.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+/** Default for -blockreadcache, number of recently read blocks kept decoded in memory */
+static const unsigned int DEFAULT_BLOCK_READ_CACHE_SIZE = 32;
+/** Maximum number of block (and undo) files memory-mapped at the same time */
+static const unsigned int MAX_MAPPED_BLOCK_FILES = 64;
+
+/**
+ * Shared read path for the block and undo files:
+ * - a small LRU of decoded blocks, keyed by block hash, so that the same recent block
+ *   requested by different subsystems (rpc, zmq, wallet, peers) is deserialized once.
+ * - read-only memory mappings of the finalized blk/rev files, so that the remaining
+ *   reads don't need to open, seek and read the file.
+ */
+class CBlockReadCache
+{
+public:
+    struct Stats {
+        uint64_t nHits{0};
+        uint64_t nMisses{0};
+        uint64_t nMappedReads{0};
+        uint64_t nFileReads{0};
+        size_t nBlocks{0};
+        size_t nMappedFiles{0};
+        size_t nMappedBytes{0};
+    };
+
+private:
+    typedef std::pair<uint256, std::shared_ptr<const CBlock>> BlockEntry;
+
+    mutable Mutex cs;
+    size_t nMaxBlocks{DEFAULT_BLOCK_READ_CACHE_SIZE};
+    //! Most recently used first
+    std::list<BlockEntry> lruBlocks;
+    std::unordered_map<uint256, std::list<BlockEntry>::iterator, StaticSaltedHasher> mapBlocks;
+    //! Mapped files, by file number, for the blk and rev sequences
+    std::map<int, std::shared_ptr<const FlatFileMapping>> mapBlockFiles;
+    std::map<int, std::shared_ptr<const FlatFileMapping>> mapUndoFiles;
+
+    uint64_t nHits{0};
+    uint64_t nMisses{0};
+    uint64_t nMappedReads{0};
+    uint64_t nFileReads{0};
+
+public:
+    void SetMaxBlocks(size_t nMaxBlocksIn);
+
+    /** Returns the decoded block, or nullptr if it's not cached */
+    std::shared_ptr<const CBlock> GetBlock(const uint256& hash);
+    void AddBlock(const uint256& hash, const std::shared_ptr<const CBlock>& pblock);
+
+    /**
+     * Returns a read-only mapping of a finalized file of the given sequence (mapping it if needed),
+     * or nullptr if the file can't be mapped (the caller must then fall back to regular file reads).
+     */
+    std::shared_ptr<const FlatFileMapping> GetMapping(const FlatFileSeq& seq, const FlatFilePos& pos, bool fUndo);
+
+    /** Account a record read from a mapping or from the regular file */
+    void CountRead(bool fMapped);
+
+    /** Drop every cached block and mapping (e.g. when the block files are about to change) */
+    void Clear();
+
+    /** Unmap the blk and rev files nFile (e.g. before they get truncated) */
+    void DropFile(int nFile);
+
+    Stats GetStats() const;
+};
+
+extern CBlockReadCache g_blockreadcache;
+
+#endif // TrumpCoin_BLOCKREADCACHE_H
@@ -8,122 +8,270 @@
 #include "chainparams.h"
 #include "clientversion.h"
 
-static const int BUDGET_DB_VERSION = 1;
+static const char DB_PROPOSAL = 'p';
+static const char DB_PROPOSAL_VOTE = 'v';
+static const char DB_FINALIZED_BUDGET = 'b';
+static const char DB_FINALIZED_BUDGET_VOTE = 'f';
+static const char DB_UNCONFIRMED_FEETX = 'u';
+
+std::unique_ptr<CBudgetDB> pBudgetDB;
+
+bool ReadLegacyCacheFile(const fs::path& pathDB, const std::string& strMagicMessage, CDataStream& ssObj)
+{
+    FILE* file = fsbridge::fopen(pathDB, "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return error("%s : Failed to open file %s", __func__, pathDB.string());
+    }
+
+    // use file size to size memory buffer
+    int dataSize = std::max((int)fs::file_size(pathDB) - (int)sizeof(uint256), 0);
+    std::vector<unsigned char> vchData(dataSize);
+    uint256 hashIn;
+    try {
+        filein.read((char*)vchData.data(), dataSize);
+        filein >> hashIn;
+    } catch (const std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    ssObj = CDataStream(vchData, SER_DISK, CLIENT_VERSION);
+    if (hashIn != Hash(ssObj.begin(), ssObj.end())) {
+        return error("%s : Checksum mismatch, data corrupted", __func__);
+    }
+
+    try {
+        int version;
+        std::string strMagicMessageTmp;
+        std::vector<unsigned char> pchMsgTmp(4);
+        ssObj >> version >> strMagicMessageTmp >> MakeSpan(pchMsgTmp);
+        if (strMagicMessage != strMagicMessageTmp) {
+            return error("%s : Invalid magic message in %s", __func__, pathDB.string());
+        }
+        if (memcmp(pchMsgTmp.data(), Params().MessageStart(), pchMsgTmp.size()) != 0) {
+            return error("%s : Invalid network magic number in %s", __func__, pathDB.string());
+        }
+    } catch (const std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+bool WipeCacheDB(CDBWrapper& db)
+{
+    CDBBatch batch;
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+        batch.Erase(pcursor->GetKey());
+    }
+    return db.WriteBatch(batch, true);
+}
 
 //
 // CBudgetDB
 //
 
-CBudgetDB::CBudgetDB()
+CBudgetDB::CBudgetDB(bool fMemory, bool fWipe) :
+        CDBWrapper(GetDataDir() / "budget", 0, fMemory, fWipe)
+{ }
+
+template <typename T>
+void CBudgetDB::WriteObjects(CDBBatch& batch, char prefix, char votePrefix, const std::set<uint256>& setHashes, const std::map<uint256, T>& mapObjects)
+{
+    for (const uint256& hash : setHashes) {
+        // erase the stored votes first (the batch is applied in order)
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(std::make_pair(votePrefix, std::make_pair(hash, COutPoint(UINT256_ZERO, 0))));
+        while (pcursor->Valid()) {
+            std::pair<char, std::pair<uint256, COutPoint>> key;
+            if (!pcursor->GetKey(key) || key.first != votePrefix || key.second.first != hash) break;
+            batch.Erase(key);
+            pcursor->Next();
+        }
+
+        const auto it = mapObjects.find(hash);
+        if (it == mapObjects.end()) {
+            batch.Erase(std::make_pair(prefix, hash));
+            continue;
+        }
+        // the object is stored without its votes
+        T obj(it->second);
+        obj.mapVotes.clear();
+        batch.Write(std::make_pair(prefix, hash), obj);
+        for (const auto& vote : it->second.mapVotes) {
+            batch.Write(std::make_pair(votePrefix, std::make_pair(hash, vote.first)), vote.second);
+        }
+    }
+}
+
+template <typename T>
+void CBudgetDB::WriteVotes(CDBBatch& batch, char votePrefix, const std::set<std::pair<uint256, COutPoint>>& setVotes, const std::map<uint256, T>& mapObjects)
 {
-    pathDB = GetDataDir() / "budget.dat";
-    strMagicMessage = "PatriotnodeBudget";
+    for (const auto& voteKey : setVotes) {
+        const auto it = mapObjects.find(voteKey.first);
+        if (it == mapObjects.end()) {
+            // the object was removed: its votes are erased by WriteObjects
+            continue;
+        }
+        const auto itVote = it->second.mapVotes.find(voteKey.second);
+        if (itVote != it->second.mapVotes.end()) {
+            batch.Write(std::make_pair(votePrefix, voteKey), itVote->second);
+        } else {
+            batch.Erase(std::make_pair(votePrefix, voteKey));
+        }
+    }
 }
 
-bool CBudgetDB::Write(const CBudgetManager& objToSave)
+template <typename T>
+bool CBudgetDB::ReadObjects(char prefix, char votePrefix, std::map<uint256, T>& mapObjects)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(prefix, UINT256_ZERO));
+    while (pcursor->Valid()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != prefix) break;
+        T obj;
+        if (!pcursor->GetValue(obj)) {
+            return error("%s : Unable to read budget object %s", __func__, key.second.ToString());
+        }
+        mapObjects.emplace(key.second, obj);
+        pcursor->Next();
+    }
+
+    pcursor->Seek(std::make_pair(votePrefix, std::make_pair(UINT256_ZERO, COutPoint(UINT256_ZERO, 0))));
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<uint256, COutPoint>> key;
+        if (!pcursor->GetKey(key) || key.first != votePrefix) break;
+        auto it = mapObjects.find(key.second.first);
+        if (it != mapObjects.end()) {
+            auto& vote = it->second.mapVotes[key.second.second];
+            if (!pcursor->GetValue(vote)) {
+                return error("%s : Unable to read vote on budget object %s", __func__, key.second.first.ToString());
+            }
+        }
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBudgetDB::Write(CBudgetManager& objToSave)
 {
     int64_t nStart = GetTimeMillis();
 
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-    ssObj << BUDGET_DB_VERSION;
-    ssObj << strMagicMessage;                   // patriotnode cache file specific magic message
-    ssObj << Params().MessageStart(); // network specific magic number
-    ssObj << objToSave;
-    uint256 hash = Hash(ssObj.begin(), ssObj.end());
-    ssObj << hash;
-
-    // open output file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "wb");
-    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathDB.string());
+    CDBBatch batch;
+    std::set<uint256> setProposals, setBudgets;
+    std::set<std::pair<uint256, COutPoint>> setProposalVotes, setBudgetVotes;
+    {
+        LOCK(objToSave.cs_budgets);
+        setBudgets.swap(objToSave.setDirtyBudgets);
+        setBudgetVotes.swap(objToSave.setDirtyBudgetVotes);
+        WriteObjects(batch, DB_FINALIZED_BUDGET, DB_FINALIZED_BUDGET_VOTE, setBudgets, objToSave.mapFinalizedBudgets);
+        WriteVotes(batch, DB_FINALIZED_BUDGET_VOTE, setBudgetVotes, objToSave.mapFinalizedBudgets);
+        batch.Write(DB_UNCONFIRMED_FEETX, objToSave.mapUnconfirmedFeeTx);
+    }
+    {
+        LOCK(objToSave.cs_proposals);
+        setProposals.swap(objToSave.setDirtyProposals);
+        setProposalVotes.swap(objToSave.setDirtyProposalVotes);
+        WriteObjects(batch, DB_PROPOSAL, DB_PROPOSAL_VOTE, setProposals, objToSave.mapProposals);
+        WriteVotes(batch, DB_PROPOSAL_VOTE, setProposalVotes, objToSave.mapProposals);
+    }
 
-    // Write and commit header, data
-    try {
-        fileout << ssObj;
-    } catch (const std::exception& e) {
-        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    if (!WriteBatch(batch, true)) {
+        // try again on the next write
+        {
+            LOCK(objToSave.cs_budgets);
+            objToSave.setDirtyBudgets.insert(setBudgets.begin(), setBudgets.end());
+            objToSave.setDirtyBudgetVotes.insert(setBudgetVotes.begin(), setBudgetVotes.end());
+        }
+        {
+            LOCK(objToSave.cs_proposals);
+            objToSave.setDirtyProposals.insert(setProposals.begin(), setProposals.end());
+            objToSave.setDirtyProposalVotes.insert(setProposalVotes.begin(), setProposalVotes.end());
+        }
+        return error("%s : Failed to write budget changes", __func__);
     }
-    fileout.fclose();
 
-    LogPrint(BCLog::PNBUDGET,"Written info to budget.dat  %dms\n", GetTimeMillis() - nStart);
+    LogPrint(BCLog::PNBUDGET,"Written %d proposals, %d finalized budgets and %d votes to budget db  %dms\n",
+             setProposals.size(), setBudgets.size(), setProposalVotes.size() + setBudgetVotes.size(), GetTimeMillis() - nStart);
 
     return true;
 }
 
-CBudgetDB::ReadResult CBudgetDB::Read(CBudgetManager& objToLoad, bool fDryRun)
+void CBudgetDB::ImportLegacyFile()
 {
-    int64_t nStart = GetTimeMillis();
-    // open input file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "rb");
-    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        error("%s : Failed to open file %s", __func__, pathDB.string());
-        return FileError;
-    }
+    const fs::path pathLegacy = GetDataDir() / "budget.dat";
+    if (!fs::exists(pathLegacy)) return;
 
-    // use file size to size memory buffer
-    int fileSize = fs::file_size(pathDB);
-    int dataSize = fileSize - sizeof(uint256);
-    // Don't try to resize to a negative number if file is small
-    if (dataSize < 0)
-        dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
-    uint256 hashIn;
+    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+    if (ReadLegacyCacheFile(pathLegacy, "PatriotnodeBudget", ssObj)) {
+        CBudgetManager legacy;
+        try {
+            // seen and orphan votes, and the fee tx indexes, are not imported
+            std::map<uint256, uint256> mapFeeTxIndex;
+            std::map<uint256, CBudgetVote> mapSkippedVotes;
+            ssObj >> legacy.mapProposals >> mapFeeTxIndex >> mapSkippedVotes >> mapSkippedVotes;
+            ssObj >> legacy.mapFinalizedBudgets >> mapFeeTxIndex >> legacy.mapUnconfirmedFeeTx;
+            for (const auto& it : legacy.mapProposals) legacy.setDirtyProposals.emplace(it.first);
+            for (const auto& it : legacy.mapFinalizedBudgets) legacy.setDirtyBudgets.emplace(it.first);
+            if (Write(legacy)) {
+                LogPrintf("Imported %d proposals and %d finalized budgets from %s\n",
+                          legacy.mapProposals.size(), legacy.mapFinalizedBudgets.size(), pathLegacy.string());
+            }
+        } catch (const std::exception& e) {
+            error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
 
-    // read data and checksum from file
+    // the data is synced again from the network if it could not be imported
     try {
-        filein.read((char*)vchData.data(), dataSize);
-        filein >> hashIn;
-    } catch (const std::exception& e) {
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return HashReadError;
+        fs::remove(pathLegacy);
+    } catch (const fs::filesystem_error& e) {
+        LogPrintf("%s: Unable to remove %s: %s\n", __func__, pathLegacy.string(), fsbridge::get_filesystem_error_message(e));
     }
-    filein.fclose();
+}
 
-    CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
+CBudgetDB::ReadResult CBudgetDB::Read(CBudgetManager& objToLoad, bool fDryRun)
+{
+    int64_t nStart = GetTimeMillis();
 
-    // verify stored checksum matches input data
-    uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-    if (hashIn != hashTmp) {
-        error("%s : Checksum mismatch, data corrupted", __func__);
-        return IncorrectHash;
+    std::map<uint256, CBudgetProposal> mapProposals;
+    std::map<uint256, CFinalizedBudget> mapFinalizedBudgets;
+    std::map<uint256, uint256> mapUnconfirmedFeeTx;
+    ImportLegacyFile();
+    if (!ReadObjects(DB_PROPOSAL, DB_PROPOSAL_VOTE, mapProposals) ||
+        !ReadObjects(DB_FINALIZED_BUDGET, DB_FINALIZED_BUDGET_VOTE, mapFinalizedBudgets)) {
+        if (!WipeCacheDB(*this)) error("%s : Failed to wipe budget db", __func__);
+        return IncorrectFormat;
+    }
+    for (auto& it : mapProposals) {
+        it.second.RecountVotes();
     }
+    CDBWrapper::Read(DB_UNCONFIRMED_FEETX, mapUnconfirmedFeeTx);
 
-    int version;
-    std::string strMagicMessageTmp;
-    try {
-        // de-serialize file header
-        ssObj >> version;
-        ssObj >> strMagicMessageTmp;
+    if (mapProposals.empty() && mapFinalizedBudgets.empty() && mapUnconfirmedFeeTx.empty()) {
+        return Empty;
+    }
 
-        // ... verify the message matches predefined one
-        if (strMagicMessage != strMagicMessageTmp) {
-            error("%s : Invalid patriotnode cache magic message", __func__);
-            return IncorrectMagicMessage;
+    {
+        LOCK(objToLoad.cs_proposals);
+        for (const auto& it : mapProposals) {
+            objToLoad.mapFeeTxToProposal.emplace(it.second.GetFeeTXHash(), it.first);
         }
-
-        // de-serialize file header (network specific magic number) and ..
-        std::vector<unsigned char> pchMsgTmp(4);
-        ssObj >> MakeSpan(pchMsgTmp);
-
-        // ... verify the network matches ours
-        if (memcmp(pchMsgTmp.data(), Params().MessageStart(), pchMsgTmp.size()) != 0) {
-            error("%s : Invalid network magic number", __func__);
-            return IncorrectMagicNumber;
+        objToLoad.mapProposals = std::move(mapProposals);
+        objToLoad.InvalidateBudgetCache();
+    }
+    {
+        LOCK(objToLoad.cs_budgets);
+        for (const auto& it : mapFinalizedBudgets) {
+            objToLoad.mapFeeTxToBudget.emplace(it.second.GetFeeTXHash(), it.first);
         }
-
-        // de-serialize data into CBudgetManager object
-        ssObj >> objToLoad;
-    } catch (const std::exception& e) {
-        objToLoad.Clear();
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return IncorrectFormat;
+        objToLoad.mapFinalizedBudgets = std::move(mapFinalizedBudgets);
+        objToLoad.mapUnconfirmedFeeTx = std::move(mapUnconfirmedFeeTx);
     }
 
-    LogPrint(BCLog::PNBUDGET,"Loaded info from budget.dat (dbversion=%d) %dms\n", version, GetTimeMillis() - nStart);
+    LogPrint(BCLog::PNBUDGET,"Loaded info from budget db %dms\n", GetTimeMillis() - nStart);
     LogPrint(BCLog::PNBUDGET,"%s\n", objToLoad.ToString());
     if (!fDryRun) {
         LogPrint(BCLog::PNBUDGET,"Budget manager - cleaning....\n");
@@ -138,9 +286,9 @@ void DumpBudgets(CBudgetManager& budgetman)
 {
     int64_t nStart = GetTimeMillis();
 
-    CBudgetDB budgetdb;
-    LogPrint(BCLog::PNBUDGET,"Writing info to budget.dat...\n");
-    budgetdb.Write(budgetman);
+    if (!pBudgetDB) return;
+    LogPrint(BCLog::PNBUDGET,"Writing changes to budget db...\n");
+    pBudgetDB->Write(budgetman);
 
     LogPrint(BCLog::PNBUDGET,"Budget dump finished  %dms\n", GetTimeMillis() - nStart);
 }
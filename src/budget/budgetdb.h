@@ -7,33 +7,53 @@
 #define BUDGET_DB_H
 
 #include "budget/budgetmanager.h"
+#include "dbwrapper.h"
 #include "fs.h"
 
 void DumpBudgets(CBudgetManager& budgetman);
 
+/** Read the payload of a cache file in the old flat format (budget.dat, mnpayments.dat),
+ * after checking its checksum, magic message and network. Returns false if it can't be used.
+ */
+bool ReadLegacyCacheFile(const fs::path& pathDB, const std::string& strMagicMessage, CDataStream& ssObj);
+
+/** Erase all the records of a cache db (budget/, mnpayments/), so that a record that can't be read
+ * doesn't fail every following load. The data is synced again from the network.
+ */
+bool WipeCacheDB(CDBWrapper& db);
 
-/** Save Budget Manager (budget.dat)
+/** Save Budget Manager (budget/ leveldb)
+ * One record per proposal and per finalized budget, and one per vote, keyed by the object hash
+ * and the voter collateral. Write only stores the objects and votes changed since the last write.
  */
-class CBudgetDB
+class CBudgetDB : public CDBWrapper
 {
 private:
-    fs::path pathDB;
-    std::string strMagicMessage;
+    // Add to the batch the objects with the given hashes, replacing all their votes (erasing the missing ones)
+    template <typename T>
+    void WriteObjects(CDBBatch& batch, char prefix, char votePrefix, const std::set<uint256>& setHashes, const std::map<uint256, T>& mapObjects);
+    // Add to the batch the given votes (erasing the missing ones)
+    template <typename T>
+    void WriteVotes(CDBBatch& batch, char votePrefix, const std::set<std::pair<uint256, COutPoint>>& setVotes, const std::map<uint256, T>& mapObjects);
+    // Load all the objects, with their votes
+    template <typename T>
+    bool ReadObjects(char prefix, char votePrefix, std::map<uint256, T>& mapObjects);
+
+    // Import budget.dat, written by older versions, and remove it
+    void ImportLegacyFile();
 
 public:
     enum ReadResult {
         Ok,
-        FileError,
-        HashReadError,
-        IncorrectHash,
-        IncorrectMagicMessage,
-        IncorrectMagicNumber,
+        Empty,
         IncorrectFormat
     };
 
-    CBudgetDB();
-    bool Write(const CBudgetManager& objToSave);
+    CBudgetDB(bool fMemory = false, bool fWipe = false);
+    bool Write(CBudgetManager& objToSave);
     ReadResult Read(CBudgetManager& objToLoad, bool fDryRun = false);
 };
 
+extern std::unique_ptr<CBudgetDB> pBudgetDB;
+
 #endif // BUDGET_DB_H
@@ -263,6 +263,7 @@ void CBudgetManager::ForceAddFinalizedBudget(const uint256& nHash, const uint256
 {
     LOCK(cs_budgets);
     mapFinalizedBudgets.emplace(nHash, finalizedBudget);
+    setDirtyBudgets.emplace(nHash);
     // Add to feeTx index
     mapFeeTxToBudget.emplace(feeTxId, nHash);
     // Remove the budget from the unconfirmed map, if it was there
@@ -301,17 +302,22 @@ bool CBudgetManager::AddProposal(CBudgetProposal& budgetProposal)
         return false;
     }
 
-    {
-        LOCK(cs_proposals);
-        mapProposals.emplace(nHash, budgetProposal);
-        // Add to feeTx index
-        mapFeeTxToProposal.emplace(feeTxId, nHash);
-    }
+    ForceAddProposal(nHash, feeTxId, budgetProposal);
     LogPrint(BCLog::PNBUDGET,"%s: budget proposal %s [%s] added\n", __func__, nHash.ToString(), budgetProposal.GetName());
 
     return true;
 }
 
+void CBudgetManager::ForceAddProposal(const uint256& nHash, const uint256& feeTxId, const CBudgetProposal& budgetProposal)
+{
+    LOCK(cs_proposals);
+    mapProposals.emplace(nHash, budgetProposal);
+    // Add to feeTx index
+    mapFeeTxToProposal.emplace(feeTxId, nHash);
+    setDirtyProposals.emplace(nHash);
+    InvalidateBudgetCache();
+}
+
 void CBudgetManager::CheckAndRemove()
 {
     int nCurrentHeight = GetBestHeight();
@@ -324,16 +330,22 @@ void CBudgetManager::CheckAndRemove()
         LogPrint(BCLog::PNBUDGET, "%s: mapProposals cleanup - size before: %d\n", __func__, mapProposals.size());
         for (auto& it: mapProposals) {
             CBudgetProposal* pbudgetProposal = &(it.second);
-            if (!pbudgetProposal->UpdateValid(nCurrentHeight)) {
+            const bool fWasValid = pbudgetProposal->IsValid();
+            if (pbudgetProposal->UpdateValid(nCurrentHeight) != fWasValid) {
+                nProposalValidityGen++;
+            }
+            if (!pbudgetProposal->IsValid()) {
                 LogPrint(BCLog::PNBUDGET,"%s: Invalid budget proposal %s %s\n", __func__, (it.first).ToString(), pbudgetProposal->IsInvalidLogStr());
                 mapFeeTxToProposal.erase(pbudgetProposal->GetFeeTXHash());
+                setDirtyProposals.emplace(it.first);
             } else {
                  LogPrint(BCLog::PNBUDGET,"%s: Found valid budget proposal: %s %s\n", __func__,
                           pbudgetProposal->GetName(), pbudgetProposal->GetFeeTXHash().ToString());
                  tmpMapProposals.emplace(pbudgetProposal->GetHash(), *pbudgetProposal);
             }
         }
-        // Remove invalid entries by overwriting complete map
+        // Remove invalid entries by overwriting complete map.
+        // Those were not ranked by GetBudget, unless they just became invalid.
         mapProposals.swap(tmpMapProposals);
         LogPrint(BCLog::PNBUDGET, "%s: mapProposals cleanup - size after: %d\n", __func__, mapProposals.size());
     }
@@ -347,6 +359,7 @@ void CBudgetManager::CheckAndRemove()
             if (!pfinalizedBudget->UpdateValid(nCurrentHeight)) {
                 LogPrint(BCLog::PNBUDGET,"%s: Invalid finalized budget %s %s\n", __func__, (it.first).ToString(), pfinalizedBudget->IsInvalidLogStr());
                 mapFeeTxToBudget.erase(pfinalizedBudget->GetFeeTXHash());
+                setDirtyBudgets.emplace(it.first);
             } else {
                 LogPrint(BCLog::PNBUDGET,"%s: Found valid finalized budget: %s %s\n", __func__,
                           pfinalizedBudget->GetName(), pfinalizedBudget->GetFeeTXHash().ToString());
@@ -382,6 +395,8 @@ void CBudgetManager::RemoveByFeeTxId(const uint256& feeTxId)
                 }
                 // Erase proposal object
                 mapProposals.erase(it->second);
+                setDirtyProposals.emplace(it->second);
+                InvalidateBudgetCache();
             }
             // Remove from collateral index
             mapFeeTxToProposal.erase(it);
@@ -407,6 +422,7 @@ void CBudgetManager::RemoveByFeeTxId(const uint256& feeTxId)
                 }
                 // Erase finalized budget object
                 mapFinalizedBudgets.erase(it->second);
+                setDirtyBudgets.emplace(it->second);
             }
             // Remove from collateral index
             mapFeeTxToBudget.erase(it);
@@ -690,7 +706,7 @@ std::vector<CBudgetProposal*> CBudgetManager::GetAllProposals()
 
     for (auto& it: mapProposals) {
         CBudgetProposal* pbudgetProposal = &(it.second);
-        RemoveStaleVotesOnProposal(pbudgetProposal);
+        if (RemoveStaleVotesOnProposal(pbudgetProposal)) InvalidateBudgetCache();
         vBudgetProposalRet.push_back(pbudgetProposal);
     }
 
@@ -707,6 +723,14 @@ std::vector<CBudgetProposal> CBudgetManager::GetBudget()
     if (nHeight <= 0)
         return {};
 
+    // The ranking changes only with the tip, the enabled patriotnodes, the proposals,
+    // their validity and their votes
+    const int mnCount = mnodeman.CountEnabled(ActiveProtocol());
+    if (cachedBudget.nHeight == nHeight && cachedBudget.nCountEnabled == mnCount &&
+            cachedBudget.nValidityGen == nProposalValidityGen && GetAdjustedTime() < cachedBudget.nExpiryTime) {
+        return cachedBudget.vProposals;
+    }
+
     // ------- Sort budgets by net Yes Count
     std::vector<CBudgetProposal*> vBudgetPorposalsSort;
     for (auto& it: mapProposals) {
@@ -722,10 +746,14 @@ std::vector<CBudgetProposal> CBudgetManager::GetBudget()
     const int nBlocksPerCycle = Params().GetConsensus().nBudgetCycleBlocks;
     int nBlockStart = nHeight - nHeight % nBlocksPerCycle + nBlocksPerCycle;
     int nBlockEnd = nBlockStart + nBlocksPerCycle - 1;
-    int mnCount = mnodeman.CountEnabled(ActiveProtocol());
     CAmount nTotalBudget = GetTotalBudget(nBlockStart);
+    const int64_t nEstablishmentTime = Params().GetConsensus().nProposalEstablishmentTime;
+    int64_t nExpiryTime = std::numeric_limits<int64_t>::max();
 
     for (CBudgetProposal* pbudgetProposal: vBudgetPorposalsSort) {
+        if (!pbudgetProposal->IsEstablished()) {
+            nExpiryTime = std::min(nExpiryTime, pbudgetProposal->nTime + nEstablishmentTime);
+        }
         LogPrint(BCLog::PNBUDGET,"%s: Processing Budget %s\n", __func__, pbudgetProposal->GetName());
         //prop start/end should be inside this period
         if (pbudgetProposal->IsPassing(nBlockStart, nBlockEnd, mnCount)) {
@@ -746,12 +774,17 @@ std::vector<CBudgetProposal> CBudgetManager::GetBudget()
         } else {
             LogPrint(BCLog::PNBUDGET,"%s:  -   Check 1 failed: valid=%d | %ld <= %ld | %ld >= %ld | Yeas=%d Nays=%d Count=%d | established=%d\n",
                     __func__, pbudgetProposal->IsValid(), pbudgetProposal->GetBlockStart(), nBlockStart, pbudgetProposal->GetBlockEnd(),
-                    nBlockEnd, pbudgetProposal->GetYeas(), pbudgetProposal->GetNays(), mnodeman.CountEnabled(ActiveProtocol()) / 10,
+                    nBlockEnd, pbudgetProposal->GetYeas(), pbudgetProposal->GetNays(), mnCount / 10,
                     pbudgetProposal->IsEstablished());
         }
 
     }
 
+    cachedBudget.nHeight = nHeight;
+    cachedBudget.nCountEnabled = mnCount;
+    cachedBudget.nValidityGen = nProposalValidityGen;
+    cachedBudget.nExpiryTime = nExpiryTime;
+    cachedBudget.vProposals = vBudgetProposalsRet;
     return vBudgetProposalsRet;
 }
 
@@ -820,28 +853,30 @@ void CBudgetManager::AddSeenFinalizedBudgetVote(const CFinalizedBudgetVote& vote
     mapSeenFinalizedBudgetVotes.emplace(vote.GetHash(), vote);
 }
 
-void CBudgetManager::RemoveStaleVotesOnProposal(CBudgetProposal* prop)
+bool CBudgetManager::RemoveStaleVotesOnProposal(CBudgetProposal* prop)
 {
     AssertLockHeld(cs_proposals);
     LogPrint(BCLog::PNBUDGET, "Cleaning proposal votes for %s. Before: YES=%d, NO=%d\n",
             prop->GetName(), prop->GetYeas(), prop->GetNays());
 
+    bool fChanged = false;
+    auto mnList = deterministicPNManager->GetListAtChainTip();
     auto it = prop->mapVotes.begin();
     while (it != prop->mapVotes.end()) {
-        auto mnList = deterministicPNManager->GetListAtChainTip();
         auto dmn = mnList.GetPNByCollateral(it->first);
         if (dmn) {
-            (*it).second.SetValid(mnList.IsPNValid(dmn));
+            fChanged |= prop->SetVoteValid(it->second, mnList.IsPNValid(dmn));
         } else {
             // -- Legacy System (!TODO: remove after enforcement) --
-            CPatriotnode* pmn = mnodeman.Find(it->first);
-            (*it).second.SetValid(pmn && pmn->IsEnabled());
+            PatriotnodeRef pmn = mnodeman.Find(it->first);
+            fChanged |= prop->SetVoteValid(it->second, pmn && pmn->IsEnabled());
         }
         ++it;
     }
 
     LogPrint(BCLog::PNBUDGET, "Cleaned proposal votes for %s. After: YES=%d, NO=%d\n",
             prop->GetName(), prop->GetYeas(), prop->GetNays());
+    return fChanged;
 }
 
 void CBudgetManager::RemoveStaleVotesOnFinalBudget(CFinalizedBudget* fbud)
@@ -850,15 +885,15 @@ void CBudgetManager::RemoveStaleVotesOnFinalBudget(CFinalizedBudget* fbud)
     LogPrint(BCLog::PNBUDGET, "Cleaning finalized budget votes for [%s (%s)]. Before: %d\n",
             fbud->GetName(), fbud->GetProposalsStr(), fbud->GetVoteCount());
 
+    auto mnList = deterministicPNManager->GetListAtChainTip();
     auto it = fbud->mapVotes.begin();
     while (it != fbud->mapVotes.end()) {
-        auto mnList = deterministicPNManager->GetListAtChainTip();
         auto dmn = mnList.GetPNByCollateral(it->first);
         if (dmn) {
             (*it).second.SetValid(mnList.IsPNValid(dmn));
         } else {
             // -- Legacy System (!TODO: remove after enforcement) --
-            CPatriotnode* pmn = mnodeman.Find(it->first);
+            PatriotnodeRef pmn = mnodeman.Find(it->first);
             (*it).second.SetValid(pmn && pmn->IsEnabled());
         }
         ++it;
@@ -955,9 +990,11 @@ void CBudgetManager::NewBlock()
     {
         LOCK(cs_proposals);
         LogPrint(BCLog::PNBUDGET,"%s:  mapProposals cleanup - size: %d\n", __func__, mapProposals.size());
+        bool fChanged = false;
         for (auto& it: mapProposals) {
-            RemoveStaleVotesOnProposal(&it.second);
+            fChanged |= RemoveStaleVotesOnProposal(&it.second);
         }
+        if (fChanged) InvalidateBudgetCache();
     }
     {
         LOCK(cs_budgets);
@@ -1072,7 +1109,7 @@ bool CBudgetManager::ProcessProposalVote(CBudgetVote& vote, CNode* pfrom, CValid
 
     // -- Legacy System (!TODO: remove after enforcement) --
 
-    CPatriotnode* pmn = mnodeman.Find(voteVin.prevout);
+    PatriotnodeRef pmn = mnodeman.Find(voteVin.prevout);
     if (!pmn) {
         err = strprintf("unknown patriotnode - vin: %s", voteVin.prevout.ToString());
         // Ask for PN only if we finished syncing the PN list.
@@ -1172,7 +1209,7 @@ bool CBudgetManager::ProcessFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNod
     }
 
     // -- Legacy System (!TODO: remove after enforcement) --
-    CPatriotnode* pmn = mnodeman.Find(voteVin.prevout);
+    PatriotnodeRef pmn = mnodeman.Find(voteVin.prevout);
     if (!pmn) {
         err = strprintf("unknown patriotnode - vin: %s", voteVin.prevout.ToString());
         // Ask for PN only if we finished syncing the PN list.
@@ -1395,7 +1432,12 @@ bool CBudgetManager::UpdateProposal(const CBudgetVote& vote, CNode* pfrom, std::
     }
 
 
-    return mapProposals[nProposalHash].AddOrUpdateVote(vote, strError);
+    if (!mapProposals[nProposalHash].AddOrUpdateVote(vote, strError)) {
+        return false;
+    }
+    setDirtyProposalVotes.emplace(nProposalHash, vote.GetVin().prevout);
+    InvalidateBudgetCache();
+    return true;
 }
 
 bool CBudgetManager::UpdateFinalizedBudget(CFinalizedBudgetVote& vote, CNode* pfrom, std::string& strError)
@@ -1422,7 +1464,11 @@ bool CBudgetManager::UpdateFinalizedBudget(CFinalizedBudgetVote& vote, CNode* pf
         return false;
     }
     LogPrint(BCLog::PNBUDGET,"%s: Finalized Proposal %s added\n", __func__, nBudgetHash.ToString());
-    return mapFinalizedBudgets[nBudgetHash].AddOrUpdateVote(vote, strError);
+    if (!mapFinalizedBudgets[nBudgetHash].AddOrUpdateVote(vote, strError)) {
+        return false;
+    }
+    setDirtyBudgetVotes.emplace(nBudgetHash, vote.GetVin().prevout);
+    return true;
 }
 
 std::string CBudgetManager::ToString() const
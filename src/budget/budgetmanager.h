@@ -10,6 +10,9 @@
 #include "budget/finalizedbudget.h"
 #include "validationinterface.h"
 
+#include <limits>
+
+class CBudgetDB;
 class CValidationState;
 
 //
@@ -18,6 +21,8 @@ class CValidationState;
 class CBudgetManager : public CValidationInterface
 {
 protected:
+    friend class CBudgetDB;
+
     // map budget hash --> CollTx hash.
     // hold unconfirmed finalized-budgets collateral txes until they mature enough to use
     std::map<uint256, uint256> mapUnconfirmedFeeTx;                         // guarded by cs_budgets
@@ -38,6 +43,29 @@ protected:
     // Memory Only. Updated in NewBlock (blocks arrive in order)
     std::atomic<int> nBestHeight;
 
+    // Memory Only. Ranked budget returned by GetBudget, for the height nHeight, the count of
+    // enabled patriotnodes and the proposal validity generation it was computed with.
+    // Reset when a proposal, or the validity of a vote, changes.
+    struct BudgetCache {
+        int nHeight{-1};
+        int nCountEnabled{-1};
+        uint64_t nValidityGen{0};
+        // time when a proposal, not established yet, becomes established
+        int64_t nExpiryTime{std::numeric_limits<int64_t>::max()};
+        std::vector<CBudgetProposal> vProposals;
+    };
+    BudgetCache cachedBudget;                                               // guarded by cs_proposals
+    void InvalidateBudgetCache() { AssertLockHeld(cs_proposals); cachedBudget = BudgetCache(); }
+    // Memory Only. Increased when UpdateValid changes the validity of a proposal in mapProposals
+    uint64_t nProposalValidityGen{0};                                       // guarded by cs_proposals
+
+    // Memory Only. Objects added or removed since the last write to the budget db
+    std::set<uint256> setDirtyProposals;                                    // guarded by cs_proposals
+    std::set<uint256> setDirtyBudgets;                                      // guarded by cs_budgets
+    // Memory Only. Votes (object hash, voter collateral) added or updated since the last write
+    std::set<std::pair<uint256, COutPoint>> setDirtyProposalVotes;          // guarded by cs_proposals
+    std::set<std::pair<uint256, COutPoint>> setDirtyBudgetVotes;            // guarded by cs_budgets
+
     // Spam protection
     // who's asked for the complete budget sync and the last time
     std::map<CNetAddr, int64_t> mAskedUsForBudgetSync; // guarded by cs_budgets and cs_proposals.
@@ -75,7 +103,8 @@ public:
     void AddSeenProposalVote(const CBudgetVote& vote);
     void AddSeenFinalizedBudgetVote(const CFinalizedBudgetVote& vote);
 
-    void RemoveStaleVotesOnProposal(CBudgetProposal* prop);
+    // Returns true if the validity of any vote changed
+    bool RemoveStaleVotesOnProposal(CBudgetProposal* prop);
     void RemoveStaleVotesOnFinalBudget(CFinalizedBudget* fbud);
 
     // Use const operator std::map::at(), thus existence must be checked before calling.
@@ -128,6 +157,7 @@ public:
     bool IsBudgetPaymentBlock(int nBlockHeight) const;
     bool IsBudgetPaymentBlock(int nBlockHeight, int& nCountThreshold) const;
     bool AddProposal(CBudgetProposal& budgetProposal);
+    void ForceAddProposal(const uint256& nHash, const uint256& feeTxId, const CBudgetProposal& budgetProposal);
     bool AddFinalizedBudget(CFinalizedBudget& finalizedBudget, CNode* pfrom = nullptr);
     void ForceAddFinalizedBudget(const uint256& nHash, const uint256& feeTxId, const CFinalizedBudget& finalizedBudget);
     uint256 SubmitFinalBudget();
@@ -146,11 +176,14 @@ public:
     {
         {
             LOCK(cs_proposals);
+            for (const auto& it : mapProposals) setDirtyProposals.emplace(it.first);
             mapProposals.clear();
             mapFeeTxToProposal.clear();
+            InvalidateBudgetCache();
         }
         {
             LOCK(cs_budgets);
+            for (const auto& it : mapFinalizedBudgets) setDirtyBudgets.emplace(it.first);
             mapFinalizedBudgets.clear();
             mapFeeTxToBudget.clear();
             mapUnconfirmedFeeTx.clear();
@@ -177,26 +210,6 @@ public:
 
     // Remove proposal/budget by FeeTx (called when a block is disconnected)
     void RemoveByFeeTxId(const uint256& feeTxId);
-
-    SERIALIZE_METHODS(CBudgetManager, obj)
-    {
-        {
-            LOCK(obj.cs_proposals);
-            READWRITE(obj.mapProposals, obj.mapFeeTxToProposal);
-        }
-        {
-            LOCK(obj.cs_votes);
-            READWRITE(obj.mapSeenProposalVotes, obj.mapOrphanProposalVotes);
-        }
-        {
-            LOCK(obj.cs_budgets);
-            READWRITE(obj.mapFinalizedBudgets, obj.mapFeeTxToBudget, obj.mapUnconfirmedFeeTx);
-        }
-        {
-            LOCK(obj.cs_finalizedvotes);
-            READWRITE(obj.mapSeenFinalizedBudgetVotes, obj.mapOrphanFinalizedBudgetVotes);
-        }
-    }
 };
 
 extern CBudgetManager g_budgetman;
@@ -11,6 +11,9 @@ CBudgetProposal::CBudgetProposal():
         nAllotted(0),
         fValid(true),
         strInvalid(""),
+        nYeas(0),
+        nNays(0),
+        nAbstains(0),
         strProposalName("unknown"),
         strURL(""),
         nBlockStart(0),
@@ -31,6 +34,9 @@ CBudgetProposal::CBudgetProposal(const std::string& name,
         nAllotted(0),
         fValid(true),
         strInvalid(""),
+        nYeas(0),
+        nNays(0),
+        nAbstains(0),
         strProposalName(name),
         strURL(url),
         nBlockStart(blockstart),
@@ -218,8 +224,9 @@ bool CBudgetProposal::AddOrUpdateVote(const CBudgetVote& vote, std::string& strE
     const COutPoint& mnId = vote.GetVin().prevout;
     const int64_t voteTime = vote.GetTime();
 
-    if (mapVotes.count(mnId)) {
-        const int64_t& oldTime = mapVotes[mnId].GetTime();
+    auto it = mapVotes.find(mnId);
+    if (it != mapVotes.end()) {
+        const int64_t& oldTime = it->second.GetTime();
         if (oldTime > voteTime) {
             strError = strprintf("new vote older than existing vote - %s\n", vote.GetHash().ToString());
             LogPrint(BCLog::PNBUDGET, "%s: %s\n", __func__, strError);
@@ -240,7 +247,13 @@ bool CBudgetProposal::AddOrUpdateVote(const CBudgetVote& vote, std::string& strE
         return false;
     }
 
-    mapVotes[mnId] = vote;
+    if (it != mapVotes.end()) {
+        UpdateTally(it->second, -1);
+        it->second = vote;
+    } else {
+        mapVotes.emplace(mnId, vote);
+    }
+    UpdateTally(vote, 1);
     LogPrint(BCLog::PNBUDGET, "%s: %s %s\n", __func__, strAction.c_str(), vote.GetHash().ToString().c_str());
 
     return true;
@@ -279,13 +292,39 @@ double CBudgetProposal::GetRatio() const
 
 int CBudgetProposal::GetVoteCount(CBudgetVote::VoteDirection vd) const
 {
-    int ret = 0;
+    switch (vd) {
+        case CBudgetVote::VOTE_YES: return nYeas;
+        case CBudgetVote::VOTE_NO: return nNays;
+        case CBudgetVote::VOTE_ABSTAIN: return nAbstains;
+    }
+    return 0;
+}
+
+void CBudgetProposal::UpdateTally(const CBudgetVote& vote, int nDelta)
+{
+    if (!vote.IsValid()) return;
+    switch (vote.GetDirection()) {
+        case CBudgetVote::VOTE_YES: nYeas += nDelta; break;
+        case CBudgetVote::VOTE_NO: nNays += nDelta; break;
+        case CBudgetVote::VOTE_ABSTAIN: nAbstains += nDelta; break;
+    }
+}
+
+void CBudgetProposal::RecountVotes()
+{
+    nYeas = nNays = nAbstains = 0;
     for (const auto& it : mapVotes) {
-        const CBudgetVote& vote = it.second;
-        if (vote.GetDirection() == vd && vote.IsValid())
-            ret++;
+        UpdateTally(it.second, 1);
     }
-    return ret;
+}
+
+bool CBudgetProposal::SetVoteValid(CBudgetVote& vote, bool fValidIn)
+{
+    if (vote.IsValid() == fValidIn) return false;
+    UpdateTally(vote, -1);
+    vote.SetValid(fValidIn);
+    UpdateTally(vote, 1);
+    return true;
 }
 
 std::vector<uint256> CBudgetProposal::GetVotesHashes() const
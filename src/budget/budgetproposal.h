@@ -24,10 +24,15 @@ class CBudgetManager;
 class CBudgetProposal
 {
 private:
+    friend class CBudgetDB;
     friend class CBudgetManager;
     CAmount nAllotted;
     bool fValid;
     std::string strInvalid;
+    // Running count of the valid votes, for each direction
+    int nYeas;
+    int nNays;
+    int nAbstains;
 
     // Functions used inside UpdateValid()/IsWellFormed - setting strInvalid
     bool IsHeavilyDownvoted(bool fNewRules);
@@ -36,6 +41,13 @@ private:
     bool CheckAmount(const CAmount& nTotalBudget);
     bool CheckAddress();
 
+    // Add nDelta to the tally of the vote direction (if the vote is valid)
+    void UpdateTally(const CBudgetVote& vote, int nDelta);
+    // Recompute the tallies from mapVotes
+    void RecountVotes();
+    // Set the validity of a vote in mapVotes, updating the tallies. Returns true if it changed.
+    bool SetVoteValid(CBudgetVote& vote, bool fValidIn);
+
 protected:
     std::map<COutPoint, CBudgetVote> mapVotes;
     std::string strProposalName;
@@ -86,9 +98,9 @@ public:
     double GetRatio() const;
     int GetVoteCount(CBudgetVote::VoteDirection vd) const;
     std::vector<uint256> GetVotesHashes() const;
-    int GetYeas() const { return GetVoteCount(CBudgetVote::VOTE_YES); }
-    int GetNays() const { return GetVoteCount(CBudgetVote::VOTE_NO); }
-    int GetAbstains() const { return GetVoteCount(CBudgetVote::VOTE_ABSTAIN); };
+    int GetYeas() const { return nYeas; }
+    int GetNays() const { return nNays; }
+    int GetAbstains() const { return nAbstains; };
     CAmount GetAmount() const { return nAmount; }
     void SetAllotted(CAmount nAllottedIn) { nAllotted = nAllottedIn; }
     CAmount GetAllotted() const { return nAllotted; }
@@ -117,6 +129,7 @@ public:
         READWRITE(obj.nFeeTXHash);
         READWRITE(obj.nTime);
         READWRITE(obj.mapVotes);
+        SER_READ(obj, obj.RecountVotes());
     }
 
     // Serialization for network messages.
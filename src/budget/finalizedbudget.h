@@ -30,6 +30,7 @@ enum class TrxValidationStatus {
 class CFinalizedBudget
 {
 private:
+    friend class CBudgetDB;
     friend class CBudgetManager;
 
     bool fAutoChecked; //If it matches what we see, we'll auto vote for it (patriotnode only)
@@ -125,6 +125,11 @@ public:
         assert(consensus.hashGenesisBlock == uint256S("0x0000c65dcc82b25425fce3c74a342ca4107e6b60dc31015ad42c1c07281b80f8"));
         assert(genesis.hashMerkleRoot == uint256S("0xa193048829b780828ef6c4f0dcb2adb8035843586d2e2dbe73de7e5e5b383663"));
 
+        // !TODO: placeholder, update at each release to a recent block past the last checkpoint.
+        // This is the last checkpoint (see mapCheckpoints), whose scripts are not checked anyway,
+        // so until then the default -assumevalid skips nothing more than the checkpoints do.
+        consensus.defaultAssumeValid = uint256S("0x95e4bea99cd0c55b70f2900c6907241e5e2010c641bde7724efbc942009f418f"); // 1260000
+
         consensus.fPowAllowMinDifficultyBlocks = false;
         consensus.fPowNoRetargeting = false;
         consensus.powLimit   = uint256S("0x0002ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
@@ -273,6 +278,8 @@ public:
         assert(consensus.hashGenesisBlock == uint256S("0x0000041e482b9b9691d98eefb48473405c0b8ec31b76df3797c74a78680ef818"));
         assert(genesis.hashMerkleRoot == uint256S("0x1b2ef6e2f28be914103a277377ae7729dcd125dfeb8bf97bd5964ba72b6dc39b"));
 
+        consensus.defaultAssumeValid = UINT256_ZERO;
+
         consensus.fPowAllowMinDifficultyBlocks = true;
         consensus.fPowNoRetargeting = false;
         consensus.powLimit   = uint256S("0x00000fffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
@@ -398,6 +405,8 @@ public:
         assert(consensus.hashGenesisBlock == uint256S("0x7445589c4c8e52b105247b13373e5ee325856aa05d53f429e59ea46b7149ae3f"));
         assert(genesis.hashMerkleRoot == uint256S("0x1b2ef6e2f28be914103a277377ae7729dcd125dfeb8bf97bd5964ba72b6dc39b"));
 
+        consensus.defaultAssumeValid = UINT256_ZERO;
+
         consensus.fPowAllowMinDifficultyBlocks = true;
         consensus.fPowNoRetargeting = true;
         consensus.powLimit   = uint256S("0x7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
@@ -89,6 +89,8 @@ struct NetworkUpgrade {
  */
 struct Params {
     uint256 hashGenesisBlock;
+    /** By default assume that the scripts in ancestors of this block are valid (see -assumevalid) */
+    uint256 defaultAssumeValid;
     bool fPowAllowMinDifficultyBlocks;
     bool fPowNoRetargeting;
     uint256 powLimit;
@@ -21,8 +21,7 @@
 
 #include <univalue.h>
 
-static const std::string DB_LIST_SNAPSHOT = "dmn_S";
-static const std::string DB_LIST_DIFF = "dmn_D";
+#include <algorithm>
 
 std::unique_ptr<CDeterministicPNManager> deterministicPNManager;
 
@@ -202,55 +201,51 @@ static int CompareByLastPaidGetHeight(const CDeterministicPN& dmn)
     return height;
 }
 
-static bool CompareByLastPaid(const CDeterministicPN& _a, const CDeterministicPN& _b)
+CDeterministicPNList::PaymentOrderKey CDeterministicPNList::GetPaymentOrderKey(const CDeterministicPN& dmn)
 {
-    int ah = CompareByLastPaidGetHeight(_a);
-    int bh = CompareByLastPaidGetHeight(_b);
-    if (ah == bh) {
-        return _a.proTxHash < _b.proTxHash;
-    } else {
-        return ah < bh;
+    // Least recently paid first, ties broken by proTxHash
+    return std::make_pair(CompareByLastPaidGetHeight(dmn), dmn.proTxHash);
+}
+
+void CDeterministicPNList::AddToPaymentOrder(const CDeterministicPNCPtr& dmn)
+{
+    if (!IsPNValid(dmn)) {
+        return;
     }
+    const PaymentOrderKey key = GetPaymentOrderKey(*dmn);
+    auto it = std::lower_bound(mnPaymentOrder.begin(), mnPaymentOrder.end(), key);
+    assert(it == mnPaymentOrder.end() || *it != key);
+    mnPaymentOrder = mnPaymentOrder.insert(it - mnPaymentOrder.begin(), key);
 }
-static bool CompareByLastPaid(const CDeterministicPNCPtr& _a, const CDeterministicPNCPtr& _b)
+
+void CDeterministicPNList::RemoveFromPaymentOrder(const CDeterministicPNCPtr& dmn)
 {
-    return CompareByLastPaid(*_a, *_b);
+    if (!IsPNValid(dmn)) {
+        return;
+    }
+    const PaymentOrderKey key = GetPaymentOrderKey(*dmn);
+    auto it = std::lower_bound(mnPaymentOrder.begin(), mnPaymentOrder.end(), key);
+    assert(it != mnPaymentOrder.end() && *it == key);
+    mnPaymentOrder = mnPaymentOrder.erase(it - mnPaymentOrder.begin());
 }
 
 CDeterministicPNCPtr CDeterministicPNList::GetPNPayee() const
 {
-    if (mnMap.size() == 0) {
+    if (mnPaymentOrder.empty()) {
         return nullptr;
     }
-
-    CDeterministicPNCPtr best;
-    ForEachPN(true, [&](const CDeterministicPNCPtr& dmn) {
-        if (!best || CompareByLastPaid(dmn, best)) {
-            best = dmn;
-        }
-    });
-
-    return best;
+    return GetPN(mnPaymentOrder.front().second);
 }
 
 std::vector<CDeterministicPNCPtr> CDeterministicPNList::GetProjectedPNPayees(unsigned int nCount) const
 {
-    if (nCount > GetValidPNsCount()) {
-        nCount = GetValidPNsCount();
-    }
+    nCount = std::min<size_t>(nCount, mnPaymentOrder.size());
 
     std::vector<CDeterministicPNCPtr> result;
     result.reserve(nCount);
-
-    ForEachPN(true, [&](const CDeterministicPNCPtr& dmn) {
-        result.emplace_back(dmn);
-    });
-    std::sort(result.begin(), result.end(), [&](const CDeterministicPNCPtr& a, const CDeterministicPNCPtr& b) {
-        return CompareByLastPaid(a, b);
-    });
-
-    result.resize(nCount);
-
+    for (auto it = mnPaymentOrder.begin(); result.size() < nCount; ++it) {
+        result.emplace_back(GetPN(it->second));
+    }
     return result;
 }
 
@@ -433,6 +428,7 @@ void CDeterministicPNList::AddPN(const CDeterministicPNCPtr& dmn, bool fBumpTota
 
     mnMap = mnMap.set(dmn->proTxHash, dmn);
     mnInternalIdMap = mnInternalIdMap.set(dmn->GetInternalId(), dmn->proTxHash);
+    AddToPaymentOrder(dmn);
     AddUniqueProperty(dmn, dmn->collateralOutpoint);
     if (dmn->pdmnState->addr != CService()) {
         AddUniqueProperty(dmn, dmn->pdmnState->addr);
@@ -459,6 +455,11 @@ void CDeterministicPNList::UpdatePN(const CDeterministicPNCPtr& oldDmn, const CD
     dmn->pdmnState = pdmnState;
     mnMap = mnMap.set(oldDmn->proTxHash, dmn);
 
+    if (IsPNValid(oldDmn) != IsPNValid(dmn) || GetPaymentOrderKey(*oldDmn) != GetPaymentOrderKey(*dmn)) {
+        RemoveFromPaymentOrder(oldDmn);
+        AddToPaymentOrder(dmn);
+    }
+
     UpdateUniqueProperty(dmn, oldState->addr, pdmnState->addr);
     UpdateUniqueProperty(dmn, oldState->keyIDOwner, pdmnState->keyIDOwner);
     UpdateUniqueProperty(dmn, oldState->keyIDOperator, pdmnState->keyIDOperator);
@@ -497,6 +498,7 @@ void CDeterministicPNList::RemovePN(const uint256& proTxHash)
 
     mnMap = mnMap.erase(proTxHash);
     mnInternalIdMap = mnInternalIdMap.erase(dmn->GetInternalId());
+    RemoveFromPaymentOrder(dmn);
 }
 
 CDeterministicPNManager::CDeterministicPNManager(CEvoDB& _evoDb) :
@@ -537,15 +539,17 @@ bool CDeterministicPNManager::ProcessBlock(const CBlock& block, const CBlockInde
         diff = oldList.BuildDiff(newList);
 
         evoDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
+        // the new list shares everything but the diff with the previous one
+        const size_t nDiffBytes = ::GetSerializeSize(diff, PROTOCOL_VERSION);
         if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1) {
             evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
-            mnListsCache.emplace(newList.GetBlockHash(), newList);
+            AddListToCache(newList, nDiffBytes);
             LogPrintf("CDeterministicPNManager::%s -- Wrote snapshot. nHeight=%d, mapCurPNs.allPNsCount=%d\n",
                 __func__, nHeight, newList.GetAllPNsCount());
         }
 
         diff.nHeight = pindex->nHeight;
-        mnListDiffsCache.emplace(pindex->GetBlockHash(), diff);
+        AddDiffToCache(pindex->GetBlockHash(), diff, nDiffBytes);
     } catch (const std::exception& e) {
         LogPrintf("CDeterministicPNManager::%s -- internal error: %s\n", __func__, e.what());
         return _state.DoS(100, false, REJECT_INVALID, "failed-dmn-block");
@@ -585,8 +589,7 @@ bool CDeterministicPNManager::UndoBlock(const CBlock& block, const CBlockIndex*
             prevList = GetListForBlock(pindex->pprev);
         }
 
-        mnListsCache.erase(blockHash);
-        mnListDiffsCache.erase(blockHash);
+        RemoveFromCache(blockHash);
     }
 
     if (diff.HasChanges()) {
@@ -656,7 +659,7 @@ bool CDeterministicPNManager::BuildNewListFromBlock(const CBlock& block, const C
 
             // if the collateral outpoint appears in the legacy patriotnode list, remove the old node
             // !TODO: remove this when the transition to DPN is complete
-            CPatriotnode* old_mn = mnodeman.Find(dmn->collateralOutpoint);
+            PatriotnodeRef old_mn = mnodeman.Find(dmn->collateralOutpoint);
             if (old_mn) {
                 old_mn->SetSpent();
                 mnodeman.CheckAndRemove();
@@ -854,71 +857,98 @@ void CDeterministicPNManager::DecreasePoSePenalties(CDeterministicPNList& mnList
 
 CDeterministicPNList CDeterministicPNManager::GetListForBlock(const CBlockIndex* pindex)
 {
-    LOCK(cs);
-
     // Return early before enforcement
     if (!IsDIP3Enforced(pindex->nHeight)) {
         return {};
     }
 
+    struct DiffToApply {
+        const CBlockIndex* pindex;
+        CDeterministicPNListDiff diff;
+        size_t nBytes;
+    };
+
     CDeterministicPNList snapshot;
-    std::list<const CBlockIndex*> listDiffIndexes;
+    // newest first
+    std::vector<DiffToApply> vDiffs;
 
     while (true) {
-        // try using cache before reading from disk
-        auto itLists = mnListsCache.find(pindex->GetBlockHash());
-        if (itLists != mnListsCache.end()) {
-            snapshot = itLists->second;
-            break;
-        }
+        const uint256& blockHash = pindex->GetBlockHash();
+        {
+            LOCK(cs);
+            // try using cache before reading from disk
+            auto itLists = mnListsCache.find(blockHash);
+            if (itLists != mnListsCache.end()) {
+                snapshot = itLists->second.list;
+                break;
+            }
 
-        if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), snapshot)) {
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
-            break;
+            // no snapshot found yet, check diffs
+            auto itDiffs = mnListDiffsCache.find(blockHash);
+            if (itDiffs != mnListDiffsCache.end()) {
+                vDiffs.push_back({pindex, itDiffs->second.diff, itDiffs->second.nBytes});
+                pindex = pindex->pprev;
+                continue;
+            }
         }
 
-        // no snapshot found yet, check diffs
-        auto itDiffs = mnListDiffsCache.find(pindex->GetBlockHash());
-        if (itDiffs != mnListDiffsCache.end()) {
-            listDiffIndexes.emplace_front(pindex);
-            pindex = pindex->pprev;
-            continue;
+        // not cached, read from disk without holding cs
+        if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, blockHash), snapshot)) {
+            const size_t nBytes = ::GetSerializeSize(snapshot, PROTOCOL_VERSION);
+            WITH_LOCK(cs, AddListToCache(snapshot, nBytes));
+            break;
         }
 
         CDeterministicPNListDiff diff;
-        if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diff)) {
+        if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, blockHash), diff)) {
             // no snapshot and no diff on disk means that it's initial snapshot (empty list)
             // If we get here, then this must be the block before the enforcement of DIP3.
             if (!IsActivationHeight(pindex->nHeight + 1, Params().GetConsensus(), Consensus::UPGRADE_V6_0)) {
                 std::string err = strprintf("No patriotnode list data found for block %s at height %d. "
-                                            "Possible corrupt database.", pindex->GetBlockHash().ToString(), pindex->nHeight);
+                                            "Possible corrupt database.", blockHash.ToString(), pindex->nHeight);
                 throw std::runtime_error(err);
             }
-            snapshot = CDeterministicPNList(pindex->GetBlockHash(), -1, 0);
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            snapshot = CDeterministicPNList(blockHash, -1, 0);
+            WITH_LOCK(cs, AddListToCache(snapshot, sizeof(snapshot)));
             break;
         }
 
         diff.nHeight = pindex->nHeight;
-        mnListDiffsCache.emplace(pindex->GetBlockHash(), std::move(diff));
-        listDiffIndexes.emplace_front(pindex);
+        const size_t nBytes = ::GetSerializeSize(diff, PROTOCOL_VERSION);
+        WITH_LOCK(cs, AddDiffToCache(blockHash, diff, nBytes));
+        vDiffs.push_back({pindex, std::move(diff), nBytes});
         pindex = pindex->pprev;
     }
 
-    for (const auto& diffIndex : listDiffIndexes) {
-        const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash());
-        if (diff.HasChanges()) {
-            snapshot = snapshot.ApplyDiff(diffIndex, diff);
+    // Apply the diffs (on copies, without holding cs), and keep a snapshot every
+    // MEMORY_SNAPSHOT_PERIOD blocks so that later lookups around here only have
+    // a few diffs to apply. A snapshot shares most of its memory with the
+    // previous one, it only accounts for the diffs applied since.
+    std::vector<CachedList> vNewSnapshots;
+    size_t nBytesSinceSnapshot = 0;
+    for (auto it = vDiffs.rbegin(); it != vDiffs.rend(); ++it) {
+        const CBlockIndex* diffIndex = it->pindex;
+        if (it->diff.HasChanges()) {
+            snapshot = snapshot.ApplyDiff(diffIndex, it->diff);
         } else {
             snapshot.SetBlockHash(diffIndex->GetBlockHash());
             snapshot.SetHeight(diffIndex->nHeight);
         }
+        nBytesSinceSnapshot += it->nBytes;
+        if (diffIndex->nHeight % MEMORY_SNAPSHOT_PERIOD == 0) {
+            vNewSnapshots.push_back({snapshot, nBytesSinceSnapshot});
+            nBytesSinceSnapshot = 0;
+        }
     }
 
+    LOCK(cs);
+    for (const auto& p : vNewSnapshots) {
+        AddListToCache(p.list, p.nBytes);
+    }
     if (tipIndex) {
         // always keep a snapshot for the tip
         if (snapshot.GetBlockHash() == tipIndex->GetBlockHash()) {
-            mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
+            AddListToCache(snapshot, nBytesSinceSnapshot);
         } else {
             // !TODO: keep snapshots for yet alive quorums
         }
@@ -929,11 +959,11 @@ CDeterministicPNList CDeterministicPNManager::GetListForBlock(const CBlockIndex*
 
 CDeterministicPNList CDeterministicPNManager::GetListAtChainTip()
 {
-    LOCK(cs);
-    if (!tipIndex) {
+    const CBlockIndex* pindex = WITH_LOCK(cs, return tipIndex;);
+    if (!pindex) {
         return {};
     }
-    return GetListForBlock(tipIndex);
+    return GetListForBlock(pindex);
 }
 
 bool CDeterministicPNManager::IsDIP3Enforced(int nHeight) const
@@ -958,28 +988,80 @@ bool CDeterministicPNManager::LegacyPNObsolete() const
     return LegacyPNObsolete(tipHeight);
 }
 
+void CDeterministicPNManager::AddListToCache(const CDeterministicPNList& list, size_t nBytes)
+{
+    AssertLockHeld(cs);
+    if (mnListsCache.emplace(list.GetBlockHash(), CachedList{list, nBytes}).second) {
+        nCacheBytes += nBytes;
+    }
+}
+
+void CDeterministicPNManager::AddDiffToCache(const uint256& blockHash, const CDeterministicPNListDiff& diff, size_t nBytes)
+{
+    AssertLockHeld(cs);
+    if (mnListDiffsCache.emplace(blockHash, CachedDiff{diff, nBytes}).second) {
+        nCacheBytes += nBytes;
+    }
+}
+
+void CDeterministicPNManager::RemoveFromCache(const uint256& blockHash)
+{
+    AssertLockHeld(cs);
+    auto itLists = mnListsCache.find(blockHash);
+    if (itLists != mnListsCache.end()) {
+        nCacheBytes -= itLists->second.nBytes;
+        mnListsCache.erase(itLists);
+    }
+    auto itDiffs = mnListDiffsCache.find(blockHash);
+    if (itDiffs != mnListDiffsCache.end()) {
+        nCacheBytes -= itDiffs->second.nBytes;
+        mnListDiffsCache.erase(itDiffs);
+    }
+}
+
 void CDeterministicPNManager::CleanupCache(int nHeight)
 {
     AssertLockHeld(cs);
 
-    std::vector<uint256> toDeleteLists;
-    std::vector<uint256> toDeleteDiffs;
+    std::vector<uint256> toDelete;
     for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LIST_DIFFS_CACHE_SIZE < nHeight) {
-            toDeleteLists.emplace_back(p.first);
+        if (p.second.list.GetHeight() + LIST_DIFFS_CACHE_SIZE < nHeight) {
+            toDelete.emplace_back(p.first);
             continue;
         }
         // !TODO: llmq cache cleanup
     }
-    for (const auto& h : toDeleteLists) {
-        mnListsCache.erase(h);
-    }
     for (const auto& p : mnListDiffsCache) {
-        if (p.second.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
-            toDeleteDiffs.emplace_back(p.first);
+        if (p.second.diff.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
+            toDelete.emplace_back(p.first);
         }
     }
-    for (const auto& h : toDeleteDiffs) {
-        mnListDiffsCache.erase(h);
+    for (const auto& h : toDelete) {
+        RemoveFromCache(h);
+    }
+
+    if (nCacheBytes <= MAX_CACHE_BYTES) {
+        return;
+    }
+
+    // Over budget: drop the oldest blocks (except the tip) down to 3/4 of it,
+    // so that this doesn't run again on the next block.
+    std::vector<std::pair<int, uint256>> vByHeight;
+    vByHeight.reserve(mnListsCache.size() + mnListDiffsCache.size());
+    for (const auto& p : mnListsCache) {
+        vByHeight.emplace_back(p.second.list.GetHeight(), p.first);
+    }
+    for (const auto& p : mnListDiffsCache) {
+        vByHeight.emplace_back(p.second.diff.nHeight, p.first);
+    }
+    std::sort(vByHeight.begin(), vByHeight.end());
+    for (const auto& p : vByHeight) {
+        if (nCacheBytes <= MAX_CACHE_BYTES / 4 * 3) {
+            break;
+        }
+        if (tipIndex && p.second == tipIndex->GetBlockHash()) {
+            continue;
+        }
+        RemoveFromCache(p.second);
     }
 }
@@ -13,6 +13,7 @@
 #include "saltedhasher.h"
 #include "sync.h"
 
+#include <immer/flex_vector.hpp>
 #include <immer/map.hpp>
 #include <immer/map_transient.hpp>
 
@@ -22,6 +23,10 @@ class CBlock;
 class CBlockIndex;
 class CValidationState;
 
+// evoDb keys of the list snapshots and of the per-block list diffs
+static const std::string DB_LIST_SNAPSHOT = "dmn_S";
+static const std::string DB_LIST_DIFF = "dmn_D";
+
 class CDeterministicPNState
 {
 public:
@@ -262,6 +267,9 @@ public:
     typedef immer::map<uint256, CDeterministicPNCPtr> MnMap;
     typedef immer::map<uint64_t, uint256> MnInternalIdMap;
     typedef immer::map<uint256, std::pair<uint256, uint32_t> > MnUniquePropertyMap;
+    // (last paid, revived or registered height, proTxHash), see GetPaymentOrderKey
+    typedef std::pair<int, uint256> PaymentOrderKey;
+    typedef immer::flex_vector<PaymentOrderKey> MnPaymentOrder;
 
 private:
     uint256 blockHash;
@@ -274,6 +282,9 @@ private:
     // we keep track of this as checking for duplicates would otherwise be painfully slow
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // valid PNs sorted by payment order, the next payee first
+    MnPaymentOrder mnPaymentOrder;
+
 public:
     CDeterministicPNList() {}
     explicit CDeterministicPNList(const uint256& _blockHash, int _height, uint32_t _totalRegisteredCount) :
@@ -301,6 +312,7 @@ public:
         mnMap = MnMap();
         mnUniquePropertyMap = MnUniquePropertyMap();
         mnInternalIdMap = MnInternalIdMap();
+        mnPaymentOrder = MnPaymentOrder();
 
         s >> blockHash;
         s >> nHeight;
@@ -319,13 +331,7 @@ public:
 
     size_t GetValidPNsCount() const
     {
-        size_t count = 0;
-        for (const auto& p : mnMap) {
-            if (IsPNValid(p.second)) {
-                count++;
-            }
-        }
-        return count;
+        return mnPaymentOrder.size();
     }
 
     template <typename Callback>
@@ -446,6 +452,10 @@ public:
     }
 
 private:
+    static PaymentOrderKey GetPaymentOrderKey(const CDeterministicPN& dmn);
+    void AddToPaymentOrder(const CDeterministicPNCPtr& dmn);
+    void RemoveFromPaymentOrder(const CDeterministicPNCPtr& dmn);
+
     template <typename T>
     void AddUniqueProperty(const CDeterministicPNCPtr& dmn, const T& v)
     {
@@ -555,6 +565,20 @@ class CDeterministicPNManager
     static const int DISK_SNAPSHOT_PERIOD = 1440; // once per day
     static const int DISK_SNAPSHOTS = 3; // keep cache for 3 disk snapshots to have 2 full days covered
     static const int LIST_DIFFS_CACHE_SIZE = DISK_SNAPSHOT_PERIOD * DISK_SNAPSHOTS;
+    // in-memory snapshots kept while rebuilding a list, bounds the diffs applied per lookup
+    static const int MEMORY_SNAPSHOT_PERIOD = 32;
+    // evict the oldest cache entries above this size
+    static const size_t MAX_CACHE_BYTES = 32 * 1024 * 1024;
+
+    // Cache entries, with an estimate of the memory they hold on their own
+    struct CachedList {
+        CDeterministicPNList list;
+        size_t nBytes;
+    };
+    struct CachedDiff {
+        CDeterministicPNListDiff diff;
+        size_t nBytes;
+    };
 
 public:
     mutable RecursiveMutex cs;
@@ -562,8 +586,9 @@ public:
 private:
     CEvoDB& evoDb;
 
-    std::unordered_map<uint256, CDeterministicPNList, StaticSaltedHasher> mnListsCache;
-    std::unordered_map<uint256, CDeterministicPNListDiff, StaticSaltedHasher> mnListDiffsCache;
+    std::unordered_map<uint256, CachedList, StaticSaltedHasher> mnListsCache;
+    std::unordered_map<uint256, CachedDiff, StaticSaltedHasher> mnListDiffsCache;
+    size_t nCacheBytes{0};
     const CBlockIndex* tipIndex{nullptr};
 
 public:
@@ -579,6 +604,7 @@ public:
     void DecreasePoSePenalties(CDeterministicPNList& mnList);
 
     // to return a valid list, it must have been built first, so never call it with a block not-yet connected (e.g. from CheckBlock).
+    // Missing snapshots and diffs are read from disk without holding cs (unless the caller holds it).
     CDeterministicPNList GetListForBlock(const CBlockIndex* pindex);
     CDeterministicPNList GetListAtChainTip();
 
@@ -591,6 +617,9 @@ public:
     bool LegacyPNObsolete() const;
 
 private:
+    void AddListToCache(const CDeterministicPNList& list, size_t nBytes);
+    void AddDiffToCache(const uint256& blockHash, const CDeterministicPNListDiff& diff, size_t nBytes);
+    void RemoveFromCache(const uint256& blockHash);
     void CleanupCache(int nHeight);
 };
 
@@ -43,26 +43,37 @@ static bool CheckService(const CService& addr, CValidationState& state)
     return true;
 }
 
-template <typename Payload>
-static bool CheckHashSig(const Payload& pl, const CKeyID& keyID, CValidationState& state)
+bool CProTxSigCheck::operator()()
 {
     std::string strError;
-    if (!CHashSigner::VerifyHash(::SerializeHash(pl), keyID, pl.vchSig, strError)) {
-        return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false, strError);
-    }
-    return true;
+    return CHashSigner::VerifyHash(hash, keyID, vchSig, strError);
 }
 
-template <typename Payload>
-static bool CheckStringSig(const Payload& pl, const CKeyID& keyID, CValidationState& state)
+static bool CheckSig(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
 {
+    if (pvChecks) {
+        pvChecks->emplace_back(hash, keyID, vchSig);
+        return true;
+    }
     std::string strError;
-    if (!CMessageSigner::VerifyMessage(keyID, pl.vchSig, pl.MakeSignString(), strError)) {
+    if (!CHashSigner::VerifyHash(hash, keyID, vchSig, strError)) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false, strError);
     }
     return true;
 }
 
+template <typename Payload>
+static bool CheckHashSig(const Payload& pl, const CKeyID& keyID, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
+{
+    return CheckSig(::SerializeHash(pl), keyID, pl.vchSig, state, pvChecks);
+}
+
+template <typename Payload>
+static bool CheckStringSig(const Payload& pl, const CKeyID& keyID, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
+{
+    return CheckSig(CMessageSigner::GetMessageHash(pl.MakeSignString()), keyID, pl.vchSig, state, pvChecks);
+}
+
 template <typename Payload>
 static bool CheckInputsHash(const CTransaction& tx, const Payload& pl, CValidationState& state)
 {
@@ -94,7 +105,7 @@ static bool CheckCollateralOut(const CTxOut& out, const ProRegPL& pl, CValidatio
     return true;
 }
 
-bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
 {
     assert(tx.nType == CTransaction::TxType::PROREG);
 
@@ -182,7 +193,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
             return state.DoS(10, false, REJECT_INVALID, "bad-protx-collateral-pkh");
         }
         // collateral is not part of this ProRegTx, so we must verify ownership of the collateral
-        if (!CheckStringSig(pl, *keyForPayloadSig, state)) {
+        if (!CheckStringSig(pl, *keyForPayloadSig, state, pvChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -260,7 +271,7 @@ void ProRegPL::ToJson(UniValue& obj) const
 
 // Provider Update Service Payload
 
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
 {
     assert(tx.nType == CTransaction::TxType::PROUPSERV);
 
@@ -307,7 +318,7 @@ bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVa
         }
 
         // we can only check the signature if pindexPrev != nullptr and the PN is known
-        if (!CheckHashSig(pl, mn->pdmnState->keyIDOperator, state)) {
+        if (!CheckHashSig(pl, mn->pdmnState->keyIDOperator, state, pvChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -341,7 +352,7 @@ void ProUpServPL::ToJson(UniValue& obj) const
 
 // Provider Update Registrar Payload
 
-bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
 {
     assert(tx.nType == CTransaction::TxType::PROUPREG);
 
@@ -425,7 +436,7 @@ bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
             }
         }
 
-        if (!CheckHashSig(pl, dmn->pdmnState->keyIDOwner, state)) {
+        if (!CheckHashSig(pl, dmn->pdmnState->keyIDOwner, state, pvChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -461,7 +472,7 @@ void ProUpRegPL::ToJson(UniValue& obj) const
 
 // Provider Update Revoke Payload
 
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
 {
     assert(tx.nType == CTransaction::TxType::PROUPREV);
 
@@ -491,7 +502,7 @@ bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
         if (!dmn)
             return state.DoS(100, false, REJECT_INVALID, "bad-protx-hash");
 
-        if (!CheckHashSig(pl, dmn->pdmnState->keyIDOperator, state)) {
+        if (!CheckHashSig(pl, dmn->pdmnState->keyIDOperator, state, pvChecks)) {
             // pass the state returned by the function above
             return false;
         }
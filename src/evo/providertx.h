@@ -161,10 +161,39 @@ public:
     void ToJson(UniValue& obj) const;
 };
 
-bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+/**
+ * Closure representing the verification of a provider tx payload signature
+ * (the payload hash, or the message hash of its sign string, against a key id).
+ */
+class CProTxSigCheck
+{
+private:
+    uint256 hash;
+    CKeyID keyID;
+    std::vector<unsigned char> vchSig;
+
+public:
+    CProTxSigCheck() {}
+    CProTxSigCheck(const uint256& _hash, const CKeyID& _keyID, const std::vector<unsigned char>& _vchSig) :
+        hash(_hash),
+        keyID(_keyID),
+        vchSig(_vchSig) {}
+
+    bool operator()();
+
+    void swap(CProTxSigCheck& check)
+    {
+        std::swap(hash, check.hash);
+        std::swap(keyID, check.keyID);
+        vchSig.swap(check.vchSig);
+    }
+};
+
+// If pvChecks is not null, the payload signature checks are appended to it instead of being run
+bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks = nullptr);
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks = nullptr);
+bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks = nullptr);
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks = nullptr);
 
 // If tx is a ProRegTx, return the collateral outpoint in outRet.
 bool GetProRegCollateral(const CTransactionRef& tx, COutPoint& outRet);
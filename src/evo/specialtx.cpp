@@ -7,12 +7,23 @@
 
 #include "chain.h"
 #include "chainparams.h"
+#include "checkqueue.h"
 #include "clientversion.h"
 #include "consensus/validation.h"
 #include "evo/deterministicmns.h"
 #include "evo/providertx.h"
 #include "primitives/transaction.h"
 #include "primitives/block.h"
+#include "util/threadnames.h"
+#include "validation.h" // for nScriptCheckThreads
+
+static CCheckQueue<CProTxSigCheck> protxsigcheckqueue(128);
+
+void ThreadProTxSigCheck()
+{
+    util::ThreadRename("trumpcoin-protxsig");
+    protxsigcheckqueue.Thread();
+}
 
 // Basic non-contextual checks for all tx types
 static bool CheckSpecialTxBasic(const CTransaction& tx, CValidationState& state)
@@ -91,7 +102,7 @@ bool CheckSpecialTxNoContext(const CTransaction& tx, CValidationState& state)
                      REJECT_INVALID, "bad-tx-type");
 }
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks)
 {
     // This function is not called when connecting the genesis block
     assert(pindexPrev != nullptr);
@@ -115,19 +126,19 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVali
     switch (tx.nType) {
         case CTransaction::TxType::PROREG: {
             // provider-register
-            return CheckProRegTx(tx, pindexPrev, state);
+            return CheckProRegTx(tx, pindexPrev, state, pvChecks);
         }
         case CTransaction::TxType::PROUPSERV: {
             // provider-update-service
-            return CheckProUpServTx(tx, pindexPrev, state);
+            return CheckProUpServTx(tx, pindexPrev, state, pvChecks);
         }
         case CTransaction::TxType::PROUPREG: {
             // provider-update-registrar
-            return CheckProUpRegTx(tx, pindexPrev, state);
+            return CheckProUpRegTx(tx, pindexPrev, state, pvChecks);
         }
         case CTransaction::TxType::PROUPREV: {
             // provider-update-revoke
-            return CheckProUpRevTx(tx, pindexPrev, state);
+            return CheckProUpRevTx(tx, pindexPrev, state, pvChecks);
         }
     }
 
@@ -137,12 +148,19 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVali
 
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck)
 {
-    // check special txes
+    // check special txes: the contextual checks run here, in block order, while the
+    // payload signatures get verified by the provider tx signature checking threads.
+    CCheckQueueControl<CProTxSigCheck> control(nScriptCheckThreads ? &protxsigcheckqueue : nullptr);
     for (const CTransactionRef& tx: block.vtx) {
-        if (!CheckSpecialTx(*tx, pindex->pprev, state)) {
+        std::vector<CProTxSigCheck> vChecks;
+        if (!CheckSpecialTx(*tx, pindex->pprev, state, nScriptCheckThreads ? &vChecks : nullptr)) {
             // pass the state returned by the function above
             return false;
         }
+        control.Add(vChecks);
+    }
+    if (!control.Wait()) {
+        return state.DoS(100, error("%s: provider tx signature check failed", __func__), REJECT_INVALID, "bad-protx-sig");
     }
 
     if (!deterministicPNManager->ProcessBlock(block, pindex, state, fJustCheck)) {
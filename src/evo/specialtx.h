@@ -12,6 +12,7 @@
 
 class CBlock;
 class CBlockIndex;
+class CProTxSigCheck;
 class CValidationState;
 class uint256;
 
@@ -21,13 +22,18 @@ static const unsigned int MAX_SPECIALTX_EXTRAPAYLOAD = 10000;
 /** Payload validity checks (including duplicate unique properties against list at pindexPrev)*/
 // Note: for +v2, if the tx is not a special tx, this method returns true.
 // Note2: This function only performs extra payload related checks, it does NOT checks regular inputs and outputs.
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+// If pvChecks is not null, the payload signature checks are appended to it instead of being run.
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, std::vector<CProTxSigCheck>* pvChecks = nullptr);
 
 // Basic non-contextual checks for special txes
 // Note: for +v2, if the tx is not a special tx, this method returns true.
 bool CheckSpecialTxNoContext(const CTransaction& tx, CValidationState& state);
 
+/** Run an instance of the provider tx signature checking thread */
+void ThreadProTxSigCheck();
+
 // Update internal tiertwo data when blocks containing special txes get connected/disconnected
+// The payload signatures of the block are verified on the provider tx signature checking threads.
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck);
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex);
 
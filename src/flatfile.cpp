@@ -6,6 +6,7 @@
 #include <stdexcept>
 
 #include "flatfile.h"
+#include "compat.h"
 #include "logging.h"
 #include "tinyformat.h"
 #include "util/system.h"
@@ -52,6 +53,18 @@ FILE* FlatFileSeq::Open(const FlatFilePos& pos, bool read_only)
     return file;
 }
 
+std::shared_ptr<const FlatFileMapping> FlatFileSeq::Map(const FlatFilePos& pos) const
+{
+    if (pos.IsNull()) {
+        return nullptr;
+    }
+    auto mapping = std::make_shared<const FlatFileMapping>(FileName(pos));
+    if (mapping->IsNull()) {
+        return nullptr;
+    }
+    return mapping;
+}
+
 size_t FlatFileSeq::Allocate(const FlatFilePos& pos, size_t add_size, bool& out_of_space)
 {
     out_of_space = false;
@@ -96,3 +109,37 @@ bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
     fclose(file);
     return true;
 }
+
+FlatFileMapping::FlatFileMapping(const fs::path& path)
+{
+#ifndef WIN32
+    // Keep the address space usage sane on 32-bit systems
+    if (sizeof(void*) < 8) {
+        return;
+    }
+    int fd = ::open(path.string().c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    off_t size = ::lseek(fd, 0, SEEK_END);
+    if (size > 0) {
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED) {
+            m_data = static_cast<const unsigned char*>(addr);
+            m_size = size;
+        } else {
+            LogPrintf("Unable to map file %s\n", path.string());
+        }
+    }
+    ::close(fd); // the mapping stays valid after closing the descriptor
+#endif
+}
+
+FlatFileMapping::~FlatFileMapping()
+{
+#ifndef WIN32
+    if (m_data) {
+        ::munmap(const_cast<unsigned char*>(m_data), m_size);
+    }
+#endif
+}
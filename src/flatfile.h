@@ -6,6 +6,7 @@
 #ifndef BITCOIN_FLATFILE_H
 #define BITCOIN_FLATFILE_H
 
+#include <memory>
 #include <string>
 
 #include "fs.h"
@@ -39,6 +40,29 @@ struct FlatFilePos
     std::string ToString() const;
 };
 
+/**
+ * Read-only memory mapping of a whole flat file. Meant for files that are no longer
+ * appended to (finalized), so that records can be read without any syscall.
+ * Mapping is not supported on every platform: IsNull() is true when it failed.
+ */
+class FlatFileMapping
+{
+private:
+    const unsigned char* m_data{nullptr};
+    size_t m_size{0};
+
+public:
+    explicit FlatFileMapping(const fs::path& path);
+    ~FlatFileMapping();
+
+    FlatFileMapping(const FlatFileMapping&) = delete;
+    FlatFileMapping& operator=(const FlatFileMapping&) = delete;
+
+    bool IsNull() const { return m_data == nullptr; }
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
 /**
  * FlatFileSeq represents a sequence of numbered files storing raw data. This class facilitates
  * access to and efficient management of these files.
@@ -66,6 +90,9 @@ public:
     /** Open a handle to the file at the given position. */
     FILE* Open(const FlatFilePos& pos, bool read_only = false);
 
+    /** Memory-map (read-only) the file at the given position. Returns nullptr on failure. */
+    std::shared_ptr<const FlatFileMapping> Map(const FlatFilePos& pos) const;
+
     /**
      * Allocate additional space in a file after the given starting position. The amount allocated
      * will be the minimum multiple of the sequence chunk size greater than add_size.
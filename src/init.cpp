@@ -17,6 +17,7 @@
 #include "activepatriotnode.h"
 #include "addrman.h"
 #include "amount.h"
+#include "blockreadcache.h"
 #include "budget/budgetdb.h"
 #include "budget/budgetmanager.h"
 #include "checkpoints.h"
@@ -24,6 +25,7 @@
 #include "consensus/upgrades.h"
 #include "evo/deterministicmns.h"
 #include "evo/evonotificationinterface.h"
+#include "evo/specialtx.h"
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
@@ -252,6 +254,8 @@ void PrepareShutdown()
     DumpPatriotnodes();
     DumpBudgets(g_budgetman);
     DumpPatriotnodePayments();
+    pBudgetDB.reset();
+    pPatriotnodePaymentDB.reset();
     if (::mempool.IsLoaded() && gArgs.GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool(::mempool);
     }
@@ -436,6 +440,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", "This help message");
     strUsage += HelpMessageOpt("-version", "Print version and exit");
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)");
+    strUsage += HelpMessageOpt("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-backgroundverify", strprintf("Verify the blocks of -checkblocks in background once the node is running, instead of at startup. Only block and undo data are checked (levels 0-2) (default: %u)", DEFAULT_BACKGROUND_VERIFY));
     strUsage += HelpMessageOpt("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)");
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)");
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS));
@@ -454,10 +460,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-paramsdir=<dir>", strprintf("Specify zk params directory (default: %s)", ZC_GetParamsDir().string()));
     strUsage += HelpMessageOpt("-debuglogfile=<file>", strprintf("Specify location of debug log file: this can be an absolute path or a path relative to the data directory (default: %s)", DEFAULT_DEBUGLOGFILE));
     strUsage += HelpMessageOpt("-disablesystemnotifications", strprintf("Disable OS notifications for incoming transactions (default: %u)", 0));
+    strUsage += HelpMessageOpt("-blockreadcache=<n>", strprintf("Keep the <n> most recently read blocks decoded in memory (default: %u)", DEFAULT_BLOCK_READ_CACHE_SIZE));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf("Set database cache size in megabytes (%d to %d, default: %d)", nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup");
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf("Set the Maximum reorg depth (default: %u)", DEFAULT_MAX_REORG_DEPTH));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+    strUsage += HelpMessageOpt("-maxorphantxsize=<n>", strprintf("Keep at most <n> megabytes of unconnectable transactions in memory, a single peer can fill %u%% of it (default: %u)", ORPHAN_TX_PEER_QUOTA_PERCENT, DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL));
@@ -685,6 +693,18 @@ struct CImportingNow {
     }
 };
 
+void ThreadVerifyDB(int nCheckLevel, int nCheckDepth)
+{
+    util::ThreadRename("trumpcoin-verifydb");
+    ScheduleBatchPriority();
+    if (!CVerifyDB().VerifyBlocks(nCheckLevel, nCheckDepth)) {
+        uiInterface.ThreadSafeMessageBox(_("Corrupted block database detected") + ".\n\n" +
+                                         _("Please restart with -reindex to rebuild the block database."),
+                                         "", CClientUIInterface::MSG_ERROR);
+        StartShutdown();
+    }
+}
+
 void ThreadImport(const std::vector<fs::path>& vImportFiles)
 {
     util::ThreadRename("trumpcoin-loadblk");
@@ -693,6 +713,7 @@ void ThreadImport(const std::vector<fs::path>& vImportFiles)
 
     // -reindex
     if (fReindex) {
+        g_blockreadcache.Clear();
         int nFile = 0;
         while (true) {
             FlatFilePos pos(nFile, 0);
@@ -1122,6 +1143,8 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    g_blockreadcache.SetMaxBlocks(std::max<int64_t>(0, gArgs.GetArg("-blockreadcache", DEFAULT_BLOCK_READ_CACHE_SIZE)));
+
     setvbuf(stdout, NULL, _IOLBF, 0); /// ***TODO*** do we still need this after -printtoconsole is gone?
 
 #ifndef ENABLE_WALLET
@@ -1149,6 +1172,12 @@ bool AppInitParameterInteraction()
     }
 
     const CChainParams& chainparams = Params();
+    hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
+    if (!hashAssumeValid.IsNull())
+        LogPrintf("Assuming ancestors of block %s have valid scripts.\n", hashAssumeValid.GetHex());
+    else
+        LogPrintf("Validating signatures for all blocks.\n");
+
     fRequireStandard = !gArgs.GetBoolArg("-acceptnonstdtxn", !chainparams.RequireStandard());
     if (!chainparams.IsTestChain() && !fRequireStandard)
         return UIError(strprintf("%s is not currently supported for %s chain", "-acceptnonstdtxn", chainparams.NetworkIDString()));
@@ -1299,6 +1328,10 @@ bool AppInitMain()
     if (nScriptCheckThreads) {
         for (int i = 0; i < nScriptCheckThreads - 1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+            threadGroup.create_thread(&ThreadProTxSigCheck);
+        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+            threadGroup.create_thread(&ThreadParallelTask);
     }
 
     if (gArgs.IsArgSet("-sporkkey")) // spork priv key
@@ -1727,7 +1760,8 @@ bool AppInitMain()
                         }
                     }
 
-                    if (!CVerifyDB().VerifyDB(pcoinsdbview.get(), gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL),
+                    if (!gArgs.GetBoolArg("-backgroundverify", DEFAULT_BACKGROUND_VERIFY) &&
+                            !CVerifyDB().VerifyDB(pcoinsdbview.get(), gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL),
                             gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS))) {
                         strLoadError = _("Corrupted block database detected");
                         break;
@@ -1866,15 +1900,15 @@ bool AppInitMain()
 
     uiInterface.InitMessage(_("Loading budget cache..."));
 
-    CBudgetDB budgetdb;
     const bool fDryRun = (chain_active_height <= 0);
     if (!fDryRun) g_budgetman.SetBestHeight(chain_active_height);
-    CBudgetDB::ReadResult readResult2 = budgetdb.Read(g_budgetman, fDryRun);
+    pBudgetDB.reset(new CBudgetDB());
+    CBudgetDB::ReadResult readResult2 = pBudgetDB->Read(g_budgetman, fDryRun);
 
-    if (readResult2 == CBudgetDB::FileError)
-        LogPrintf("Missing budget cache - budget.dat, will try to recreate\n");
+    if (readResult2 == CBudgetDB::Empty)
+        LogPrintf("Missing budget cache - budget db, will try to recreate\n");
     else if (readResult2 != CBudgetDB::Ok) {
-        LogPrintf("Error reading budget.dat - cached data discarded\n");
+        LogPrintf("Error reading budget db - cached data discarded\n");
     }
 
     //flag our cached items so we send them to our peers
@@ -1885,17 +1919,23 @@ bool AppInitMain()
 
     uiInterface.InitMessage(_("Loading patriotnode payment cache..."));
 
-    CPatriotnodePaymentDB mnpayments;
-    CPatriotnodePaymentDB::ReadResult readResult3 = mnpayments.Read(patriotnodePayments);
+    pPatriotnodePaymentDB.reset(new CPatriotnodePaymentDB());
+    CPatriotnodePaymentDB::ReadResult readResult3 = pPatriotnodePaymentDB->Read(patriotnodePayments);
 
     RegisterValidationInterface(&patriotnodePayments);
 
-    if (readResult3 == CPatriotnodePaymentDB::FileError)
-        LogPrintf("Missing patriotnode payment cache - mnpayments.dat, will try to recreate\n");
+    if (readResult3 == CPatriotnodePaymentDB::Empty)
+        LogPrintf("Missing patriotnode payment cache - mnpayments db, will try to recreate\n");
     else if (readResult3 != CPatriotnodePaymentDB::Ok) {
-        LogPrintf("Error reading mnpayments.dat - cached data discarded\n");
+        LogPrintf("Error reading mnpayments db - cached data discarded\n");
     }
 
+    // Write the budget and patriotnode payment changes every 15 minutes (and on shutdown)
+    scheduler.scheduleEvery([]{
+        DumpBudgets(g_budgetman);
+        DumpPatriotnodePayments();
+    }, 15 * 60 * 1000);
+
     fPatriotNode = gArgs.GetBoolArg("-patriotnode", DEFAULT_PATRIOTNODE);
 
     if ((fPatriotNode || patriotnodeConfig.getCount() > -1) && fTxIndex == false) {
@@ -2042,6 +2082,11 @@ bool AppInitMain()
     SetRPCWarmupFinished();
     uiInterface.InitMessage(_("Done loading"));
 
+    if (gArgs.GetBoolArg("-backgroundverify", DEFAULT_BACKGROUND_VERIFY)) {
+        threadGroup.create_thread(std::bind(&ThreadVerifyDB, gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL),
+                                            gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS)));
+    }
+
     return true;
 }
 
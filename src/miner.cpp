@@ -121,6 +121,8 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
 
     // Each thread has its own key and counter
     std::unique_ptr<CReserveKey> pReservekey = fProofOfStake ? nullptr : std::make_unique<CReserveKey>(pwallet);
+    // and its own mempool selection, extended on every found kernel
+    CTxSelection stakeSelection;
 
     // Available UTXO set
     std::vector<CStakeableOutput> availableCoins;
@@ -194,7 +196,8 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
         unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
 
         std::unique_ptr<CBlockTemplate> pblocktemplate((fProofOfStake ?
-                                                        BlockAssembler(Params(), DEFAULT_PRINTPRIORITY).CreateNewBlock(CScript(), pwallet, true, &availableCoins) :
+                                                        BlockAssembler(Params(), DEFAULT_PRINTPRIORITY).CreateNewBlock(CScript(), pwallet, true, &availableCoins,
+                                                                                                        false, true, &stakeSelection) :
                                                         CreateNewBlockWithKey(pReservekey, pwallet)));
         if (!pblocktemplate) continue;
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(pblocktemplate->block);
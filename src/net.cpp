@@ -1729,14 +1729,20 @@ void CConnman::ThreadMessageHandler()
         }
 
         bool fMoreWork = false;
+        bool fSkipped = false;
 
         for (CNode* pnode : vNodesCopy) {
             if (pnode->fDisconnect)
                 continue;
 
-            // Receive messages
-            bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
-            fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
+            // Receive messages, unless the node is making up for messages taken ahead of their turn
+            if (pnode->nProcessRoundsOwed > 0) {
+                pnode->nProcessRoundsOwed--;
+                fSkipped = true;
+            } else {
+                bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
+                fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
+            }
             if (flagInterruptMsgProc)
                 return;
 
@@ -1751,6 +1757,13 @@ void CConnman::ThreadMessageHandler()
         }
 
 
+        if (fSkipped && !fMoreWork) {
+            // Nobody else has messages waiting: the skipped nodes don't need to wait either
+            for (CNode* pnode : vNodesCopy)
+                pnode->nProcessRoundsOwed = 0;
+            fMoreWork = true;
+        }
+
         {
             LOCK(cs_vNodes);
             for (CNode* pnode : vNodesCopy)
@@ -2278,6 +2291,20 @@ int CConnman::GetBestHeight() const
 }
 
 unsigned int CConnman::GetReceiveFloodSize() const { return nReceiveFloodSize; }
+
+size_t CConnman::PollMessages(CNode* pnode, size_t nMax, const std::function<bool(const CNetMessage&)>& fMatch, std::list<CNetMessage>& msgs)
+{
+    size_t nMoved = 0;
+    LOCK(pnode->cs_vProcessMsg);
+    while (nMoved < nMax && !pnode->vProcessMsg.empty() && fMatch(pnode->vProcessMsg.front())) {
+        pnode->nProcessQueueSize -= pnode->vProcessMsg.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+        msgs.splice(msgs.end(), pnode->vProcessMsg, pnode->vProcessMsg.begin());
+        nMoved++;
+    }
+    pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+    pnode->nProcessRoundsOwed += nMoved;
+    return nMoved;
+}
 unsigned int CConnman::GetSendBufferSize() const{ return nSendBufferMaxSize; }
 
 CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const std::string& addrNameIn, bool fInboundIn) :
@@ -2331,6 +2358,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fPauseRecv = false;
     fPauseSend = false;
     nProcessQueueSize = 0;
+    nProcessRoundsOwed = 0;
 
     for (const std::string &msg : getAllNetMessageTypes())
         mapRecvBytesPerMsgCmd[msg] = 0;
@@ -26,6 +26,8 @@
 #include <atomic>
 #include <cstdint>
 #include <deque>
+#include <functional>
+#include <list>
 #include <thread>
 #include <memory>
 #include <condition_variable>
@@ -36,6 +38,7 @@
 
 class CAddrMan;
 class CBlockIndex;
+class CNetMessage;
 class CScheduler;
 class CNode;
 
@@ -295,6 +298,14 @@ public:
 
     unsigned int GetReceiveFloodSize() const;
 
+    /**
+     * Move up to nMax messages from the front of the process queue of pnode into msgs, while
+     * fMatch accepts them. Receiving is paused or resumed against the receive flood limit as
+     * for messages processed in their turn, and ThreadMessageHandler skips pnode for as many
+     * rounds while other nodes have messages waiting. Returns the number of messages moved.
+     */
+    size_t PollMessages(CNode* pnode, size_t nMax, const std::function<bool(const CNetMessage&)>& fMatch, std::list<CNetMessage>& msgs);
+
     void SetAsmap(std::vector<bool> asmap) { addrman.m_asmap = std::move(asmap); }
 private:
     struct ListenSocket {
@@ -570,6 +581,8 @@ public:
     RecursiveMutex cs_vProcessMsg;
     std::list<CNetMessage> vProcessMsg;
     size_t nProcessQueueSize;
+    //! Message handler rounds to skip for messages taken ahead of their turn, see CConnman::PollMessages
+    std::atomic<size_t> nProcessRoundsOwed;
 
     RecursiveMutex cs_sendProcessing;
 
@@ -9,6 +9,7 @@
 #include "budget/budgetmanager.h"
 #include "chain.h"
 #include "evo/deterministicmns.h"
+#include "limitedmap.h"
 #include "patriotnodeman.h"
 #include "patriotnode-payments.h"
 #include "patriotnode-sync.h"
@@ -28,6 +29,8 @@ static const uint64_t RANDOMIZER_ID_ADDRESS_RELAY = 0x3cac0035b5866b90ULL; // SH
 
 /** the maximum percentage of addresses from our addrman to return in response to a getaddr message. */
 static constexpr size_t MAX_PCT_ADDR_TO_SEND = 23;
+/** the maximum number of queued transactions from a peer accepted to the mempool together. */
+static constexpr size_t MAX_TX_BATCH_SIZE = 100;
 
 struct IteratorComparator
 {
@@ -44,11 +47,21 @@ struct COrphanTx {
     NodeId fromPeer;
     int64_t nTimeExpire;
     size_t list_pos;
+    size_t nSize;
 };
 RecursiveMutex g_cs_orphans;
 std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(g_cs_orphans);
 std::map<COutPoint, std::set<std::map<uint256, COrphanTx>::iterator, IteratorComparator>> mapOrphanTransactionsByPrev GUARDED_BY(g_cs_orphans);
 std::vector<std::map<uint256, COrphanTx>::iterator> g_orphan_list GUARDED_BY(g_cs_orphans); //! For random eviction
+size_t g_orphan_bytes GUARDED_BY(g_cs_orphans) = 0; //! Total size of the orphan transactions
+std::map<NodeId, size_t> g_orphan_bytes_by_peer GUARDED_BY(g_cs_orphans); //! For the per-peer quota
+//! Why recently resolved orphans were rejected, the oldest reasons are dropped first
+limitedmap<uint256, std::pair<uint64_t, std::string>> g_orphan_reject_reasons GUARDED_BY(g_cs_orphans) = limitedmap<uint256, std::pair<uint64_t, std::string>>(MAX_ORPHAN_REJECT_REASONS);
+//! Orphan pool counters, for getorphaninfo
+uint64_t g_orphans_resolved GUARDED_BY(g_cs_orphans) = 0;
+uint64_t g_orphans_rejected GUARDED_BY(g_cs_orphans) = 0;
+uint64_t g_orphans_evicted GUARDED_BY(g_cs_orphans) = 0;
+uint64_t g_orphans_expired GUARDED_BY(g_cs_orphans) = 0;
 
 void EraseOrphansFor(NodeId peer);
 
@@ -103,6 +116,24 @@ int nQueuedValidatedHeaders = 0;
 /** Number of preferable block download peers. */
 int nPreferredDownload = 0;
 
+/**
+ * Blocks downloaded ahead of their parent during headers-first sync. Proof of stake can only
+ * be checked in chain order, so they are handed to ProcessNewBlock once the data of their
+ * parent is received. Bounded in size and per peer, a peer's entries are dropped when it
+ * disconnects. Protected by cs_main.
+ */
+struct PendingBlock {
+    std::shared_ptr<const CBlock> pblock;
+    NodeId nodeid;
+    size_t nSize;
+};
+std::map<uint256, PendingBlock> mapBlocksPendingParent;
+std::multimap<uint256, uint256> mapBlocksPendingByPrev;
+size_t nBlocksPendingParentSize = 0;
+
+/** Peer that sent each header-only index entry, until its block is received. Protected by cs_main. */
+std::map<uint256, NodeId> mapHeaderSource;
+
 } // anon namespace
 
 namespace
@@ -207,6 +238,16 @@ struct CNodeState {
     const CBlockIndex* pindexLastCommonBlock;
     //! Whether we've started headers synchronization with this peer.
     bool fSyncStarted;
+    //! When to potentially disconnect peer for stalling headers download
+    int64_t nHeadersSyncTimeout;
+    //! Length of current-streak of unconnecting headers announcements
+    int nUnconnectingHeaders;
+    //! Number of header-only index entries created from this peer's headers.
+    int nUnverifiedHeaders;
+    //! Whether we stopped asking for headers until the download catches up with them.
+    bool fHeadersPaused;
+    //! Number of blocks from this peer waiting for their parent.
+    int nBlocksPendingParent;
     //! Since when we're stalling block download progress (in microseconds), or 0.
     int64_t nStallingSince;
     std::list<QueuedBlock> vBlocksInFlight;
@@ -224,6 +265,11 @@ struct CNodeState {
         hashLastUnknownBlock.SetNull();
         pindexLastCommonBlock = NULL;
         fSyncStarted = false;
+        nHeadersSyncTimeout = 0;
+        nUnconnectingHeaders = 0;
+        nUnverifiedHeaders = 0;
+        fHeadersPaused = false;
+        nBlocksPendingParent = 0;
         nStallingSince = 0;
         nBlocksInFlight = 0;
         fPreferredDownload = false;
@@ -338,6 +384,134 @@ void UpdateBlockAvailability(NodeId nodeid, const uint256& hash)
     }
 }
 
+/** Whether the peer answers "getheaders" with "headers". */
+bool SupportsHeadersFirst(const CNode* pnode)
+{
+    return pnode->nVersion >= HEADERS_FIRST_VERSION;
+}
+
+// Requires cs_main.
+bool AddBlockPendingParent(const std::shared_ptr<const CBlock>& pblock, NodeId nodeid)
+{
+    const uint256& hash = pblock->GetHash();
+    CNodeState* state = State(nodeid);
+    const size_t nSize = ::GetSerializeSize(*pblock, PROTOCOL_VERSION);
+    if (state->nBlocksPendingParent >= MAX_BLOCKS_PENDING_PARENT_PER_PEER ||
+            nBlocksPendingParentSize + nSize > MAX_BLOCKS_PENDING_PARENT_SIZE ||
+            mapBlocksPendingParent.count(hash))
+        return false;
+    mapBlocksPendingParent.emplace(hash, PendingBlock{pblock, nodeid, nSize});
+    mapBlocksPendingByPrev.emplace(pblock->hashPrevBlock, hash);
+    nBlocksPendingParentSize += nSize;
+    state->nBlocksPendingParent++;
+    return true;
+}
+
+/** Remove an entry of mapBlocksPendingParent, but not its mapBlocksPendingByPrev link. Requires cs_main. */
+std::map<uint256, PendingBlock>::iterator EraseBlockPendingParent(std::map<uint256, PendingBlock>::iterator it)
+{
+    CNodeState* state = State(it->second.nodeid);
+    if (state)
+        state->nBlocksPendingParent--;
+    nBlocksPendingParentSize -= it->second.nSize;
+    return mapBlocksPendingParent.erase(it);
+}
+
+/** Drop the blocks received from a peer that are still waiting for their parent. Requires cs_main. */
+void EraseBlocksPendingParentFrom(NodeId nodeid)
+{
+    auto it = mapBlocksPendingParent.begin();
+    while (it != mapBlocksPendingParent.end()) {
+        if (it->second.nodeid != nodeid) {
+            ++it;
+            continue;
+        }
+        auto range = mapBlocksPendingByPrev.equal_range(it->second.pblock->hashPrevBlock);
+        for (auto itPrev = range.first; itPrev != range.second; ++itPrev) {
+            if (itPrev->second == it->first) {
+                mapBlocksPendingByPrev.erase(itPrev);
+                break;
+            }
+        }
+        it = EraseBlockPendingParent(it);
+    }
+}
+
+/** Count the header-only index entries created from a peer's headers. Returns false if there are too many. Requires cs_main. */
+bool AddUnverifiedHeaders(NodeId nodeid, const std::vector<uint256>& vNewHashes)
+{
+    CNodeState* state = State(nodeid);
+    for (const uint256& hash : vNewHashes) {
+        BlockMap::iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end() || (mi->second->nStatus & BLOCK_HAVE_DATA))
+            continue;
+        if (mapHeaderSource.emplace(hash, nodeid).second)
+            state->nUnverifiedHeaders++;
+    }
+    return state->nUnverifiedHeaders <= MAX_UNVERIFIED_HEADERS_PER_PEER;
+}
+
+/** Stop counting a header-only entry against its sender once its block was stored or found invalid. Requires cs_main. */
+void MarkHeaderVerified(const uint256& hash)
+{
+    auto it = mapHeaderSource.find(hash);
+    if (it == mapHeaderSource.end())
+        return;
+    BlockMap::iterator mi = mapBlockIndex.find(hash);
+    if (mi != mapBlockIndex.end() && !(mi->second->nStatus & (BLOCK_HAVE_DATA | BLOCK_FAILED_MASK)))
+        return;
+    CNodeState* state = State(it->second);
+    if (state)
+        state->nUnverifiedHeaders--;
+    mapHeaderSource.erase(it);
+}
+
+/** Forget the senders of header-only entries from a peer. Requires cs_main. */
+void EraseHeaderSourcesFrom(NodeId nodeid)
+{
+    auto it = mapHeaderSource.begin();
+    while (it != mapHeaderSource.end()) {
+        if (it->second == nodeid)
+            it = mapHeaderSource.erase(it);
+        else
+            ++it;
+    }
+}
+
+/** Process the blocks that were waiting for hashParent, and then their own children. */
+void ProcessBlocksPendingParent(const uint256& hashParent)
+{
+    std::deque<uint256> queue;
+    queue.push_back(hashParent);
+    while (!queue.empty()) {
+        std::vector<std::shared_ptr<const CBlock>> vChildren;
+        {
+            LOCK(cs_main);
+            BlockMap::iterator mi = mapBlockIndex.find(queue.front());
+            const bool fHaveParent = mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA);
+            auto range = mapBlocksPendingByPrev.equal_range(queue.front());
+            for (auto it = range.first; it != range.second; ++it) {
+                auto itPending = mapBlocksPendingParent.find(it->second);
+                if (itPending == mapBlocksPendingParent.end())
+                    continue;
+                // If the parent was rejected, drop the children: they are requested again if needed.
+                if (fHaveParent) {
+                    vChildren.push_back(itPending->second.pblock);
+                    mapBlockSource.emplace(it->second, itPending->second.nodeid);
+                }
+                EraseBlockPendingParent(itPending);
+            }
+            mapBlocksPendingByPrev.erase(range.first, range.second);
+        }
+        queue.pop_front();
+        for (const std::shared_ptr<const CBlock>& pblock : vChildren) {
+            ProcessNewBlock(pblock, nullptr);
+            WITH_LOCK(cs_main, MarkHeaderVerified(pblock->GetHash()));
+            queue.push_back(pblock->GetHash());
+        }
+    }
+}
+
 /** Update pindexLastCommonBlock and add not-in-flight missing successors to vBlocks, until it has
  *  at most count entries. */
 void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, NodeId& nodeStaller)
@@ -400,6 +574,9 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<con
             if (pindex->nStatus & BLOCK_HAVE_DATA) {
                 if (pindex->nChainTx)
                     state->pindexLastCommonBlock = pindex;
+            } else if (mapBlocksPendingParent.count(pindex->GetBlockHash())) {
+                // Already downloaded, waiting for its parent.
+                continue;
             } else if (mapBlocksInFlight.count(pindex->GetBlockHash()) == 0) {
                 // The block is not already downloaded, and not yet in flight.
                 if (pindex->nHeight > nWindowEnd) {
@@ -451,6 +628,8 @@ void PeerLogicValidation::FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTim
 
     for (const QueuedBlock& entry : state->vBlocksInFlight)
         mapBlocksInFlight.erase(entry.hash);
+    EraseBlocksPendingParentFrom(nodeid);
+    EraseHeaderSourcesFrom(nodeid);
     EraseOrphansFor(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
 
@@ -478,7 +657,7 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats)
 // mapOrphanTransactions
 //
 
-bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+bool AddOrphanTx(const CTransactionRef& tx, NodeId peer, size_t nMaxPeerBytes = std::numeric_limits<size_t>::max()) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
 {
     const uint256& hash = tx->GetHash();
     if (mapOrphanTransactions.count(hash))
@@ -498,15 +677,25 @@ bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRE
         return false;
     }
 
-    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, g_orphan_list.size()});
+    // A single peer can only fill its share of the orphan pool, so that it can't
+    // get the orphans of the other peers evicted.
+    auto itPeerBytes = g_orphan_bytes_by_peer.find(peer);
+    if (itPeerBytes != g_orphan_bytes_by_peer.end() && itPeerBytes->second + sz > nMaxPeerBytes) {
+        LogPrint(BCLog::MEMPOOL, "ignoring orphan tx %s, peer=%d is over its quota (%u bytes)\n", hash.ToString(), peer, itPeerBytes->second);
+        return false;
+    }
+
+    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, g_orphan_list.size(), sz});
     assert(ret.second);
     g_orphan_list.emplace_back(ret.first);
     for (const CTxIn& txin : tx->vin) {
         mapOrphanTransactionsByPrev[txin.prevout].insert(ret.first);
     }
+    g_orphan_bytes += sz;
+    g_orphan_bytes_by_peer[peer] += sz;
 
-    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u)\n", hash.ToString(),
-        mapOrphanTransactions.size(), mapOrphanTransactionsByPrev.size());
+    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u bytes %u)\n", hash.ToString(),
+        mapOrphanTransactions.size(), mapOrphanTransactionsByPrev.size(), g_orphan_bytes);
     return true;
 }
 
@@ -535,6 +724,12 @@ int static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
     }
     g_orphan_list.pop_back();
 
+    g_orphan_bytes -= it->second.nSize;
+    auto itPeerBytes = g_orphan_bytes_by_peer.find(it->second.fromPeer);
+    assert(itPeerBytes != g_orphan_bytes_by_peer.end() && itPeerBytes->second >= it->second.nSize);
+    itPeerBytes->second -= it->second.nSize;
+    if (itPeerBytes->second == 0) g_orphan_bytes_by_peer.erase(itPeerBytes);
+
     mapOrphanTransactions.erase(it);
     return 1;
 }
@@ -554,7 +749,7 @@ void EraseOrphansFor(NodeId peer)
 }
 
 
-unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans)
+unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans, size_t nMaxOrphanBytes = std::numeric_limits<size_t>::max())
 {
     LOCK(g_cs_orphans);
 
@@ -577,17 +772,40 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans)
         // Sweep again 5 minutes after the next entry that expires in order to batch the linear scan.
         nNextSweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
         if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
+        g_orphans_expired += nErased;
     }
     FastRandomContext rng;
-    while (mapOrphanTransactions.size() > nMaxOrphans) {
+    while (mapOrphanTransactions.size() > nMaxOrphans || g_orphan_bytes > nMaxOrphanBytes) {
         // Evict a random orphan:
         size_t randompos = rng.randrange(g_orphan_list.size());
         EraseOrphanTx(g_orphan_list[randompos]->first);
         ++nEvicted;
     }
+    g_orphans_evicted += nEvicted;
     return nEvicted;
 }
 
+void GetOrphanTxStats(COrphanTxStats& stats)
+{
+    LOCK(g_cs_orphans);
+    stats.nCount = mapOrphanTransactions.size();
+    stats.nBytes = g_orphan_bytes;
+    stats.mapBytesByPeer = g_orphan_bytes_by_peer;
+    stats.nResolved = g_orphans_resolved;
+    stats.nRejected = g_orphans_rejected;
+    stats.nEvicted = g_orphans_evicted;
+    stats.nExpired = g_orphans_expired;
+    std::vector<std::pair<uint64_t, std::pair<uint256, std::string>>> vRejects;
+    for (const auto& it : g_orphan_reject_reasons) {
+        vRejects.emplace_back(it.second.first, std::make_pair(it.first, it.second.second));
+    }
+    std::sort(vRejects.begin(), vRejects.end());
+    stats.vRecentRejects.clear();
+    for (auto& it : vRejects) {
+        stats.vRecentRejects.emplace_back(std::move(it.second));
+    }
+}
+
 // Requires cs_main.
 void Misbehaving(NodeId pnode, int howmuch, const std::string& message) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
@@ -1088,6 +1306,114 @@ void static ProcessGetData(CNode* pfrom, CConnman* connman, const std::atomic<bo
 }
 
 bool fRequestedSporksIDB = false;
+/**
+ * Move the TX messages waiting right behind the one being processed into vtx, up to
+ * MAX_TX_BATCH_SIZE transactions, so that a flood of transactions is accepted in batches.
+ * The batch stops at the first message that isn't a transaction with a valid checksum; the
+ * peer is then skipped by the message handler for as many rounds as messages were taken.
+ */
+static void TakeQueuedTransactions(CNode* pfrom, CConnman* connman, std::vector<CTransactionRef>& vtx)
+{
+    auto isTx = [](const CNetMessage& msg) {
+        if (memcmp(msg.hdr.pchMessageStart, Params().MessageStart(), MESSAGE_START_SIZE) != 0 ||
+                !msg.hdr.IsValid(Params().MessageStart()) ||
+                msg.hdr.GetCommand() != NetMsgType::TX) {
+            return false;
+        }
+        uint256 hash = msg.GetMessageHash();
+        return memcmp(hash.begin(), msg.hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0;
+    };
+    if (vtx.size() >= MAX_TX_BATCH_SIZE)
+        return;
+    std::list<CNetMessage> msgs;
+    connman->PollMessages(pfrom, MAX_TX_BATCH_SIZE - vtx.size(), isTx, msgs);
+    for (CNetMessage& msg : msgs) {
+        CDataStream vRecv(msg.vRecv.begin(), msg.vRecv.end(), SER_NETWORK, pfrom->GetRecvVersion());
+        try {
+            vtx.emplace_back(MakeTransactionRef(CTransaction(deserialize, vRecv)));
+        } catch (const std::exception& e) {
+            LogPrint(BCLog::NET, "%s: malformed tx message from peer=%d: %s\n", __func__, pfrom->GetId(), e.what());
+        }
+    }
+}
+
+/**
+ * Accept the orphans spending the outputs in vWorkQueue, one batch per generation, punishing
+ * the peers that sent invalid ones. The proof and script checks of a batch run without cs_main.
+ */
+static void ProcessOrphanTxs(std::vector<COutPoint>& vWorkQueue, CConnman* connman) LOCKS_EXCLUDED(cs_main, g_cs_orphans)
+{
+    std::set<NodeId> setMisbehaving;
+    std::set<uint256> setDone;
+    while (!vWorkQueue.empty()) {
+        std::vector<CTransactionRef> vOrphans;
+        std::vector<NodeId> vFromPeer;
+        {
+            LOCK(g_cs_orphans);
+            std::set<uint256> setQueued;
+            for (const COutPoint& outpoint : vWorkQueue) {
+                auto itByPrev = mapOrphanTransactionsByPrev.find(outpoint);
+                if (itByPrev == mapOrphanTransactionsByPrev.end())
+                    continue;
+                for (auto mi = itByPrev->second.begin(); mi != itByPrev->second.end(); ++mi) {
+                    const CTransactionRef& orphanTx = (*mi)->second.tx;
+                    const uint256& orphanHash = orphanTx->GetHash();
+                    NodeId fromPeer = (*mi)->second.fromPeer;
+                    if (setMisbehaving.count(fromPeer) || setDone.count(orphanHash) || !setQueued.insert(orphanHash).second)
+                        continue;
+                    vOrphans.push_back(orphanTx);
+                    vFromPeer.push_back(fromPeer);
+                }
+            }
+        }
+        vWorkQueue.clear();
+        if (vOrphans.empty())
+            break;
+
+        // The states are not relayed back to anyone, so someone can't setup nodes to counter-DoS
+        // based on orphan resolution (that is, feeding people an invalid transaction based on
+        // LegitTxX in order to get anyone relaying LegitTxX banned)
+        std::vector<MemPoolAcceptResult> vResults = AcceptToMemoryPoolBatch(mempool, vOrphans, true);
+
+        LOCK2(cs_main, g_cs_orphans);
+        for (size_t i = 0; i < vOrphans.size(); i++) {
+            const CTransactionRef& orphanTx = vOrphans[i];
+            const uint256& orphanHash = orphanTx->GetHash();
+            const NodeId fromPeer = vFromPeer[i];
+            if (vResults[i].fAccepted) {
+                LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
+                ++g_orphans_resolved;
+                RelayTransaction(*orphanTx, connman);
+                for (unsigned int j = 0; j < orphanTx->vout.size(); j++) {
+                    vWorkQueue.emplace_back(orphanHash, j);
+                }
+                setDone.insert(orphanHash);
+                EraseOrphanTx(orphanHash);
+            } else if (!vResults[i].fMissingInputs) {
+                int nDos = 0;
+                if (vResults[i].state.IsInvalid(nDos) && nDos > 0 && !setMisbehaving.count(fromPeer)) {
+                    // Punish peer that gave us an invalid orphan tx
+                    Misbehaving(fromPeer, nDos);
+                    setMisbehaving.insert(fromPeer);
+                    LogPrint(BCLog::MEMPOOL, "   invalid orphan tx %s\n", orphanHash.ToString());
+                }
+                // Has inputs but not accepted to mempool
+                // Probably non-standard or insufficient fee
+                LogPrint(BCLog::MEMPOOL, "   removed orphan tx %s\n", orphanHash.ToString());
+                setDone.insert(orphanHash);
+                EraseOrphanTx(orphanHash);
+                assert(recentRejects);
+                recentRejects->insert(orphanHash);
+                // Keep the reason, the children of this orphan arriving later get dropped because of it
+                static uint64_t nRejectSequence = 0;
+                g_orphan_reject_reasons.insert(std::make_pair(orphanHash, std::make_pair(++nRejectSequence, FormatStateMessage(vResults[i].state))));
+                ++g_orphans_rejected;
+            }
+        }
+        mempool.check(pcoinsTip.get());
+    }
+}
+
 bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vRecv, int64_t nTimeReceived, CConnman* connman, std::atomic<bool>& interruptMsgProc)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
@@ -1377,9 +1703,15 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             if (inv.type == MSG_BLOCK) {
                 UpdateBlockAvailability(pfrom->GetId(), inv.hash);
                 if (!fAlreadyHave && !fImporting && !fReindex && !mapBlocksInFlight.count(inv.hash)) {
-                    // Add this to the list of blocks to request
-                    vToFetch.push_back(inv);
-                    LogPrint(BCLog::NET, "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
+                    if (SupportsHeadersFirst(pfrom)) {
+                        // Fetch the headers first, the block download logic takes it from there.
+                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), inv.hash));
+                        LogPrint(BCLog::NET, "getheaders (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
+                    } else {
+                        // Add this to the list of blocks to request
+                        vToFetch.push_back(inv);
+                        LogPrint(BCLog::NET, "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
+                    }
                 }
             } else {
                 // Allowed inv request types while we are in IBD
@@ -1424,7 +1756,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     }
 
 
-    else if (strCommand == NetMsgType::GETBLOCKS || strCommand == NetMsgType::GETHEADERS) {
+    else if (strCommand == NetMsgType::GETBLOCKS) {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
@@ -1462,21 +1794,23 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     }
 
 
-    else if (strCommand == NetMsgType::HEADERS && Params().HeadersFirstSyncingActive()) {
+    else if (strCommand == NetMsgType::GETHEADERS) {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
 
         if (locator.vHave.size() > MAX_LOCATOR_SZ) {
-            LogPrint(BCLog::NET, "getblocks locator size %lld > %d, disconnect peer=%d\n", locator.vHave.size(), MAX_LOCATOR_SZ, pfrom->GetId());
+            LogPrint(BCLog::NET, "getheaders locator size %lld > %d, disconnect peer=%d\n", locator.vHave.size(), MAX_LOCATOR_SZ, pfrom->GetId());
             pfrom->fDisconnect = true;
             return true;
         }
 
         LOCK(cs_main);
 
-        if (IsInitialBlockDownload())
+        if (IsInitialBlockDownload() && !pfrom->fWhitelisted) {
+            LogPrint(BCLog::NET, "Ignoring getheaders from peer=%d because node is in initial block download\n", pfrom->GetId());
             return true;
+        }
 
         CBlockIndex* pindex = NULL;
         if (locator.IsNull()) {
@@ -1495,7 +1829,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
         std::vector<CBlock> vHeaders;
         int nLimit = MAX_HEADERS_RESULTS;
-        LogPrintf("getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.ToString(), pfrom->id);
+        LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), pfrom->id);
         for (; pindex; pindex = chainActive.Next(pindex)) {
             vHeaders.push_back(pindex->GetBlockHeader());
             if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
@@ -1506,157 +1840,138 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
 
     else if (strCommand == NetMsgType::TX) {
-        std::deque<COutPoint> vWorkQueue;
-        std::vector<uint256> vEraseQueue;
-        CTransaction tx(deserialize, vRecv);
-        CTransactionRef ptx = MakeTransactionRef(tx);
-
-        CInv inv(MSG_TX, tx.GetHash());
-        pfrom->AddInventoryKnown(inv);
+        // Accept the transactions queued right behind this one together with it
+        std::vector<CTransactionRef> vtx;
+        vtx.emplace_back(MakeTransactionRef(CTransaction(deserialize, vRecv)));
+        TakeQueuedTransactions(pfrom, connman, vtx);
 
-        LOCK2(cs_main, g_cs_orphans);
-
-        bool ignoreFees = false;
-        bool fMissingInputs = false;
-        CValidationState state;
-
-        pfrom->setAskFor.erase(inv.hash);
-        mapAlreadyAskedFor.erase(inv);
-
-        if (ptx->ContainsZerocoins()) {
-            // Don't even try to check zerocoins at all.
-            Misbehaving(pfrom->GetId(), 100, strprintf("received a zc transaction"));
-            return false;
+        {
+            LOCK(cs_main);
+            for (const CTransactionRef& ptx : vtx) {
+                CInv inv(MSG_TX, ptx->GetHash());
+                pfrom->AddInventoryKnown(inv);
+                pfrom->setAskFor.erase(inv.hash);
+                mapAlreadyAskedFor.erase(inv);
+
+                if (ptx->ContainsZerocoins()) {
+                    // Don't even try to check zerocoins at all.
+                    Misbehaving(pfrom->GetId(), 100, strprintf("received a zc transaction"));
+                    return false;
+                }
+            }
         }
 
-        if (AcceptToMemoryPool(mempool, state, ptx, true, &fMissingInputs, false, ignoreFees)) {
-            mempool.check(pcoinsTip.get());
-            RelayTransaction(tx, connman);
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                vWorkQueue.emplace_back(inv.hash, i);
-            }
+        // Not under cs_main: the proof and script checks run while other messages are processed.
+        std::vector<MemPoolAcceptResult> vResults = AcceptToMemoryPoolBatch(mempool, vtx, true);
 
-            LogPrint(BCLog::MEMPOOL, "%s : peer=%d %s : accepted %s (poolsz %u txn, %u kB)\n",
-                    __func__, pfrom->id, pfrom->cleanSubVer, tx.GetHash().ToString(),
-                    mempool.size(), mempool.DynamicMemoryUsage() / 1000);
+        std::vector<COutPoint> vWorkQueue;
+        {
+            LOCK2(cs_main, g_cs_orphans);
+            for (size_t i = 0; i < vtx.size(); i++) {
+                const CTransactionRef& ptx = vtx[i];
+                const CTransaction& tx = *ptx;
+                CValidationState& state = vResults[i].state;
 
-            // Recursively process any orphan transactions that depended on this one
-            std::set<NodeId> setMisbehaving;
-            while (!vWorkQueue.empty()) {
-                auto itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue.front());
-                vWorkQueue.pop_front();
-                if(itByPrev == mapOrphanTransactionsByPrev.end())
-                    continue;
-                for (auto mi = itByPrev->second.begin();
-                    mi != itByPrev->second.end();
-                    ++mi) {
-                    const CTransactionRef& orphanTx = (*mi)->second.tx;
-                    const uint256& orphanHash = orphanTx->GetHash();
-                    NodeId fromPeer = (*mi)->second.fromPeer;
-                    bool fMissingInputs2 = false;
-                    // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
-                    // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
-                    // anyone relaying LegitTxX banned)
-                    CValidationState stateDummy;
+                if (vResults[i].fAccepted) {
+                    mempool.check(pcoinsTip.get());
+                    RelayTransaction(tx, connman);
+                    for (unsigned int j = 0; j < tx.vout.size(); j++) {
+                        vWorkQueue.emplace_back(tx.GetHash(), j);
+                    }
 
+                    LogPrint(BCLog::MEMPOOL, "%s : peer=%d %s : accepted %s (poolsz %u txn, %u kB)\n",
+                            __func__, pfrom->id, pfrom->cleanSubVer, tx.GetHash().ToString(),
+                            mempool.size(), mempool.DynamicMemoryUsage() / 1000);
 
-                    if (setMisbehaving.count(fromPeer))
-                        continue;
-                    if (AcceptToMemoryPool(mempool, stateDummy, orphanTx, true, &fMissingInputs2)) {
-                        LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
-                        RelayTransaction(*orphanTx, connman);
-                        for (unsigned int i = 0; i < orphanTx->vout.size(); i++) {
-                            vWorkQueue.emplace_back(orphanHash, i);
+                } else if (vResults[i].fMissingInputs) {
+                    bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
+
+                    // Deduplicate parent txids, so that we don't have to loop over
+                    // the same parent txid more than once down below.
+                    std::vector<uint256> unique_parents;
+                    unique_parents.reserve(tx.vin.size());
+                    for (const CTxIn& txin : ptx->vin) {
+                        // We start with all parents, and then remove duplicates below.
+                        unique_parents.emplace_back(txin.prevout.hash);
+                    }
+                    std::sort(unique_parents.begin(), unique_parents.end());
+                    unique_parents.erase(std::unique(unique_parents.begin(), unique_parents.end()), unique_parents.end());
+                    for (const uint256& parent_txid : unique_parents) {
+                        if (recentRejects->contains(parent_txid)) {
+                            fRejectedParents = true;
+                            auto itReason = g_orphan_reject_reasons.find(parent_txid);
+                            if (itReason != g_orphan_reject_reasons.end()) {
+                                LogPrint(BCLog::MEMPOOL, "parent %s of %s was rejected: %s\n", parent_txid.ToString(), tx.GetHash().ToString(), itReason->second.second);
+                            }
+                            break;
+                        }
+                    }
+                    if (!fRejectedParents) {
+                        for (const uint256& parent_txid : unique_parents) {
+                            CInv _inv(MSG_TX, parent_txid);
+                            pfrom->AddInventoryKnown(_inv);
+                            if (!AlreadyHave(_inv)) pfrom->AskFor(_inv);
                         }
-                        vEraseQueue.push_back(orphanHash);
-                    } else if (!fMissingInputs2) {
-                        int nDos = 0;
-                        if(stateDummy.IsInvalid(nDos) && nDos > 0) {
-                            // Punish peer that gave us an invalid orphan tx
-                            Misbehaving(fromPeer, nDos);
-                            setMisbehaving.insert(fromPeer);
-                            LogPrint(BCLog::MEMPOOL, "   invalid orphan tx %s\n", orphanHash.ToString());
+                        // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
+                        unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+                        size_t nMaxOrphanBytes = (size_t)std::max((int64_t)0, gArgs.GetArg("-maxorphantxsize", DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE)) * 1000000;
+                        if (AddOrphanTx(ptx, pfrom->GetId(), nMaxOrphanBytes / 100 * ORPHAN_TX_PEER_QUOTA_PERCENT)) {
+                            // The inputs were checked without cs_main: if the missing parents were accepted
+                            // in the meantime, their orphan pass already ran, so retry this one with ours.
+                            bool fHaveInputs = true;
+                            for (const CTxIn& txin : tx.vin) {
+                                if (!mempool.exists(txin.prevout.hash) && !pcoinsTip->HaveCoin(txin.prevout)) {
+                                    fHaveInputs = false;
+                                    break;
+                                }
+                            }
+                            if (fHaveInputs && !tx.vin.empty())
+                                vWorkQueue.push_back(tx.vin[0].prevout);
                         }
-                        // Has inputs but not accepted to mempool
-                        // Probably non-standard or insufficient fee
-                        LogPrint(BCLog::MEMPOOL, "   removed orphan tx %s\n", orphanHash.ToString());
-                        vEraseQueue.push_back(orphanHash);
+                        unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx, nMaxOrphanBytes);
+                        if (nEvicted > 0)
+                            LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
+                    } else {
+                        LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
+                    }
+                } else {
+                    // AcceptToMemoryPool() returned false, possibly because the tx is
+                    // already in the mempool; if the tx isn't in the mempool that
+                    // means it was rejected and we shouldn't ask for it again.
+                    if (!mempool.exists(tx.GetHash())) {
                         assert(recentRejects);
-                        recentRejects->insert(orphanHash);
+                        recentRejects->insert(tx.GetHash());
+                    }
+                    if (pfrom->fWhitelisted) {
+                        // Always relay transactions received from whitelisted peers, even
+                        // if they were rejected from the mempool, allowing the node to
+                        // function as a gateway for nodes hidden behind it.
+                        //
+                        // FIXME: This includes invalid transactions, which means a
+                        // whitelisted peer could get us banned! We may want to change
+                        // that.
+                        RelayTransaction(tx, connman);
                     }
-                    mempool.check(pcoinsTip.get());
                 }
-            }
 
-            for (uint256& hash : vEraseQueue) EraseOrphanTx(hash);
-
-        } else if (fMissingInputs) {
-            bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
-
-            // Deduplicate parent txids, so that we don't have to loop over
-            // the same parent txid more than once down below.
-            std::vector<uint256> unique_parents;
-            unique_parents.reserve(tx.vin.size());
-            for (const CTxIn& txin : ptx->vin) {
-                // We start with all parents, and then remove duplicates below.
-                unique_parents.emplace_back(txin.prevout.hash);
-            }
-            std::sort(unique_parents.begin(), unique_parents.end());
-            unique_parents.erase(std::unique(unique_parents.begin(), unique_parents.end()), unique_parents.end());
-            for (const uint256& parent_txid : unique_parents) {
-                if (recentRejects->contains(parent_txid)) {
-                    fRejectedParents = true;
-                    break;
+                int nDoS = 0;
+                if (state.IsInvalid(nDoS)) {
+                    LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d %s was not accepted into the memory pool: %s\n", tx.GetHash().ToString(),
+                        pfrom->id, pfrom->cleanSubVer,
+                        FormatStateMessage(state));
+                    if (nDoS > 0) {
+                        Misbehaving(pfrom->GetId(), nDoS);
+                    }
                 }
             }
-            if (!fRejectedParents) {
-                for (const uint256& parent_txid : unique_parents) {
-                    CInv _inv(MSG_TX, parent_txid);
-                    pfrom->AddInventoryKnown(_inv);
-                    if (!AlreadyHave(_inv)) pfrom->AskFor(_inv);
-                }
-                AddOrphanTx(ptx, pfrom->GetId());
 
-                // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
-                unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-                unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
-                if (nEvicted > 0)
-                    LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
-            } else {
-                LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
-            }
-        } else {
-            // AcceptToMemoryPool() returned false, possibly because the tx is
-            // already in the mempool; if the tx isn't in the mempool that
-            // means it was rejected and we shouldn't ask for it again.
-            if (!mempool.exists(tx.GetHash())) {
-                assert(recentRejects);
-                recentRejects->insert(tx.GetHash());
-            }
-            if (pfrom->fWhitelisted) {
-                // Always relay transactions received from whitelisted peers, even
-                // if they were rejected from the mempool, allowing the node to
-                // function as a gateway for nodes hidden behind it.
-                //
-                // FIXME: This includes invalid transactions, which means a
-                // whitelisted peer could get us banned! We may want to change
-                // that.
-                RelayTransaction(tx, connman);
-            }
         }
 
-        int nDoS = 0;
-        if (state.IsInvalid(nDoS)) {
-            LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d %s was not accepted into the memory pool: %s\n", tx.GetHash().ToString(),
-                pfrom->id, pfrom->cleanSubVer,
-                FormatStateMessage(state));
-            if (nDoS > 0) {
-                Misbehaving(pfrom->GetId(), nDoS);
-            }
-        }
+        // Process any orphan transactions that depended on the accepted ones
+        ProcessOrphanTxs(vWorkQueue, connman);
     }
 
-    else if (strCommand == NetMsgType::HEADERS && Params().HeadersFirstSyncingActive() && !fImporting && !fReindex) // Ignore headers received while importing
+    else if (strCommand == NetMsgType::HEADERS && !fImporting && !fReindex) // Ignore headers received while importing
     {
         std::vector<CBlockHeader> headers;
 
@@ -1674,43 +1989,69 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         }
 
         LOCK(cs_main);
+        CNodeState* nodestate = State(pfrom->GetId());
 
         if (nCount == 0) {
             // Nothing interesting. Stop asking this peers for more headers.
             return true;
         }
-        CBlockIndex* pindexLast = NULL;
+
+        if (!mapBlockIndex.count(headers[0].hashPrevBlock)) {
+            // Most likely a new block announced on top of headers we don't have yet:
+            // ask for the missing ones, and penalize peers that keep doing it.
+            if (++nodestate->nUnconnectingHeaders % MAX_UNCONNECTING_HEADERS == 0)
+                Misbehaving(pfrom->GetId(), 20, strprintf("%d non-connecting headers", nodestate->nUnconnectingHeaders));
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), UINT256_ZERO));
+            return true;
+        }
+
+        // The proof of stake of a header is only checked with its block: don't index
+        // headers further than MAX_HEADERS_AHEAD above the active tip, and ask for the
+        // rest once the block download caught up.
+        const int nMaxHeight = chainActive.Height() + MAX_HEADERS_AHEAD;
+        const int nPrevHeight = mapBlockIndex.at(headers[0].hashPrevBlock)->nHeight;
+        if (nPrevHeight + (int)headers.size() > nMaxHeight) {
+            headers.resize(std::max(0, nMaxHeight - nPrevHeight));
+            nodestate->fHeadersPaused = true;
+            nodestate->nHeadersSyncTimeout = 0;
+            LogPrint(BCLog::NET, "headers from peer=%d beyond height %d, pausing headers sync\n", pfrom->GetId(), nMaxHeight);
+            if (headers.empty())
+                return true;
+        }
+
+        std::vector<uint256> vNewHashes;
         for (const CBlockHeader& header : headers) {
-            CValidationState state;
-            if (pindexLast != NULL && header.hashPrevBlock != pindexLast->GetBlockHash()) {
-                Misbehaving(pfrom->GetId(), 20, "non-continuous headers sequence");
-                return false;
-            }
+            const uint256& hash = header.GetHash();
+            if (!mapBlockIndex.count(hash))
+                vNewHashes.push_back(hash);
+        }
 
-            /*TODO: this has a CBlock cast on it so that it will compile. There should be a solution for this
-             * before headers are reimplemented on mainnet
-             */
-            if (!AcceptBlockHeader((CBlock)header, state, &pindexLast)) {
-                int nDoS;
-                if (state.IsInvalid(nDoS)) {
-                    if (nDoS > 0) {
-                        Misbehaving(pfrom->GetId(), nDoS, "invalid header received");
-                    } else {
-                        LogPrint(BCLog::NET, "peer=%d: invalid header received\n", pfrom->GetId());
-                    }
-                    return false;
+        CBlockIndex* pindexLast = nullptr;
+        CValidationState state;
+        const bool fAccepted = ProcessNewBlockHeaders(headers, state, &pindexLast);
+        if (!AddUnverifiedHeaders(pfrom->GetId(), vNewHashes)) {
+            Misbehaving(pfrom->GetId(), 100, strprintf("%d headers without block", nodestate->nUnverifiedHeaders));
+            return false;
+        }
+        if (!fAccepted) {
+            int nDoS;
+            if (state.IsInvalid(nDoS)) {
+                if (nDoS > 0) {
+                    Misbehaving(pfrom->GetId(), nDoS, "invalid header received");
+                } else {
+                    LogPrint(BCLog::NET, "peer=%d: invalid header received\n", pfrom->GetId());
                 }
             }
+            return false;
         }
+        nodestate->nUnconnectingHeaders = 0;
 
-        if (pindexLast)
-            UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
+        assert(pindexLast);
+        UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
 
-        if (nCount == MAX_HEADERS_RESULTS && pindexLast) {
+        if (nCount == MAX_HEADERS_RESULTS && !nodestate->fHeadersPaused) {
             // Headers message had its maximum size; the peer may have more headers.
-            // TODO: optimize: if pindexLast is an ancestor of chainActive.Tip or pindexBestHeader, continue
-            // from there instead.
-            LogPrintf("more getheaders (%d) to end to peer=%d (startheight:%d)\n", pindexLast->nHeight, pfrom->id, pfrom->nStartingHeight);
+            LogPrint(BCLog::NET, "more getheaders (%d) to end to peer=%d (startheight:%d)\n", pindexLast->nHeight, pfrom->id, pfrom->nStartingHeight);
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexLast), UINT256_ZERO));
         }
     }
@@ -1725,6 +2066,11 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
         // sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
         if (!mapBlockIndex.count(pblock->hashPrevBlock)) {
+            if (SupportsHeadersFirst(pfrom)) {
+                // Get the missing headers, the block is requested again once they connect.
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, WITH_LOCK(cs_main, return chainActive.GetLocator(pindexBestHeader);), hashBlock));
+                return true;
+            }
             CBlockLocator locator = WITH_LOCK(cs_main, return chainActive.GetLocator(););
             if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
                 // we already asked for this block, so lets work backwards and ask for the previous block
@@ -1737,18 +2083,35 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             }
         } else {
             pfrom->AddInventoryKnown(inv);
-            if (!mapBlockIndex.count(hashBlock)) {
-                {
-                    LOCK(cs_main);
-                    MarkBlockAsReceived(hashBlock);
-                    mapBlockSource.emplace(hashBlock, pfrom->GetId());
+            bool fAlreadyHave = false;
+            bool fProcess = false;
+            {
+                LOCK(cs_main);
+                const bool fRequested = mapBlocksInFlight.count(hashBlock);
+                BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+                // Entries added by headers-first sync have no data yet
+                fAlreadyHave = mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA);
+                MarkBlockAsReceived(hashBlock);
+                if (!fAlreadyHave) {
+                    if (mapBlockIndex.at(pblock->hashPrevBlock)->nStatus & BLOCK_HAVE_DATA) {
+                        mapBlockSource.emplace(hashBlock, pfrom->GetId());
+                        fProcess = true;
+                    } else if (fRequested && !AddBlockPendingParent(pblock, pfrom->GetId())) {
+                        // Downloaded ahead of its parent from another peer, and there is no room
+                        // to keep it: it is requested again later.
+                        LogPrint(BCLog::NET, "%s : dropping block %s received ahead of its parent, peer=%d\n", __func__, hashBlock.GetHex(), pfrom->GetId());
+                    }
                 }
+            }
+            if (fProcess) {
                 ProcessNewBlock(pblock, nullptr);
+                WITH_LOCK(cs_main, MarkHeaderVerified(hashBlock));
+                ProcessBlocksPendingParent(hashBlock);
 
                 // Disconnect node if its running an old protocol version,
                 // used during upgrades, when the node is already connected.
                 pfrom->DisconnectOldProtocol(pfrom->nVersion, ActiveProtocol());
-            } else {
+            } else if (fAlreadyHave) {
                 LogPrint(BCLog::NET, "%s : Already processed block %s, skipping ProcessNewBlock()\n", __func__, pblock->GetHash().GetHex());
             }
         }
@@ -2157,10 +2520,17 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
             if ((nSyncStarted == 0 && fFetch) || pindexBestHeader->GetBlockTime() > GetAdjustedTime() - 6 * 60 * 60) { // NOTE: was "close to today" and 24h in Bitcoin
                 state.fSyncStarted = true;
                 nSyncStarted++;
-                //CBlockIndex *pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
-                //LogPrint(BCLog::NET, "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->id, pto->nStartingHeight);
-                //pto->PushMessage(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexStart), UINT256_ZERO);
-                connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETBLOCKS, chainActive.GetLocator(chainActive.Tip()), UINT256_ZERO));
+                if (SupportsHeadersFirst(pto)) {
+                    // Start one block before our best header, so that the reply is never empty and
+                    // tells us which blocks this peer has.
+                    const CBlockIndex* pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
+                    state.nHeadersSyncTimeout = GetTimeMicros() + HEADERS_DOWNLOAD_TIMEOUT_BASE + HEADERS_DOWNLOAD_TIMEOUT_PER_HEADER *
+                            (GetAdjustedTime() - pindexBestHeader->GetBlockTime()) / Params().GetConsensus().nTargetSpacing;
+                    LogPrint(BCLog::NET, "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->id, pto->nStartingHeight);
+                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexStart), UINT256_ZERO));
+                } else {
+                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETBLOCKS, chainActive.GetLocator(chainActive.Tip()), UINT256_ZERO));
+                }
             }
         }
 
@@ -2296,6 +2666,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
             // the download window should be much larger than the to-be-downloaded set of blocks, so disconnection
             // should only happen during initial block download.
             LogPrintf("Peer=%d is stalling block download, disconnecting\n", pto->id);
+            EraseBlocksPendingParentFrom(pto->GetId());
             pto->fDisconnect = true;
             return true;
         }
@@ -2310,11 +2681,42 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
             return true;
         }
 
+        // Check for headers sync timeouts
+        if (state.fSyncStarted && state.nHeadersSyncTimeout > 0) {
+            if (pindexBestHeader->GetBlockTime() > GetAdjustedTime() - 6 * 60 * 60) {
+                // Headers are caught up, no need for a timeout anymore
+                state.nHeadersSyncTimeout = 0;
+            } else if (nNow > state.nHeadersSyncTimeout && nSyncStarted == 1 && (nPreferredDownload - state.fPreferredDownload >= 1)) {
+                // This is our only headers sync peer and it is too slow: rotate to another one,
+                // unless it's the only peer we download from.
+                if (!pto->fWhitelisted) {
+                    LogPrintf("Timeout downloading headers from peer=%d, disconnecting\n", pto->GetId());
+                    pto->fDisconnect = true;
+                    return true;
+                }
+                LogPrintf("Timeout downloading headers from whitelisted peer=%d, not disconnecting\n", pto->GetId());
+                state.fSyncStarted = false;
+                nSyncStarted--;
+                state.nHeadersSyncTimeout = 0;
+            }
+        }
+
+        // Resume a paused headers sync once the block download caught up
+        if (state.fHeadersPaused && state.pindexBestKnownBlock &&
+                state.pindexBestKnownBlock->nHeight < chainActive.Height() + MAX_HEADERS_AHEAD / 2) {
+            state.fHeadersPaused = false;
+            LogPrint(BCLog::NET, "resume getheaders (%d) to peer=%d\n", state.pindexBestKnownBlock->nHeight, pto->GetId());
+            connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(state.pindexBestKnownBlock), UINT256_ZERO));
+        }
+
         //
         // Message: getdata (blocks)
         //
         std::vector<CInv> vGetData;
-        if (!pto->fClient && fFetch && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        // Don't download more blocks from a peer while too many of them wait for their parent.
+        const bool fPendingRoom = state.nBlocksPendingParent < MAX_BLOCKS_PENDING_PARENT_PER_PEER &&
+                nBlocksPendingParentSize < MAX_BLOCKS_PENDING_PARENT_SIZE;
+        if (!pto->fClient && fFetch && fPendingRoom && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
             FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
@@ -13,7 +13,13 @@
 extern RecursiveMutex cs_main; // !TODO: change mutex to cs_orphans
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
-static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 25;
+static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 1000;
+/** Default for -maxorphantxsize, maximum size of the orphan transactions kept in memory, in megabytes */
+static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE = 10;
+/** Share of the orphan pool size limit that the orphans of a single peer can take, in percent */
+static const unsigned int ORPHAN_TX_PEER_QUOTA_PERCENT = 25;
+/** Number of orphan reject reasons kept for getorphaninfo and logging */
+static const unsigned int MAX_ORPHAN_REJECT_REASONS = 100;
 /** Expiration time for orphan transactions in seconds */
 static const int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
 /** Minimum time between orphan transactions expire time checks in seconds */
@@ -68,6 +74,21 @@ struct CNodeStateStats {
 
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats);
+
+struct COrphanTxStats {
+    size_t nCount;
+    size_t nBytes;
+    std::map<NodeId, size_t> mapBytesByPeer;
+    uint64_t nResolved;
+    uint64_t nRejected;
+    uint64_t nEvicted;
+    uint64_t nExpired;
+    //! Most recent last
+    std::vector<std::pair<uint256, std::string>> vRecentRejects;
+};
+
+/** Get statistics from the orphan transaction pool */
+void GetOrphanTxStats(COrphanTxStats& stats);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch, const std::string& message="") EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
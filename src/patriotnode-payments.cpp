@@ -8,6 +8,7 @@
 #include "chainparams.h"
 #include "evo/deterministicmns.h"
 #include "fs.h"
+#include "budget/budgetdb.h"
 #include "budget/budgetmanager.h"
 #include "patriotnode-sync.h"
 #include "patriotnodeman.h"
@@ -26,122 +27,117 @@ RecursiveMutex cs_vecPayments;
 RecursiveMutex cs_mapPatriotnodeBlocks;
 RecursiveMutex cs_mapPatriotnodePayeeVotes;
 
-static const int PNPAYMENTS_DB_VERSION = 1;
+static const char DB_WINNER = 'w';
+
+std::unique_ptr<CPatriotnodePaymentDB> pPatriotnodePaymentDB;
 
 //
 // CPatriotnodePaymentDB
 //
 
-CPatriotnodePaymentDB::CPatriotnodePaymentDB()
-{
-    pathDB = GetDataDir() / "mnpayments.dat";
-    strMagicMessage = "PatriotnodePayments";
-}
+CPatriotnodePaymentDB::CPatriotnodePaymentDB(bool fMemory, bool fWipe) :
+        CDBWrapper(GetDataDir() / "mnpayments", 0, fMemory, fWipe)
+{ }
 
-bool CPatriotnodePaymentDB::Write(const CPatriotnodePayments& objToSave)
+bool CPatriotnodePaymentDB::Write(CPatriotnodePayments& objToSave)
 {
     int64_t nStart = GetTimeMillis();
 
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-    ssObj << PNPAYMENTS_DB_VERSION;
-    ssObj << strMagicMessage;                   // patriotnode cache file specific magic message
-    ssObj << Params().MessageStart(); // network specific magic number
-    ssObj << objToSave;
-    uint256 hash = Hash(ssObj.begin(), ssObj.end());
-    ssObj << hash;
-
-    // open output file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "wb");
-    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathDB.string());
-
-    // Write and commit header, data
-    try {
-        fileout << ssObj;
-    } catch (const std::exception& e) {
-        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    CDBBatch batch;
+    std::set<uint256> setDirty;
+    int nWritten = 0;
+    {
+        LOCK(cs_mapPatriotnodePayeeVotes);
+        setDirty.swap(objToSave.setDirtyWinners);
+        for (const uint256& hash : setDirty) {
+            const auto it = objToSave.mapPatriotnodePayeeVotes.find(hash);
+            if (it != objToSave.mapPatriotnodePayeeVotes.end()) {
+                batch.Write(std::make_pair(DB_WINNER, hash), it->second);
+                nWritten++;
+            } else {
+                batch.Erase(std::make_pair(DB_WINNER, hash));
+            }
+        }
+    }
+
+    if (!WriteBatch(batch, true)) {
+        // try again on the next write
+        WITH_LOCK(cs_mapPatriotnodePayeeVotes, objToSave.setDirtyWinners.insert(setDirty.begin(), setDirty.end()); );
+        return error("%s : Failed to write patriotnode payments", __func__);
     }
-    fileout.fclose();
 
-    LogPrint(BCLog::PATRIOTNODE,"Written info to mnpayments.dat  %dms\n", GetTimeMillis() - nStart);
+    LogPrint(BCLog::PATRIOTNODE,"Written %d winners, erased %d, to mnpayments db  %dms\n",
+             nWritten, setDirty.size() - nWritten, GetTimeMillis() - nStart);
 
     return true;
 }
 
-CPatriotnodePaymentDB::ReadResult CPatriotnodePaymentDB::Read(CPatriotnodePayments& objToLoad)
+void CPatriotnodePaymentDB::ImportLegacyFile()
 {
-    int64_t nStart = GetTimeMillis();
-    // open input file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "rb");
-    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        error("%s : Failed to open file %s", __func__, pathDB.string());
-        return FileError;
-    }
-
-    // use file size to size memory buffer
-    int fileSize = fs::file_size(pathDB);
-    int dataSize = fileSize - sizeof(uint256);
-    // Don't try to resize to a negative number if file is small
-    if (dataSize < 0)
-        dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
-    uint256 hashIn;
-
-    // read data and checksum from file
-    try {
-        filein.read((char*)vchData.data(), dataSize);
-        filein >> hashIn;
-    } catch (const std::exception& e) {
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return HashReadError;
-    }
-    filein.fclose();
+    const fs::path pathLegacy = GetDataDir() / "mnpayments.dat";
+    if (!fs::exists(pathLegacy)) return;
 
-    CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
-    // verify stored checksum matches input data
-    uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-    if (hashIn != hashTmp) {
-        error("%s : Checksum mismatch, data corrupted", __func__);
-        return IncorrectHash;
+    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+    if (ReadLegacyCacheFile(pathLegacy, "PatriotnodePayments", ssObj)) {
+        try {
+            // the block payees are rebuilt from the winners
+            std::map<uint256, CPatriotnodePaymentWinner> mapWinners;
+            ssObj >> mapWinners;
+            CDBBatch batch;
+            for (const auto& it : mapWinners) {
+                batch.Write(std::make_pair(DB_WINNER, it.first), it.second);
+            }
+            if (WriteBatch(batch, true)) {
+                LogPrintf("Imported %d patriotnode winners from %s\n", mapWinners.size(), pathLegacy.string());
+            }
+        } catch (const std::exception& e) {
+            error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
     }
 
-    int version;
-    std::string strMagicMessageTmp;
+    // the data is synced again from the network if it could not be imported
     try {
-        // de-serialize file header
-        ssObj >> version;
-        ssObj >> strMagicMessageTmp;
+        fs::remove(pathLegacy);
+    } catch (const fs::filesystem_error& e) {
+        LogPrintf("%s: Unable to remove %s: %s\n", __func__, pathLegacy.string(), fsbridge::get_filesystem_error_message(e));
+    }
+}
 
-        // ... verify the message matches predefined one
-        if (strMagicMessage != strMagicMessageTmp) {
-            error("%s : Invalid patriotnode payement cache magic message", __func__);
-            return IncorrectMagicMessage;
-        }
+CPatriotnodePaymentDB::ReadResult CPatriotnodePaymentDB::Read(CPatriotnodePayments& objToLoad)
+{
+    int64_t nStart = GetTimeMillis();
 
-        // de-serialize file header (network specific magic number) and ..
-        std::vector<unsigned char> pchMsgTmp(4);
-        ssObj >> MakeSpan(pchMsgTmp);
+    ImportLegacyFile();
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_WINNER, UINT256_ZERO));
 
-        // ... verify the network matches ours
-        if (memcmp(pchMsgTmp.data(), Params().MessageStart(), pchMsgTmp.size()) != 0) {
-            error("%s : Invalid network magic number", __func__);
-            return IncorrectMagicNumber;
+    int nLoaded = 0;
+    while (pcursor->Valid()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_WINNER) break;
+        CPatriotnodePaymentWinner winner;
+        if (!pcursor->GetValue(winner)) {
+            objToLoad.Clear();
+            error("%s : Unable to read winner %s", __func__, key.second.ToString());
+            pcursor.reset();
+            if (!WipeCacheDB(*this)) error("%s : Failed to wipe mnpayments db", __func__);
+            return IncorrectFormat;
         }
+        {
+            LOCK2(cs_mapPatriotnodePayeeVotes, cs_mapPatriotnodeBlocks);
+            objToLoad.mapPatriotnodePayeeVotes.emplace(key.second, winner);
+            auto it = objToLoad.mapPatriotnodeBlocks.emplace(winner.nBlockHeight, CPatriotnodeBlockPayees(winner.nBlockHeight)).first;
+            it->second.AddPayee(winner.payee, 1);
+        }
+        nLoaded++;
+        pcursor->Next();
+    }
 
-        // de-serialize data into CPatriotnodePayments object
-        ssObj >> objToLoad;
-    } catch (const std::exception& e) {
-        objToLoad.Clear();
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return IncorrectFormat;
+    if (nLoaded == 0) {
+        return Empty;
     }
 
-    LogPrint(BCLog::PATRIOTNODE,"Loaded info from mnpayments.dat (dbversion=%d) %dms\n", version, GetTimeMillis() - nStart);
+    LogPrint(BCLog::PATRIOTNODE,"Loaded %d winners from mnpayments db  %dms\n", nLoaded, GetTimeMillis() - nStart);
     LogPrint(BCLog::PATRIOTNODE,"  %s\n", objToLoad.ToString());
 
     return Ok;
@@ -195,11 +191,11 @@ void DumpPatriotnodePayments()
 {
     int64_t nStart = GetTimeMillis();
 
-    CPatriotnodePaymentDB paymentdb;
-    LogPrint(BCLog::PATRIOTNODE,"Writing info to mnpayments.dat...\n");
-    paymentdb.Write(patriotnodePayments);
+    if (!pPatriotnodePaymentDB) return;
+    LogPrint(BCLog::PATRIOTNODE,"Writing changes to mnpayments db...\n");
+    pPatriotnodePaymentDB->Write(patriotnodePayments);
 
-    LogPrint(BCLog::PATRIOTNODE,"Budget dump finished  %dms\n", GetTimeMillis() - nStart);
+    LogPrint(BCLog::PATRIOTNODE,"Patriotnode payments dump finished  %dms\n", GetTimeMillis() - nStart);
 }
 
 bool IsBlockValueValid(int nHeight, CAmount& nExpectedValue, CAmount nMinted, CAmount& nBudgetAmt)
@@ -314,9 +310,9 @@ bool CPatriotnodePayments::GetLegacyPatriotnodeTxOut(int nHeight, std::vector<CT
     if (!GetBlockPayee(nHeight, payee)) {
         //no patriotnode detected
         const Consensus::Params& consensus = Params().GetConsensus();
-        const uint256& hash = consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V5_3) ?
-                              mnodeman.GetHashAtHeight(nHeight - 1) : consensus.hashGenesisBlock;
-        PatriotnodeRef winningNode = mnodeman.GetCurrentPatriotNode(hash);
+        const bool fV53 = consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V5_3);
+        const uint256& hash = fV53 ? mnodeman.GetHashAtHeight(nHeight - 1) : consensus.hashGenesisBlock;
+        PatriotnodeRef winningNode = mnodeman.GetCurrentPatriotNode(hash, fV53 ? nHeight - 1 : 0);
         if (winningNode) {
             payee = winningNode->GetPayeeScript();
         } else {
@@ -470,7 +466,7 @@ void CPatriotnodePayments::ProcessMessagePatriotnodePayments(CNode* pfrom, std::
             fDeterministic = true;
             mnKeyID = Optional<CKeyID>(dmn->pdmnState->keyIDOperator);
         } else {
-            const CPatriotnode* pmn = mnodeman.Find(winner.vinPatriotnode.prevout);
+            PatriotnodeRef pmn = mnodeman.Find(winner.vinPatriotnode.prevout);
             if (pmn) {
                 mnKeyID = Optional<CKeyID>(pmn->pubKeyPatriotnode.GetID());
             }
@@ -559,6 +555,7 @@ bool CPatriotnodePayments::AddWinningPatriotnode(CPatriotnodePaymentWinner& winn
         }
 
         mapPatriotnodePayeeVotes[winnerIn.GetHash()] = winnerIn;
+        setDirtyWinners.emplace(winnerIn.GetHash());
 
         if (!mapPatriotnodeBlocks.count(winnerIn.nBlockHeight)) {
             CPatriotnodeBlockPayees blockPayees(winnerIn.nBlockHeight);
@@ -696,6 +693,7 @@ void CPatriotnodePayments::CleanPaymentList(int mnCount, int nHeight)
         if (nHeight - winner.nBlockHeight > nLimit) {
             LogPrint(BCLog::PATRIOTNODE, "CPatriotnodePayments::CleanPaymentList - Removing old Patriotnode payment - block %d\n", winner.nBlockHeight);
             patriotnodeSync.mapSeenSyncPNW.erase((*it).first);
+            setDirtyWinners.emplace((*it).first);
             mapPatriotnodePayeeVotes.erase(it++);
             mapPatriotnodeBlocks.erase(winner.nBlockHeight);
         } else {
@@ -6,6 +6,7 @@
 #ifndef PATRIOTNODE_PAYMENTS_H
 #define PATRIOTNODE_PAYMENTS_H
 
+#include "dbwrapper.h"
 #include "key.h"
 #include "patriotnode.h"
 #include "validationinterface.h"
@@ -38,30 +39,30 @@ bool IsCoinbaseValueValid(const CTransactionRef& tx, CAmount nBudgetAmt, CValida
 
 void DumpPatriotnodePayments();
 
-/** Save Patriotnode Payment Data (mnpayments.dat)
+/** Save Patriotnode Payment Data (mnpayments/ leveldb)
+ * One record per payment winner. Write only stores the winners added or removed since the
+ * last write, Read rebuilds the block payees from the winners.
  */
-class CPatriotnodePaymentDB
+class CPatriotnodePaymentDB : public CDBWrapper
 {
 private:
-    fs::path pathDB;
-    std::string strMagicMessage;
+    // Import mnpayments.dat, written by older versions, and remove it
+    void ImportLegacyFile();
 
 public:
     enum ReadResult {
         Ok,
-        FileError,
-        HashReadError,
-        IncorrectHash,
-        IncorrectMagicMessage,
-        IncorrectMagicNumber,
+        Empty,
         IncorrectFormat
     };
 
-    CPatriotnodePaymentDB();
-    bool Write(const CPatriotnodePayments& objToSave);
+    CPatriotnodePaymentDB(bool fMemory = false, bool fWipe = false);
+    bool Write(CPatriotnodePayments& objToSave);
     ReadResult Read(CPatriotnodePayments& objToLoad);
 };
 
+extern std::unique_ptr<CPatriotnodePaymentDB> pPatriotnodePaymentDB;
+
 class CPatriotnodePayee
 {
 public:
@@ -206,7 +207,10 @@ public:
 class CPatriotnodePayments : public CValidationInterface
 {
 private:
+    friend class CPatriotnodePaymentDB;
     int nLastBlockHeight;
+    // winners added or removed since the last write to the db
+    std::set<uint256> setDirtyWinners; // guarded by cs_mapPatriotnodePayeeVotes
 
 public:
     std::map<uint256, CPatriotnodePaymentWinner> mapPatriotnodePayeeVotes;
@@ -221,6 +225,9 @@ public:
     void Clear()
     {
         LOCK2(cs_mapPatriotnodeBlocks, cs_mapPatriotnodePayeeVotes);
+        for (const auto& it : mapPatriotnodePayeeVotes) {
+            setDirtyWinners.emplace(it.first);
+        }
         mapPatriotnodeBlocks.clear();
         mapPatriotnodePayeeVotes.clear();
     }
@@ -262,8 +269,6 @@ public:
     std::string GetRequiredPaymentsString(int nBlockHeight);
     void FillBlockPayee(CMutableTransaction& txCoinbase, CMutableTransaction& txCoinstake, const CBlockIndex* pindexPrev, bool fProofOfStake) const;
     std::string ToString() const;
-
-    SERIALIZE_METHODS(CPatriotnodePayments, obj) { READWRITE(obj.mapPatriotnodePayeeVotes, obj.mapPatriotnodeBlocks); }
 };
 
 
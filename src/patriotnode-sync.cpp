@@ -311,11 +311,19 @@ void CPatriotnodeSync::Process()
     }
 
     // Mainnet sync
+    BeginRequestRound();
     g_connman->ForEachNodeInRandomOrderContinueIf([sync, fLegacyMnObsolete](CNode* pnode){
         return sync->SyncWithNode(pnode, fLegacyMnObsolete);
     });
 }
 
+bool CPatriotnodeSync::RequestedNextPeer()
+{
+    // ask other peers in the same round, up to PATRIOTNODE_SYNC_REQUESTS_PER_ROUND,
+    // then sleep before doing another request round.
+    return ++nRoundRequests < PATRIOTNODE_SYNC_REQUESTS_PER_ROUND;
+}
+
 bool CPatriotnodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
 {
     CNetMsgMaker msgMaker(pnode->GetSendVersion());
@@ -326,9 +334,12 @@ bool CPatriotnodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
         pnode->FulfilledRequest("getspork");
 
         g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETSPORKS)); //get current network sporks
-        if (RequestedPatriotnodeAttempt >= 2) SwitchToNextAsset();
+        if (RequestedPatriotnodeAttempt >= 2) {
+            SwitchToNextAsset();
+            return false;
+        }
         RequestedPatriotnodeAttempt++;
-        return false;
+        return RequestedNextPeer();
     }
 
     if (pnode->nVersion >= ActiveProtocol()) {
@@ -348,7 +359,7 @@ bool CPatriotnodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
 
             // timeout
             if (lastPatriotnodeList == 0 &&
-                (RequestedPatriotnodeAttempt >= PATRIOTNODE_SYNC_THRESHOLD * 3 || GetTime() - nAssetSyncStarted > PATRIOTNODE_SYNC_TIMEOUT * 5)) {
+                (RequestedPatriotnodeAttempt >= PATRIOTNODE_SYNC_THRESHOLD * 3 * PATRIOTNODE_SYNC_REQUESTS_PER_ROUND || GetTime() - nAssetSyncStarted > PATRIOTNODE_SYNC_TIMEOUT * 5)) {
                 if (sporkManager.IsSporkActive(SPORK_8_PATRIOTNODE_PAYMENT_ENFORCEMENT)) {
                     LogPrintf("CPatriotnodeSync::Process - ERROR - Sync has failed on %s, will retry later\n", "PATRIOTNODE_SYNC_LIST");
                     RequestedPatriotnodeAssets = PATRIOTNODE_SYNC_FAILED;
@@ -361,8 +372,8 @@ bool CPatriotnodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
                 return false;
             }
 
-            // Don't request mnlist initial sync to more than 8 randomly ordered peers in this round
-            if (RequestedPatriotnodeAttempt >= PATRIOTNODE_SYNC_THRESHOLD * 4) return false;
+            // Don't request mnlist initial sync for more than 8 rounds of randomly ordered peers
+            if (RequestedPatriotnodeAttempt >= PATRIOTNODE_SYNC_THRESHOLD * 4 * PATRIOTNODE_SYNC_REQUESTS_PER_ROUND) return false;
 
             // Request mnb sync if we haven't requested it yet.
             if (pnode->HasFulfilledRequest("mnsync")) return true;
@@ -377,7 +388,7 @@ bool CPatriotnodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
             // Increase the sync attempt count
             RequestedPatriotnodeAttempt++;
 
-            return false; // sleep 1 second before do another request round.
+            return RequestedNextPeer();
         }
 
         if (RequestedPatriotnodeAssets == PATRIOTNODE_SYNC_PNW) {
@@ -393,7 +404,7 @@ bool CPatriotnodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
 
             // timeout
             if (lastPatriotnodeWinner == 0 &&
-                (RequestedPatriotnodeAttempt >= PATRIOTNODE_SYNC_THRESHOLD * 3 || GetTime() - nAssetSyncStarted > PATRIOTNODE_SYNC_TIMEOUT * 5)) {
+                (RequestedPatriotnodeAttempt >= PATRIOTNODE_SYNC_THRESHOLD * 3 * PATRIOTNODE_SYNC_REQUESTS_PER_ROUND || GetTime() - nAssetSyncStarted > PATRIOTNODE_SYNC_TIMEOUT * 5)) {
                 if (sporkManager.IsSporkActive(SPORK_8_PATRIOTNODE_PAYMENT_ENFORCEMENT)) {
                     LogPrintf("CPatriotnodeSync::Process - ERROR - Sync has failed on %s, will retry later\n", "PATRIOTNODE_SYNC_PNW");
                     RequestedPatriotnodeAssets = PATRIOTNODE_SYNC_FAILED;
@@ -406,8 +417,8 @@ bool CPatriotnodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
                 return false;
             }
 
-            // Don't request mnw initial sync to more than 6 randomly ordered peers in this round.
-            if (RequestedPatriotnodeAttempt >= PATRIOTNODE_SYNC_THRESHOLD * 3) return false;
+            // Don't request mnw initial sync for more than 6 rounds of randomly ordered peers.
+            if (RequestedPatriotnodeAttempt >= PATRIOTNODE_SYNC_THRESHOLD * 3 * PATRIOTNODE_SYNC_REQUESTS_PER_ROUND) return false;
 
             // Request mnw sync if we haven't requested it yet.
             if (pnode->HasFulfilledRequest("mnwsync")) return true;
@@ -420,7 +431,7 @@ bool CPatriotnodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
             g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETPNWINNERS, nMnCount));
             RequestedPatriotnodeAttempt++;
 
-            return false; // sleep 1 second before do another request round.
+            return RequestedNextPeer();
         }
 
         if (RequestedPatriotnodeAssets == PATRIOTNODE_SYNC_BUDGET) {
@@ -458,7 +469,9 @@ bool CPatriotnodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
             g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BUDGETVOTESYNC, n));
             RequestedPatriotnodeAttempt++;
 
-            return false; // sleep 1 second before do another request round.
+            // Each peer replies with all the proposals, budgets and votes: ask a single one
+            // per round, then sleep before doing another request round.
+            return false;
         }
     }
 
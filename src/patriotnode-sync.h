@@ -25,6 +25,8 @@
 
 #define PATRIOTNODE_SYNC_TIMEOUT 5
 #define PATRIOTNODE_SYNC_THRESHOLD 2
+// max number of peers asked for the current asset in a single Process() round
+static constexpr int PATRIOTNODE_SYNC_REQUESTS_PER_ROUND = 3;
 
 class CPatriotnodeSync;
 extern CPatriotnodeSync patriotnodeSync;
@@ -91,6 +93,8 @@ public:
      * Otherwise Process() calls it again for a different node.
      */
     bool SyncWithNode(CNode* pnode, bool fLegacyMnObsolete);
+    // Start a new Process() round of SyncWithNode calls
+    void BeginRequestRound() { nRoundRequests = 0; }
     bool IsSynced();
     bool NotCompleted();
     bool IsSporkListSynced();
@@ -108,6 +112,10 @@ private:
     // Tier two sync node state
     // map of nodeID --> TierTwoPeerData
     std::map<NodeId, TierTwoPeerData> peersSyncState;
+    // requests sent in the current Process() round
+    int nRoundRequests{0};
+    // count a request sent in this round. Returns true if another peer can be asked.
+    bool RequestedNextPeer();
     static int GetNextAsset(int currentAsset);
 
     void SyncRegtest(CNode* pnode);
@@ -423,7 +423,7 @@ bool CPatriotnodeBroadcast::CheckAndUpdate(int& nDos, int nChainHeight)
     }
 
     //search existing Patriotnode list, this is where we update existing Patriotnodes with new mnb broadcasts
-    CPatriotnode* pmn = mnodeman.Find(vin.prevout);
+    PatriotnodeRef pmn = mnodeman.Find(vin.prevout);
 
     // no such patriotnode, nothing to update
     if (pmn == NULL) return true;
@@ -461,7 +461,7 @@ bool CPatriotnodeBroadcast::CheckInputsAndAdd(int nChainHeight, int& nDoS)
     }
 
     // search existing Patriotnode list
-    CPatriotnode* pmn = mnodeman.Find(vin.prevout);
+    PatriotnodeRef pmn = mnodeman.Find(vin.prevout);
     if (pmn != NULL) {
         // nothing to do here if we already know about this patriotnode and it's enabled
         if (pmn->IsEnabled()) return true;
@@ -577,7 +577,7 @@ bool CPatriotnodePing::CheckAndUpdate(int& nDos, int nChainHeight, bool fRequire
     }
 
     // see if we have this Patriotnode
-    CPatriotnode* pmn = mnodeman.Find(vin.prevout);
+    PatriotnodeRef pmn = mnodeman.Find(vin.prevout);
     const bool isPatriotnodeFound = (pmn != nullptr);
     const bool isSignatureValid = (isPatriotnodeFound && CheckSignature(pmn->pubKeyPatriotnode.GetID()));
 
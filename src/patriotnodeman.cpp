@@ -16,6 +16,7 @@
 #include "netmessagemaker.h"
 #include "net_processing.h"
 #include "spork.h"
+#include "validation.h"
 
 #include <boost/thread/thread.hpp>
 
@@ -206,6 +207,7 @@ bool CPatriotnodeMan::Add(CPatriotnode& mn)
     if (it == mapPatriotnodes.end()) {
         LogPrint(BCLog::PATRIOTNODE, "Adding new Patriotnode %s\n", mn.vin.prevout.ToString());
         mapPatriotnodes.emplace(mn.vin.prevout, std::make_shared<CPatriotnode>(mn));
+        fSnapshotStale = true;
         LogPrint(BCLog::PATRIOTNODE, "Patriotnode added. New total count: %d\n", mapPatriotnodes.size());
         return true;
     }
@@ -249,6 +251,7 @@ int CPatriotnodeMan::CheckAndRemove(bool forceExpiredRemoval)
     LOCK(cs);
 
     //remove inactive and outdated (or replaced by DPN)
+    std::set<COutPoint> setRemoved;
     auto it = mapPatriotnodes.begin();
     while (it != mapPatriotnodes.end()) {
         PatriotnodeRef& mn = it->second;
@@ -259,35 +262,30 @@ int CPatriotnodeMan::CheckAndRemove(bool forceExpiredRemoval)
             mn->protocolVersion < ActiveProtocol() ||
             (reject_v0 && mn->nMessVersion != MessageVersion::MESS_VER_HASH)) {
             LogPrint(BCLog::PATRIOTNODE, "Removing inactive (legacy) Patriotnode %s\n", it->first.ToString());
-            //erase all of the broadcasts we've seen from this vin
-            // -- if we missed a few pings and the node was removed, this will allow is to get it back without them
-            //    sending a brand new mnb
-            std::map<uint256, CPatriotnodeBroadcast>::iterator it3 = mapSeenPatriotnodeBroadcast.begin();
-            while (it3 != mapSeenPatriotnodeBroadcast.end()) {
-                if (it3->second.vin == it->second->vin) {
-                    patriotnodeSync.mapSeenSyncPNB.erase((*it3).first);
-                    it3 = mapSeenPatriotnodeBroadcast.erase(it3);
-                } else {
-                    ++it3;
-                }
-            }
-
             // allow us to ask for this patriotnode again if we see another ping
-            std::map<COutPoint, int64_t>::iterator it2 = mWeAskedForPatriotnodeListEntry.begin();
-            while (it2 != mWeAskedForPatriotnodeListEntry.end()) {
-                if (it2->first == it->first) {
-                    it2 = mWeAskedForPatriotnodeListEntry.erase(it2);
-                } else {
-                    ++it2;
-                }
-            }
-
+            mWeAskedForPatriotnodeListEntry.erase(it->first);
+            setRemoved.emplace(it->first);
             it = mapPatriotnodes.erase(it);
             LogPrint(BCLog::PATRIOTNODE, "Patriotnode removed.\n");
         } else {
             ++it;
         }
     }
+    if (!setRemoved.empty()) {
+        fSnapshotStale = true;
+        //erase all of the broadcasts we've seen from the removed vins
+        // -- if we missed a few pings and the node was removed, this will allow is to get it back without them
+        //    sending a brand new mnb
+        auto it3 = mapSeenPatriotnodeBroadcast.begin();
+        while (it3 != mapSeenPatriotnodeBroadcast.end()) {
+            if (setRemoved.count(it3->second.vin.prevout)) {
+                patriotnodeSync.mapSeenSyncPNB.erase((*it3).first);
+                it3 = mapSeenPatriotnodeBroadcast.erase(it3);
+            } else {
+                ++it3;
+            }
+        }
+    }
     LogPrint(BCLog::PATRIOTNODE, "New total patriotnode count: %d\n", mapPatriotnodes.size());
 
     // check who's asked for the Patriotnode list
@@ -320,26 +318,12 @@ int CPatriotnodeMan::CheckAndRemove(bool forceExpiredRemoval)
         }
     }
 
-    // remove expired mapSeenPatriotnodeBroadcast
-    std::map<uint256, CPatriotnodeBroadcast>::iterator it3 = mapSeenPatriotnodeBroadcast.begin();
-    while (it3 != mapSeenPatriotnodeBroadcast.end()) {
-        if ((*it3).second.lastPing.sigTime < GetTime() - (PatriotnodeRemovalSeconds() * 2)) {
-            patriotnodeSync.mapSeenSyncPNB.erase((*it3).second.GetHash());
-            it3 = mapSeenPatriotnodeBroadcast.erase(it3);
-        } else {
-            ++it3;
-        }
-    }
-
-    // remove expired mapSeenPatriotnodePing
-    std::map<uint256, CPatriotnodePing>::iterator it4 = mapSeenPatriotnodePing.begin();
-    while (it4 != mapSeenPatriotnodePing.end()) {
-        if ((*it4).second.sigTime < GetTime() - (PatriotnodeRemovalSeconds() * 2)) {
-            it4 = mapSeenPatriotnodePing.erase(it4);
-        } else {
-            ++it4;
-        }
+    // remove expired mapSeenPatriotnodeBroadcast and mapSeenPatriotnodePing
+    const int64_t nSeenCutoff = GetTime() - (PatriotnodeRemovalSeconds() * 2);
+    for (const uint256& hash : mapSeenPatriotnodeBroadcast.EraseOlderThan(nSeenCutoff)) {
+        patriotnodeSync.mapSeenSyncPNB.erase(hash);
     }
+    mapSeenPatriotnodePing.EraseOlderThan(nSeenCutoff);
 
     return mapPatriotnodes.size();
 }
@@ -348,6 +332,7 @@ void CPatriotnodeMan::Clear()
 {
     LOCK(cs);
     mapPatriotnodes.clear();
+    fSnapshotStale = true;
     mAskedUsForPatriotnodeList.clear();
     mWeAskedForPatriotnodeList.clear();
     mWeAskedForPatriotnodeListEntry.clear();
@@ -361,7 +346,7 @@ int CPatriotnodeMan::stable_size() const
     int nStable_size = 0;
     int nMinProtocol = ActiveProtocol();
 
-    for (const auto& it : mapPatriotnodes) {
+    for (const auto& it : *GetSnapshot()) {
         const PatriotnodeRef& mn = it.second;
         if (mn->protocolVersion < nMinProtocol) {
             continue; // Skip obsolete versions
@@ -386,7 +371,7 @@ int CPatriotnodeMan::CountEnabled(int protocolVersion) const
     int i = 0;
     protocolVersion = protocolVersion == -1 ? ActiveProtocol() : protocolVersion;
 
-    for (const auto& it : mapPatriotnodes) {
+    for (const auto& it : *GetSnapshot()) {
         const PatriotnodeRef& mn = it.second;
         if (mn->protocolVersion < protocolVersion || !mn->IsEnabled()) continue;
         i++;
@@ -397,8 +382,8 @@ int CPatriotnodeMan::CountEnabled(int protocolVersion) const
 
 int CPatriotnodeMan::CountNetworks(int& ipv4, int& ipv6, int& onion) const
 {
-    LOCK(cs);
-    for (const auto& it : mapPatriotnodes) {
+    const auto snapshot = GetSnapshot();
+    for (const auto& it : *snapshot) {
         const PatriotnodeRef& mn = it.second;
         std::string strHost;
         int port;
@@ -418,7 +403,7 @@ int CPatriotnodeMan::CountNetworks(int& ipv4, int& ipv6, int& onion) const
                 break;
         }
     }
-    return mapPatriotnodes.size();
+    return snapshot->size();
 }
 
 bool CPatriotnodeMan::RequestMnList(CNode* pnode)
@@ -447,28 +432,19 @@ bool CPatriotnodeMan::RequestMnList(CNode* pnode)
     return true;
 }
 
-CPatriotnode* CPatriotnodeMan::Find(const COutPoint& collateralOut)
+PatriotnodeRef CPatriotnodeMan::Find(const COutPoint& collateralOut) const
 {
     LOCK(cs);
     auto it = mapPatriotnodes.find(collateralOut);
-    return it != mapPatriotnodes.end() ? it->second.get() : nullptr;
+    return it != mapPatriotnodes.end() ? it->second : nullptr;
 }
 
-const CPatriotnode* CPatriotnodeMan::Find(const COutPoint& collateralOut) const
+PatriotnodeRef CPatriotnodeMan::Find(const CPubKey& pubKeyPatriotnode) const
 {
-    LOCK(cs);
-    auto const& it = mapPatriotnodes.find(collateralOut);
-    return it != mapPatriotnodes.end() ? it->second.get() : nullptr;
-}
-
-CPatriotnode* CPatriotnodeMan::Find(const CPubKey& pubKeyPatriotnode)
-{
-    LOCK(cs);
-
-    for (auto& it : mapPatriotnodes) {
-        PatriotnodeRef& mn = it.second;
+    for (const auto& it : *GetSnapshot()) {
+        const PatriotnodeRef& mn = it.second;
         if (mn->pubKeyPatriotnode == pubKeyPatriotnode)
-            return mn.get();
+            return mn;
     }
     return nullptr;
 }
@@ -537,14 +513,11 @@ PatriotnodeRef CPatriotnodeMan::GetNextPatriotnodeInQueueForPayment(int nBlockHe
     */
     int minProtocol = ActiveProtocol();
     int nMnCount = mnList.GetValidPNsCount();
-    {
-        LOCK(cs);
-        nMnCount += CountEnabled();
-        for (const auto& it : mapPatriotnodes) {
-            if (!it.second->IsEnabled()) continue;
-            if (canSchedulePN(fFilterSigTime, it.second, minProtocol, nMnCount, nBlockHeight)) {
-                vecPatriotnodeLastPaid.emplace_back(SecondsSincePayment(it.second, BlockReading), it.second);
-            }
+    nMnCount += CountEnabled();
+    for (const auto& it : *GetSnapshot()) {
+        if (!it.second->IsEnabled()) continue;
+        if (canSchedulePN(fFilterSigTime, it.second, minProtocol, nMnCount, nBlockHeight)) {
+            vecPatriotnodeLastPaid.emplace_back(SecondsSincePayment(it.second, BlockReading), it.second);
         }
     }
     // Add deterministic patriotnodes to the vector
@@ -568,58 +541,52 @@ PatriotnodeRef CPatriotnodeMan::GetNextPatriotnodeInQueueForPayment(int nBlockHe
     //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
     //  -- (chance per block * chances before IsScheduled will fire)
     int nTenthNetwork = nMnCount / 10;
-    int nCountTenth = 0;
-    arith_uint256 nHigh = ARITH_UINT256_ZERO;
-    const uint256& hash = GetHashAtHeight(nBlockHeight - 101);
+    std::vector<PatriotnodeRef> vTenth;
     for (const auto& s: vecPatriotnodeLastPaid) {
-        const PatriotnodeRef pmn = s.second;
-        if (!pmn) break;
-
-        const arith_uint256& n = pmn->CalculateScore(hash);
-        if (n > nHigh) {
-            nHigh = n;
-            pBestPatriotnode = pmn;
+        if (!s.second) break;
+        vTenth.emplace_back(s.second);
+        if ((int)vTenth.size() >= nTenthNetwork) break;
+    }
+    arith_uint256 nHigh = ARITH_UINT256_ZERO;
+    const std::vector<arith_uint256>& vScores = GetScores(GetHashAtHeight(nBlockHeight - 101), nBlockHeight - 101, vTenth);
+    for (size_t i = 0; i < vTenth.size(); i++) {
+        if (vScores[i] > nHigh) {
+            nHigh = vScores[i];
+            pBestPatriotnode = vTenth[i];
         }
-        nCountTenth++;
-        if (nCountTenth >= nTenthNetwork) break;
     }
     return pBestPatriotnode;
 }
 
-PatriotnodeRef CPatriotnodeMan::GetCurrentPatriotNode(const uint256& hash) const
+PatriotnodeRef CPatriotnodeMan::GetCurrentPatriotNode(const uint256& hash, int nHashHeight) const
 {
     int minProtocol = ActiveProtocol();
-    int64_t score = 0;
-    PatriotnodeRef winner = nullptr;
-
-    // scan for winner
-    for (const auto& it : mapPatriotnodes) {
+    std::vector<PatriotnodeRef> vPns;
+    for (const auto& it : *GetSnapshot()) {
         const PatriotnodeRef& mn = it.second;
         if (mn->protocolVersion < minProtocol || !mn->IsEnabled()) continue;
-        // calculate the score of the patriotnode
-        const int64_t n = mn->CalculateScore(hash).GetCompact(false);
-        // determine the winner
-        if (n > score) {
-            score = n;
-            winner = mn;
-        }
+        vPns.emplace_back(mn);
     }
 
     // scan also dmns
     if (deterministicPNManager->IsDIP3Enforced()) {
         auto mnList = deterministicPNManager->GetListAtChainTip();
         mnList.ForEachPN(true, [&](const CDeterministicPNCPtr& dmn) {
-            const PatriotnodeRef mn = MakePatriotnodeRefForDPN(dmn);
-            // calculate the score of the patriotnode
-            const int64_t n = mn->CalculateScore(hash).GetCompact(false);
-            // determine the winner
-            if (n > score) {
-                score = n;
-                winner = mn;
-            }
+            vPns.emplace_back(MakePatriotnodeRefForDPN(dmn));
         });
     }
 
+    // scan for winner
+    int64_t score = 0;
+    PatriotnodeRef winner = nullptr;
+    const std::vector<arith_uint256>& vScores = GetScores(hash, nHashHeight, vPns);
+    for (size_t i = 0; i < vPns.size(); i++) {
+        const int64_t n = vScores[i].GetCompact(false);
+        if (n > score) {
+            score = n;
+            winner = vPns[i];
+        }
+    }
     return winner;
 }
 
@@ -631,7 +598,7 @@ std::vector<std::pair<PatriotnodeRef, int>> CPatriotnodeMan::GetMnScores(int nLa
 
     for (int nHeight = nChainHeight - nLast; nHeight < nChainHeight + 20; nHeight++) {
         const uint256& hash = GetHashAtHeight(nHeight - 101);
-        PatriotnodeRef winner = GetCurrentPatriotNode(hash);
+        PatriotnodeRef winner = GetCurrentPatriotNode(hash, nHeight - 101);
         if (winner) {
             ret.emplace_back(winner, nHeight);
         }
@@ -647,35 +614,37 @@ int CPatriotnodeMan::GetPatriotnodeRank(const CTxIn& vin, int64_t nBlockHeight)
 
     // scan for winner
     int minProtocol = ActiveProtocol();
-    std::vector<std::pair<int64_t, CTxIn> > vecPatriotnodeScores;
-    {
-        LOCK(cs);
-        for (const auto& it : mapPatriotnodes) {
-            const PatriotnodeRef& mn = it.second;
-            if (!mn->IsEnabled()) {
-                continue; // Skip not enabled
-            }
-            if (mn->protocolVersion < minProtocol) {
-                LogPrint(BCLog::PATRIOTNODE,"Skipping Patriotnode with obsolete version %d\n", mn->protocolVersion);
-                continue; // Skip obsolete versions
-            }
-            if (sporkManager.IsSporkActive(SPORK_8_PATRIOTNODE_PAYMENT_ENFORCEMENT) &&
-                    GetAdjustedTime() - mn->sigTime < PN_WINNER_MINIMUM_AGE) {
-                continue; // Skip patriotnodes younger than (default) 1 hour
-            }
-            vecPatriotnodeScores.emplace_back(mn->CalculateScore(hash).GetCompact(false), mn->vin);
+    std::vector<PatriotnodeRef> vPns;
+    for (const auto& it : *GetSnapshot()) {
+        const PatriotnodeRef& mn = it.second;
+        if (!mn->IsEnabled()) {
+            continue; // Skip not enabled
+        }
+        if (mn->protocolVersion < minProtocol) {
+            LogPrint(BCLog::PATRIOTNODE,"Skipping Patriotnode with obsolete version %d\n", mn->protocolVersion);
+            continue; // Skip obsolete versions
         }
+        if (sporkManager.IsSporkActive(SPORK_8_PATRIOTNODE_PAYMENT_ENFORCEMENT) &&
+                GetAdjustedTime() - mn->sigTime < PN_WINNER_MINIMUM_AGE) {
+            continue; // Skip patriotnodes younger than (default) 1 hour
+        }
+        vPns.emplace_back(mn);
     }
 
     // scan also dmns
     if (deterministicPNManager->IsDIP3Enforced()) {
         auto mnList = deterministicPNManager->GetListAtChainTip();
         mnList.ForEachPN(true, [&](const CDeterministicPNCPtr& dmn) {
-            const PatriotnodeRef mn = MakePatriotnodeRefForDPN(dmn);
-            vecPatriotnodeScores.emplace_back(mn->CalculateScore(hash).GetCompact(false), mn->vin);
+            vPns.emplace_back(MakePatriotnodeRefForDPN(dmn));
         });
     }
 
+    const std::vector<arith_uint256>& vScores = GetScores(hash, nBlockHeight - 1, vPns);
+    std::vector<std::pair<int64_t, CTxIn> > vecPatriotnodeScores;
+    vecPatriotnodeScores.reserve(vPns.size());
+    for (size_t i = 0; i < vPns.size(); i++) {
+        vecPatriotnodeScores.emplace_back(vScores[i].GetCompact(false), vPns[i]->vin);
+    }
     sort(vecPatriotnodeScores.rbegin(), vecPatriotnodeScores.rend(), CompareScorePN());
 
     int rank = 0;
@@ -695,30 +664,116 @@ std::vector<std::pair<int64_t, PatriotnodeRef>> CPatriotnodeMan::GetPatriotnodeR
     const uint256& hash = GetHashAtHeight(nBlockHeight - 1);
     // height outside range
     if (hash == UINT256_ZERO) return vecPatriotnodeScores;
-    {
-        LOCK(cs);
-        // scan for winner
-        for (const auto& it : mapPatriotnodes) {
-            const PatriotnodeRef mn = it.second;
-            const uint32_t score = mn->IsEnabled() ? mn->CalculateScore(hash).GetCompact(false) : 9999;
-
-            vecPatriotnodeScores.emplace_back(score, mn);
-        }
+    // only enabled/valid patriotnodes get a score, the others are ranked at 9999
+    std::vector<PatriotnodeRef> vPns;
+    std::vector<PatriotnodeRef> vUnscored;
+    for (const auto& it : *GetSnapshot()) {
+        const PatriotnodeRef& mn = it.second;
+        (mn->IsEnabled() ? vPns : vUnscored).emplace_back(mn);
     }
     // scan also dmns
     if (deterministicPNManager->IsDIP3Enforced()) {
         auto mnList = deterministicPNManager->GetListAtChainTip();
         mnList.ForEachPN(false, [&](const CDeterministicPNCPtr& dmn) {
-            const PatriotnodeRef mn = MakePatriotnodeRefForDPN(dmn);
-            const uint32_t score = mnList.IsPNValid(dmn) ? mn->CalculateScore(hash).GetCompact(false) : 9999;
-
-            vecPatriotnodeScores.emplace_back(score, mn);
+            (mnList.IsPNValid(dmn) ? vPns : vUnscored).emplace_back(MakePatriotnodeRefForDPN(dmn));
         });
     }
+    const std::vector<arith_uint256>& vScores = GetScores(hash, nBlockHeight - 1, vPns);
+    vecPatriotnodeScores.reserve(vPns.size() + vUnscored.size());
+    for (size_t i = 0; i < vPns.size(); i++) {
+        vecPatriotnodeScores.emplace_back((uint32_t)vScores[i].GetCompact(false), vPns[i]);
+    }
+    for (const PatriotnodeRef& mn : vUnscored) {
+        vecPatriotnodeScores.emplace_back(9999, mn);
+    }
     sort(vecPatriotnodeScores.rbegin(), vecPatriotnodeScores.rend(), CompareScorePN());
     return vecPatriotnodeScores;
 }
 
+std::vector<arith_uint256> CPatriotnodeMan::GetScores(const uint256& hash, int nHashHeight, const std::vector<PatriotnodeRef>& vPns) const
+{
+    std::vector<arith_uint256> vScores(vPns.size());
+    std::vector<size_t> vMissing;
+    {
+        LOCK(cs_scores);
+        for (size_t i = 0; i < vPns.size(); i++) {
+            auto it = mapScores.find(std::make_pair(hash, vPns[i]->vin.prevout));
+            if (it != mapScores.end()) {
+                vScores[i] = it->second;
+            } else {
+                vMissing.emplace_back(i);
+            }
+        }
+    }
+    nScoresReused += vPns.size() - vMissing.size();
+    if (vMissing.empty()) {
+        return vScores;
+    }
+
+    // Two double-SHA256 per patriotnode: spread the full lists over the script check threads
+    auto calculate = [&](size_t k) {
+        vScores[vMissing[k]] = vPns[vMissing[k]]->CalculateScore(hash);
+    };
+    if (vMissing.size() >= 1000) {
+        ParallelForEach(vMissing.size(), calculate);
+    } else {
+        for (size_t k = 0; k < vMissing.size(); k++) calculate(k);
+    }
+    nScoresComputed += vMissing.size();
+
+    // Not worth keeping the scores of a block that is evicted at the next tip
+    if (nHashHeight < GetBestHeight() - SCORE_CACHE_DEPTH) {
+        return vScores;
+    }
+    LOCK(cs_scores);
+    mapScoreHashHeights.emplace(hash, nHashHeight);
+    for (size_t i : vMissing) {
+        mapScores.emplace(std::make_pair(hash, vPns[i]->vin.prevout), vScores[i]);
+    }
+    return vScores;
+}
+
+void CPatriotnodeMan::EvictScores(int nMinHeight)
+{
+    LOCK(cs_scores);
+    for (auto it = mapScoreHashHeights.begin(); it != mapScoreHashHeights.end(); ) {
+        if (it->second < nMinHeight) {
+            // all the scores of the hash are contiguous in mapScores
+            auto itFirst = mapScores.lower_bound(std::make_pair(it->first, COutPoint(UINT256_ZERO, 0)));
+            auto itLast = itFirst;
+            while (itLast != mapScores.end() && itLast->first.first == it->first) ++itLast;
+            mapScores.erase(itFirst, itLast);
+            it = mapScoreHashHeights.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CPatriotnodeMan::PublishSnapshot() const
+{
+    AssertLockHeld(cs);
+    fSnapshotStale = false;
+    auto snapshot = std::make_shared<PNSnapshot>(mapPatriotnodes.begin(), mapPatriotnodes.end());
+    std::atomic_store(&pSnapshot, std::shared_ptr<const PNSnapshot>(std::move(snapshot)));
+}
+
+std::shared_ptr<const CPatriotnodeMan::PNSnapshot> CPatriotnodeMan::GetSnapshot() const
+{
+    if (fSnapshotStale) {
+        LOCK(cs);
+        if (fSnapshotStale) PublishSnapshot();
+    }
+    return std::atomic_load(&pSnapshot);
+}
+
+void CPatriotnodeMan::GetScoreCacheStats(size_t& nHashes, uint64_t& nComputed, uint64_t& nReused) const
+{
+    nHashes = WITH_LOCK(cs_scores, return mapScoreHashHeights.size(););
+    nComputed = nScoresComputed;
+    nReused = nScoresReused;
+}
+
 int CPatriotnodeMan::ProcessPNBroadcast(CNode* pfrom, CPatriotnodeBroadcast& mnb)
 {
     const uint256& mnbHash = mnb.GetHash();
@@ -778,7 +833,7 @@ int CPatriotnodeMan::ProcessPNPing(CNode* pfrom, CPatriotnodePing& mnp)
         return nDoS;
     } else {
         // if nothing significant failed, search existing Patriotnode list
-        CPatriotnode* pmn = Find(mnp.vin.prevout);
+        PatriotnodeRef pmn = Find(mnp.vin.prevout);
         // if it's known, don't ask for the mnb, just return
         if (pmn != NULL) return 0;
     }
@@ -807,11 +862,11 @@ int CPatriotnodeMan::ProcessGetPNList(CNode* pfrom, CTxIn& vin)
 {
     // Single PN request
     if (!vin.IsNull()) {
-        CPatriotnode* mn = Find(vin.prevout);
+        PatriotnodeRef mn = Find(vin.prevout);
         if (!mn || !mn->IsEnabled()) return 0; // Nothing to return.
 
         // Relay the PN.
-        BroadcastInvPN(mn, pfrom);
+        BroadcastInvPN(mn.get(), pfrom);
         LogPrint(BCLog::PATRIOTNODE, "dseg - Sent 1 Patriotnode entry to peer %i\n", pfrom->GetId());
         return 0;
     }
@@ -832,16 +887,13 @@ int CPatriotnodeMan::ProcessGetPNList(CNode* pfrom, CTxIn& vin)
     }
 
     int nInvCount = 0;
-    {
-        LOCK(cs);
-        for (auto& it : mapPatriotnodes) {
-            PatriotnodeRef& mn = it.second;
-            if (mn->addr.IsRFC1918()) continue; //local network
-            if (mn->IsEnabled()) {
-                LogPrint(BCLog::PATRIOTNODE, "dseg - Sending Patriotnode entry - %s \n", mn->vin.prevout.hash.ToString());
-                BroadcastInvPN(mn.get(), pfrom);
-                nInvCount++;
-            }
+    for (const auto& it : *GetSnapshot()) {
+        const PatriotnodeRef& mn = it.second;
+        if (mn->addr.IsRFC1918()) continue; //local network
+        if (mn->IsEnabled()) {
+            LogPrint(BCLog::PATRIOTNODE, "dseg - Sending Patriotnode entry - %s \n", mn->vin.prevout.hash.ToString());
+            BroadcastInvPN(mn.get(), pfrom);
+            nInvCount++;
         }
     }
 
@@ -934,6 +986,7 @@ void CPatriotnodeMan::Remove(const COutPoint& collateralOut)
     const auto it = mapPatriotnodes.find(collateralOut);
     if (it != mapPatriotnodes.end()) {
         mapPatriotnodes.erase(it);
+        fSnapshotStale = true;
     }
 }
 
@@ -951,7 +1004,7 @@ void CPatriotnodeMan::UpdatePatriotnodeList(CPatriotnodeBroadcast& mnb)
 
     LogPrint(BCLog::PATRIOTNODE,"%s -- patriotnode=%s\n", __func__, mnb.vin.prevout.ToString());
 
-    CPatriotnode* pmn = Find(mnb.vin.prevout);
+    PatriotnodeRef pmn = Find(mnb.vin.prevout);
     if (pmn == NULL) {
         CPatriotnode mn(mnb);
         Add(mn);
@@ -1011,7 +1064,7 @@ int64_t CPatriotnodeMan::GetLastPaid(const PatriotnodeRef& mn, const CBlockIndex
 std::string CPatriotnodeMan::ToString() const
 {
     std::ostringstream info;
-    info << "Patriotnodes: " << (int)mapPatriotnodes.size()
+    info << "Patriotnodes: " << (int)GetSnapshot()->size()
          << ", peers who asked us for Patriotnode list: " << (int)mAskedUsForPatriotnodeList.size()
          << ", peers we asked for Patriotnode list: " << (int)mWeAskedForPatriotnodeList.size()
          << ", entries in Patriotnode list we asked for: " << (int)mWeAskedForPatriotnodeListEntry.size();
@@ -1021,6 +1074,7 @@ std::string CPatriotnodeMan::ToString() const
 void CPatriotnodeMan::CacheBlockHash(const CBlockIndex* pindex)
 {
     cvLastBlockHashes.Set(pindex->nHeight, pindex->GetBlockHash());
+    EvictScores(pindex->nHeight - SCORE_CACHE_DEPTH);
 }
 
 void CPatriotnodeMan::UncacheBlockHash(const CBlockIndex* pindex)
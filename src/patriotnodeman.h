@@ -12,13 +12,19 @@
 #include "key_io.h"
 #include "patriotnode.h"
 #include "net.h"
+#include "saltedhasher.h"
 #include "sync.h"
 #include "util/system.h"
 
+#include <unordered_map>
+
 #define PATRIOTNODES_REQUEST_SECONDS (60 * 60) // One hour.
 
 /** Maximum number of block hashes to cache */
 static const unsigned int CACHED_BLOCK_HASHES = 200;
+/** Patriotnode scores are kept for the block hashes up to this many blocks below the tip
+ *  (payments look up scores 101 blocks back) */
+static const int SCORE_CACHE_DEPTH = 128;
 
 class CPatriotnodeMan;
 class CActivePatriotnode;
@@ -53,6 +59,115 @@ public:
 };
 
 
+inline int64_t GetSeenTime(const CPatriotnodePing& mnp) { return mnp.sigTime; }
+inline int64_t GetSeenTime(const CPatriotnodeBroadcast& mnb) { return mnb.lastPing.sigTime; }
+
+/**
+ * Patriotnode messages (pings or broadcasts) seen on the network, by hash.
+ * The hashes are also kept in time buckets (by GetSeenTime), so that expiring
+ * the old messages only visits the buckets before the cutoff.
+ * Entries erased or updated in place are skipped or moved when their bucket expires.
+ * Serialized as a std::map.
+ */
+template <typename T>
+class CSeenPNMessages
+{
+public:
+    typedef std::unordered_map<uint256, T, StaticSaltedHasher> Map;
+    typedef typename Map::iterator iterator;
+    typedef typename Map::const_iterator const_iterator;
+
+private:
+    static const int64_t BUCKET_SECONDS = 10 * 60;
+
+    Map mapMessages;
+    std::map<int64_t, std::vector<uint256>> mapBuckets;
+
+    void AddToBucket(const uint256& hash, const T& msg)
+    {
+        mapBuckets[GetSeenTime(msg) / BUCKET_SECONDS].emplace_back(hash);
+    }
+
+public:
+    size_t size() const { return mapMessages.size(); }
+    size_t count(const uint256& hash) const { return mapMessages.count(hash); }
+    iterator begin() { return mapMessages.begin(); }
+    iterator end() { return mapMessages.end(); }
+    const_iterator begin() const { return mapMessages.begin(); }
+    const_iterator end() const { return mapMessages.end(); }
+    iterator find(const uint256& hash) { return mapMessages.find(hash); }
+    const_iterator find(const uint256& hash) const { return mapMessages.find(hash); }
+
+    bool emplace(const uint256& hash, const T& msg)
+    {
+        if (!mapMessages.emplace(hash, msg).second) return false;
+        AddToBucket(hash, msg);
+        return true;
+    }
+
+    T& operator[](const uint256& hash)
+    {
+        auto it = mapMessages.find(hash);
+        if (it == mapMessages.end()) {
+            it = mapMessages.emplace(hash, T()).first;
+            AddToBucket(hash, it->second);
+        }
+        return it->second;
+    }
+
+    iterator erase(iterator it) { return mapMessages.erase(it); }
+    size_t erase(const uint256& hash) { return mapMessages.erase(hash); }
+
+    void clear()
+    {
+        mapMessages.clear();
+        mapBuckets.clear();
+    }
+
+    // Erase the messages older than nCutoff, in the buckets entirely before it. Return their hashes.
+    std::vector<uint256> EraseOlderThan(int64_t nCutoff)
+    {
+        std::vector<uint256> vErased;
+        auto itBucket = mapBuckets.begin();
+        while (itBucket != mapBuckets.end() && (itBucket->first + 1) * BUCKET_SECONDS <= nCutoff) {
+            for (const uint256& hash : itBucket->second) {
+                auto it = mapMessages.find(hash);
+                if (it == mapMessages.end()) continue;
+                if (GetSeenTime(it->second) < nCutoff) {
+                    vErased.emplace_back(hash);
+                    mapMessages.erase(it);
+                } else {
+                    AddToBucket(hash, it->second);
+                }
+            }
+            itBucket = mapBuckets.erase(itBucket);
+        }
+        return vErased;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, mapMessages.size());
+        for (const auto& p : mapMessages) {
+            s << p.first << p.second;
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        clear();
+        const uint64_t nSize = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nSize; i++) {
+            uint256 hash;
+            T msg;
+            s >> hash >> msg;
+            emplace(hash, msg);
+        }
+    }
+};
+
 class CPatriotnodeMan
 {
 private:
@@ -64,6 +179,13 @@ private:
 
     // map to hold all PNs (indexed by collateral outpoint)
     std::map<COutPoint, PatriotnodeRef> mapPatriotnodes;
+    // Read-only copy of mapPatriotnodes (same order), for the readers that iterate the whole
+    // set. Changes only mark it stale: it is copied again on the next read, once for all the
+    // changes made since (eg. a whole dseg reply). The patriotnodes themselves are shared,
+    // their state is still guarded by their own lock.
+    typedef std::vector<std::pair<COutPoint, PatriotnodeRef>> PNSnapshot;
+    mutable std::shared_ptr<const PNSnapshot> pSnapshot{std::make_shared<const PNSnapshot>()};
+    mutable std::atomic<bool> fSnapshotStale{false};
     // who's asked for the Patriotnode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForPatriotnodeList;
     // who we asked for the Patriotnode list and the last time
@@ -77,6 +199,26 @@ private:
     // Memory Only. Cache last block hashes. Used to verify mn pings and winners.
     CyclingVector<uint256> cvLastBlockHashes;
 
+    // Memory Only. Patriotnode scores by (block hash, collateral outpoint), filled on demand.
+    // A score only depends on these two, so changes of the list leave the entries valid;
+    // they are evicted once their block is more than SCORE_CACHE_DEPTH below the tip.
+    mutable RecursiveMutex cs_scores;
+    mutable std::map<std::pair<uint256, COutPoint>, arith_uint256> mapScores;
+    // Height of the block of each hash in mapScores
+    mutable std::map<uint256, int> mapScoreHashHeights;
+    mutable std::atomic<uint64_t> nScoresComputed{0};
+    mutable std::atomic<uint64_t> nScoresReused{0};
+
+    // Return the scores of vPns for the given block hash (at nHashHeight), computing the missing ones
+    std::vector<arith_uint256> GetScores(const uint256& hash, int nHashHeight, const std::vector<PatriotnodeRef>& vPns) const;
+    // Drop the scores for the blocks below nMinHeight
+    void EvictScores(int nMinHeight);
+
+    // Publish mapPatriotnodes to the readers (cs must be held)
+    void PublishSnapshot() const;
+    // Return the current snapshot, publishing it first if stale
+    std::shared_ptr<const PNSnapshot> GetSnapshot() const;
+
     // Return the banning score (0 if no ban score increase is needed).
     int ProcessPNBroadcast(CNode* pfrom, CPatriotnodeBroadcast& mnb);
     int ProcessPNPing(CNode* pfrom, CPatriotnodePing& mnp);
@@ -87,9 +229,9 @@ private:
 
 public:
     // Keep track of all broadcasts I've seen
-    std::map<uint256, CPatriotnodeBroadcast> mapSeenPatriotnodeBroadcast;
+    CSeenPNMessages<CPatriotnodeBroadcast> mapSeenPatriotnodeBroadcast;
     // Keep track of all pings I've seen
-    std::map<uint256, CPatriotnodePing> mapSeenPatriotnodePing;
+    CSeenPNMessages<CPatriotnodePing> mapSeenPatriotnodePing;
 
     // keep track of dsq count to prevent patriotnodes from gaming obfuscation queue
     // TODO: Remove this from serialization
@@ -99,6 +241,7 @@ public:
     {
         LOCK(obj.cs);
         READWRITE(obj.mapPatriotnodes);
+        SER_READ(obj, obj.fSnapshotStale = true);
         READWRITE(obj.mAskedUsForPatriotnodeList);
         READWRITE(obj.mWeAskedForPatriotnodeList);
         READWRITE(obj.mWeAskedForPatriotnodeListEntry);
@@ -133,9 +276,8 @@ public:
     bool RequestMnList(CNode* pnode);
 
     /// Find an entry
-    CPatriotnode* Find(const COutPoint& collateralOut);
-    const CPatriotnode* Find(const COutPoint& collateralOut) const;
-    CPatriotnode* Find(const CPubKey& pubKeyPatriotnode);
+    PatriotnodeRef Find(const COutPoint& collateralOut) const;
+    PatriotnodeRef Find(const CPubKey& pubKeyPatriotnode) const;
 
     /// Check all transactions in a block, for spent patriotnode collateral outpoints (marking them as spent)
     void CheckSpentCollaterals(const std::vector<CTransactionRef>& vtx);
@@ -143,8 +285,8 @@ public:
     /// Find an entry in the patriotnode list that is next to be paid
     PatriotnodeRef GetNextPatriotnodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount, const CBlockIndex* pChainTip = nullptr) const;
 
-    /// Get the winner for this block hash
-    PatriotnodeRef GetCurrentPatriotNode(const uint256& hash) const;
+    /// Get the winner for this block hash (of the block at nHashHeight)
+    PatriotnodeRef GetCurrentPatriotNode(const uint256& hash, int nHashHeight) const;
 
     /// vector of pairs <patriotnode winner, height>
     std::vector<std::pair<PatriotnodeRef, int>> GetMnScores(int nLast) const;
@@ -153,6 +295,9 @@ public:
     std::vector<std::pair<int64_t, PatriotnodeRef>> GetPatriotnodeRanks(int nBlockHeight) const;
     int GetPatriotnodeRank(const CTxIn& vin, int64_t nBlockHeight) const;
 
+    /// Score cache statistics: number of block hashes, scores computed and reused since startup
+    void GetScoreCacheStats(size_t& nHashes, uint64_t& nComputed, uint64_t& nReused) const;
+
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
     // Process GETPNLIST message, returning the banning score (if 0, no ban score increase is needed)
@@ -39,4 +39,7 @@ public:
     SERIALIZE_METHODS(CFeeRate, obj) { READWRITE(obj.nSatoshisPerK); }
 };
 
+/** Default multiplier used in the computation for shielded txes min fee */
+static const unsigned int DEFAULT_SHIELDEDTXFEE_K = 100;
+
 #endif //  TrumpCoin_POLICY_FEERATE_H
@@ -11,41 +11,42 @@
 #include "txmempool.h"
 #include "util/system.h"
 
+#include <algorithm>
+
 void TxConfirmStats::Initialize(std::vector<double>& defaultBuckets,
-                                unsigned int maxConfirms, double _decay)
+                                unsigned int _maxConfirms, double _decay)
 {
     decay = _decay;
-    for (unsigned int i = 0; i < defaultBuckets.size(); i++) {
-        buckets.push_back(defaultBuckets[i]);
-        bucketMap[defaultBuckets[i]] = i;
-    }
-    confAvg.resize(maxConfirms);
-    curBlockConf.resize(maxConfirms);
-    unconfTxs.resize(maxConfirms);
-    for (unsigned int i = 0; i < maxConfirms; i++) {
-        confAvg[i].resize(buckets.size());
-        curBlockConf[i].resize(buckets.size());
-        unconfTxs[i].resize(buckets.size());
-    }
+    maxConfirms = _maxConfirms;
+    buckets = defaultBuckets;
+    confAvg.assign(maxConfirms * buckets.size(), 0);
+    curBlockConf.assign(maxConfirms * buckets.size(), 0);
+    unconfTxs.assign(maxConfirms * buckets.size(), 0);
+
+    oldUnconfTxs.assign(buckets.size(), 0);
+    curBlockTxCt.assign(buckets.size(), 0);
+    txCtAvg.assign(buckets.size(), 0);
+    curBlockVal.assign(buckets.size(), 0);
+    avg.assign(buckets.size(), 0);
+}
 
-    oldUnconfTxs.resize(buckets.size());
-    curBlockTxCt.resize(buckets.size());
-    txCtAvg.resize(buckets.size());
-    curBlockVal.resize(buckets.size());
-    avg.resize(buckets.size());
+unsigned int TxConfirmStats::BucketIndex(double val) const
+{
+    return std::lower_bound(buckets.begin(), buckets.end(), val) - buckets.begin();
 }
 
 // Zero out the data for the current block
 void TxConfirmStats::ClearCurrent(unsigned int nBlockHeight)
 {
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        oldUnconfTxs[j] += unconfTxs[nBlockHeight%unconfTxs.size()][j];
-        unconfTxs[nBlockHeight%unconfTxs.size()][j] = 0;
-        for (unsigned int i = 0; i < curBlockConf.size(); i++)
-            curBlockConf[i][j] = 0;
-        curBlockTxCt[j] = 0;
-        curBlockVal[j] = 0;
+    const size_t nBuckets = buckets.size();
+    int* unconfRow = &unconfTxs[(nBlockHeight % maxConfirms) * nBuckets];
+    for (size_t j = 0; j < nBuckets; j++) {
+        oldUnconfTxs[j] += unconfRow[j];
+        unconfRow[j] = 0;
     }
+    std::fill(curBlockConf.begin(), curBlockConf.end(), 0);
+    std::fill(curBlockTxCt.begin(), curBlockTxCt.end(), 0);
+    std::fill(curBlockVal.begin(), curBlockVal.end(), 0);
 }
 
 
@@ -54,9 +55,9 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
     // blocksToConfirm is 1-based
     if (blocksToConfirm < 1)
         return;
-    unsigned int bucketindex = bucketMap.lower_bound(val)->second;
-    for (size_t i = blocksToConfirm; i <= curBlockConf.size(); i++) {
-        curBlockConf[i - 1][bucketindex]++;
+    unsigned int bucketindex = BucketIndex(val);
+    if ((unsigned int)blocksToConfirm <= maxConfirms) {
+        curBlockConf[(blocksToConfirm - 1) * buckets.size() + bucketindex]++;
     }
     curBlockTxCt[bucketindex]++;
     curBlockVal[bucketindex] += val;
@@ -64,9 +65,13 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
 
 void TxConfirmStats::UpdateMovingAverages()
 {
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        for (unsigned int i = 0; i < confAvg.size(); i++)
-            confAvg[i][j] = confAvg[i][j] * decay + curBlockConf[i][j];
+    const size_t nBuckets = buckets.size();
+    // A tx confirmed in Y blocks was also confirmed within any Z >= Y blocks
+    for (size_t k = nBuckets; k < curBlockConf.size(); k++)
+        curBlockConf[k] += curBlockConf[k - nBuckets];
+    for (size_t k = 0; k < confAvg.size(); k++)
+        confAvg[k] = confAvg[k] * decay + curBlockConf[k];
+    for (size_t j = 0; j < nBuckets; j++) {
         avg[j] = avg[j] * decay + curBlockVal[j];
         txCtAvg[j] = txCtAvg[j] * decay + curBlockTxCt[j];
     }
@@ -82,7 +87,8 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     double totalNum = 0; // Total number of tx's that were ever confirmed
     int extraNum = 0;  // Number of tx's still in mempool for confTarget or longer
 
-    int maxbucketindex = buckets.size() - 1;
+    const size_t nBuckets = buckets.size();
+    int maxbucketindex = nBuckets - 1;
 
     // requireGreater means we are looking for the lowest feerate such that all higher
     // values pass, so we start at maxbucketindex (highest feerate) and look at succesively
@@ -102,15 +108,15 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     unsigned int bestFarBucket = startbucket;
 
     bool foundAnswer = false;
-    unsigned int bins = unconfTxs.size();
+    unsigned int bins = maxConfirms;
 
     // Start counting from highest(default) or lowest feerate transactions
     for (int bucket = startbucket; bucket >= 0 && bucket <= maxbucketindex; bucket += step) {
         curFarBucket = bucket;
-        nConf += confAvg[confTarget - 1][bucket];
+        nConf += confAvg[(confTarget - 1) * nBuckets + bucket];
         totalNum += txCtAvg[bucket];
         for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
-            extraNum += unconfTxs[(nBlockHeight - confct)%bins][bucket];
+            extraNum += unconfTxs[((nBlockHeight - confct)%bins) * nBuckets + bucket];
         extraNum += oldUnconfTxs[bucket];
         // If we have enough transaction data points in this range of buckets,
         // we can test for success
@@ -173,11 +179,16 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
 
 void TxConfirmStats::Write(CAutoFile& fileout)
 {
+    // The file keeps one vector per confirmation count
+    std::vector<std::vector<double> > fileConfAvg(maxConfirms);
+    for (unsigned int i = 0; i < maxConfirms; i++) {
+        fileConfAvg[i].assign(confAvg.begin() + i * buckets.size(), confAvg.begin() + (i + 1) * buckets.size());
+    }
     fileout << decay;
     fileout << buckets;
     fileout << avg;
     fileout << txCtAvg;
-    fileout << confAvg;
+    fileout << fileConfAvg;
 }
 
 void TxConfirmStats::Read(CAutoFile& filein)
@@ -188,7 +199,7 @@ void TxConfirmStats::Read(CAutoFile& filein)
     std::vector<std::vector<double> > fileConfAvg;
     std::vector<double> fileTxCtAvg;
     double fileDecay;
-    size_t maxConfirms;
+    size_t fileMaxConfirms;
     size_t numBuckets;
 
     filein >> fileDecay;
@@ -205,49 +216,48 @@ void TxConfirmStats::Read(CAutoFile& filein)
     if (fileTxCtAvg.size() != numBuckets)
         throw std::runtime_error("Corrupt estimates file. Mismatch in tx count bucket count");
     filein >> fileConfAvg;
-    maxConfirms = fileConfAvg.size();
-    if (maxConfirms <= 0 || maxConfirms > 6 * 24 * 7) // one week
+    fileMaxConfirms = fileConfAvg.size();
+    if (fileMaxConfirms <= 0 || fileMaxConfirms > 6 * 24 * 7) // one week
         throw std::runtime_error("Corrupt estimates file.  Must maintain estimates for between 1 and 1008 (one week) confirms");
-    for (unsigned int i = 0; i < maxConfirms; i++) {
+    for (unsigned int i = 0; i < fileMaxConfirms; i++) {
         if (fileConfAvg[i].size() != numBuckets)
             throw std::runtime_error("Corrupt estimates file. Mismatch in feerate conf average bucket count");
     }
+    for (unsigned int i = 1; i < numBuckets; i++) {
+        if (!(fileBuckets[i - 1] < fileBuckets[i]))
+            throw std::runtime_error("Corrupt estimates file. Feerate buckets must be sorted");
+    }
     // Now that we've processed the entire feerate estimate data file and not
     // thrown any errors, we can copy it to our data structures
     decay = fileDecay;
+    maxConfirms = fileMaxConfirms;
     buckets = fileBuckets;
     avg = fileAvg;
-    confAvg = fileConfAvg;
     txCtAvg = fileTxCtAvg;
-    bucketMap.clear();
+    confAvg.clear();
+    confAvg.reserve(maxConfirms * numBuckets);
+    for (const std::vector<double>& row : fileConfAvg) {
+        confAvg.insert(confAvg.end(), row.begin(), row.end());
+    }
 
     // Resize the current block variables which aren't stored in the data file
     // to match the number of confirms and buckets
-    curBlockConf.resize(maxConfirms);
-    for (unsigned int i = 0; i < maxConfirms; i++) {
-        curBlockConf[i].resize(buckets.size());
-    }
-    curBlockTxCt.resize(buckets.size());
-    curBlockVal.resize(buckets.size());
-
-    unconfTxs.resize(maxConfirms);
-    for (unsigned int i = 0; i < maxConfirms; i++) {
-        unconfTxs[i].resize(buckets.size());
-    }
-    oldUnconfTxs.resize(buckets.size());
+    curBlockConf.assign(maxConfirms * numBuckets, 0);
+    curBlockTxCt.assign(numBuckets, 0);
+    curBlockVal.assign(numBuckets, 0);
 
-    for (unsigned int i = 0; i < buckets.size(); i++)
-        bucketMap[buckets[i]] = i;
+    unconfTxs.assign(maxConfirms * numBuckets, 0);
+    oldUnconfTxs.assign(numBuckets, 0);
 
     LogPrint(BCLog::ESTIMATEFEE, "Reading estimates: %u buckets counting confirms up to %u blocks\n",
-            numBuckets, maxConfirms);
+            numBuckets, fileMaxConfirms);
 }
 
 unsigned int TxConfirmStats::NewTx(unsigned int nBlockHeight, double val)
 {
-    unsigned int bucketindex = bucketMap.lower_bound(val)->second;
-    unsigned int blockIndex = nBlockHeight % unconfTxs.size();
-    unconfTxs[blockIndex][bucketindex]++;
+    unsigned int bucketindex = BucketIndex(val);
+    unsigned int blockIndex = nBlockHeight % maxConfirms;
+    unconfTxs[blockIndex * buckets.size() + bucketindex]++;
     return bucketindex;
 }
 
@@ -262,7 +272,7 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         return;  //This can't happen because we call this with our best seen height, no entries can have higher
     }
 
-    if (blocksAgo >= (int)unconfTxs.size()) {
+    if (blocksAgo >= (int)maxConfirms) {
         if (oldUnconfTxs[bucketindex] > 0)
             oldUnconfTxs[bucketindex]--;
         else
@@ -270,9 +280,10 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
                      bucketindex);
     }
     else {
-        unsigned int blockIndex = entryHeight % unconfTxs.size();
-        if (unconfTxs[blockIndex][bucketindex] > 0)
-            unconfTxs[blockIndex][bucketindex]--;
+        unsigned int blockIndex = entryHeight % maxConfirms;
+        int& unconf = unconfTxs[blockIndex * buckets.size() + bucketindex];
+        if (unconf > 0)
+            unconf--;
         else
             LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy error, mempool tx removed from blockIndex=%u,bucketIndex=%u already\n",
                      blockIndex, bucketindex);
@@ -288,7 +299,7 @@ bool CBlockPolicyEstimator::removeTx(const uint256& hash)
 {
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
-        feeStats.removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex);
+        GetStats(pos->second.fShielded).removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex);
         mapMemPoolTxs.erase(hash);
         return true;
     }
@@ -306,11 +317,20 @@ CBlockPolicyEstimator::CBlockPolicyEstimator(const CFeeRate& _minRelayFee)
     }
     vfeelist.push_back(INF_FEERATE);
     feeStats.Initialize(vfeelist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY);
+
+    std::vector<double> vshieldedfeelist;
+    // Shielded transactions pay DEFAULT_SHIELDEDTXFEE_K times the transparent feerate
+    // (see GetShieldedTxMinFee), so they are tracked on buckets scaled by that factor
+    for (double bucketBoundary = minTrackedFee.GetFeePerK() * DEFAULT_SHIELDEDTXFEE_K; bucketBoundary <= MAX_FEERATE * DEFAULT_SHIELDEDTXFEE_K; bucketBoundary *= FEE_SPACING) {
+        vshieldedfeelist.push_back(bucketBoundary);
+    }
+    vshieldedfeelist.push_back(INF_FEERATE);
+    shieldedFeeStats.Initialize(vshieldedfeelist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY);
 }
 
 void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate)
 {
-    if(entry.HasZerocoins() || entry.IsShielded()) {
+    if(entry.HasZerocoins()) {
         // Zerocoin spends/mints had fixed feerate. Skip them for the estimates.
         return;
     }
@@ -342,13 +362,15 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     // Feerates are stored and reported as TRUMP-per-kb:
     CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
 
-    mapMemPoolTxs[hash].blockHeight = txHeight;
-    mapMemPoolTxs[hash].bucketIndex = feeStats.NewTx(txHeight, (double)feeRate.GetFeePerK());
+    TxStatsInfo& info = mapMemPoolTxs[hash];
+    info.blockHeight = txHeight;
+    info.fShielded = entry.IsShielded();
+    info.bucketIndex = GetStats(info.fShielded).NewTx(txHeight, (double)feeRate.GetFeePerK());
 }
 
 bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
 {
-    if(entry->HasZerocoins() || entry->IsShielded()) {
+    if(entry->HasZerocoins()) {
         // Zerocoin spends/mints had fixed feerate. Skip them for the estimates.
         return false;
     }
@@ -372,7 +394,7 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
     // Feerates are stored and reported as TRUMP-per-kb:
     CFeeRate feeRate(entry->GetFee(), entry->GetTxSize());
 
-    feeStats.Record(blocksToConfirm, (double)feeRate.GetFeePerK());
+    GetStats(entry->IsShielded()).Record(blocksToConfirm, (double)feeRate.GetFeePerK());
     return true;
 }
 
@@ -395,6 +417,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
     // Clear the current block state and update unconfirmed circular buffer
     feeStats.ClearCurrent(nBlockHeight);
+    shieldedFeeStats.ClearCurrent(nBlockHeight);
 
     unsigned int countedTxs = 0;
     // Repopulate the current block state
@@ -405,6 +428,8 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
     // Update all exponential averages with the current block state
     feeStats.UpdateMovingAverages();
+    shieldedFeeStats.UpdateMovingAverages();
+    mapMedianCache.clear();
 
     LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy after updating estimates for %u of %u txs in block, since last block %u of %u tracked, new mempool map size %u\n",
              countedTxs, entries.size(), trackedTxs, trackedTxs + untrackedTxs, mapMemPoolTxs.size());
@@ -413,13 +438,26 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     untrackedTxs = 0;
 }
 
-CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget)
+double CBlockPolicyEstimator::EstimateMedianVal(int confTarget, bool fShielded)
+{
+    // The estimates only move with the moving averages, which are updated once per block:
+    // requests in between are answered from the cache. Transactions entering the mempool
+    // after the first request are only accounted for from the next block.
+    auto it = mapMedianCache.find(std::make_pair(fShielded, confTarget));
+    if (it != mapMedianCache.end())
+        return it->second;
+    double median = GetStats(fShielded).EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+    mapMedianCache.emplace(std::make_pair(fShielded, confTarget), median);
+    return median;
+}
+
+CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget, bool fShielded)
 {
     // Return failure if trying to analyze a target we're not tracking
-    if (confTarget <= 0 || (unsigned int)confTarget > feeStats.GetMaxConfirms())
+    if (confTarget <= 0 || (unsigned int)confTarget > GetStats(fShielded).GetMaxConfirms())
         return CFeeRate(0);
 
-    double median = feeStats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+    double median = EstimateMedianVal(confTarget, fShielded);
 
     if (median < 0)
         return CFeeRate(0);
@@ -427,17 +465,18 @@ CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget)
     return CFeeRate(median);
 }
 
-CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, int *answerFoundAtTarget, const CTxMemPool& pool)
+CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, int *answerFoundAtTarget, const CTxMemPool& pool, bool fShielded)
 {
     if (answerFoundAtTarget)
         *answerFoundAtTarget = confTarget;
+    const unsigned int maxConfirms = GetStats(fShielded).GetMaxConfirms();
     // Return failure if trying to analyze a target we're not tracking
-    if (confTarget <= 0 || (unsigned int)confTarget > feeStats.GetMaxConfirms())
+    if (confTarget <= 0 || (unsigned int)confTarget > maxConfirms)
         return CFeeRate(0);
 
     double median = -1;
-    while (median < 0 && (unsigned int)confTarget <= feeStats.GetMaxConfirms()) {
-        median = feeStats.EstimateMedianVal(confTarget++, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+    while (median < 0 && (unsigned int)confTarget <= maxConfirms) {
+        median = EstimateMedianVal(confTarget++, fShielded);
     }
 
     if (answerFoundAtTarget)
@@ -458,6 +497,7 @@ void CBlockPolicyEstimator::Write(CAutoFile& fileout)
 {
     fileout << nBestSeenHeight;
     feeStats.Write(fileout);
+    shieldedFeeStats.Write(fileout);
 }
 
 void CBlockPolicyEstimator::Read(CAutoFile& filein, int nFileVersion)
@@ -466,8 +506,16 @@ void CBlockPolicyEstimator::Read(CAutoFile& filein, int nFileVersion)
     filein >> nFileBestSeenHeight;
     feeStats.Read(filein);
     nBestSeenHeight = nFileBestSeenHeight;
+    mapMedianCache.clear();
     if (nFileVersion < 4029900) {
         TxConfirmStats priStats;
         priStats.Read(filein);
+        return;
+    }
+    // Files written before shielded transactions were tracked end here
+    try {
+        shieldedFeeStats.Read(filein);
+    } catch (const std::ios_base::failure&) {
+        LogPrint(BCLog::ESTIMATEFEE, "No shielded fee estimates in file\n");
     }
 }
@@ -71,8 +71,12 @@ class TxConfirmStats
 {
 private:
     //Define the buckets we will group transactions into
-    std::vector<double> buckets;              // The upper-bound of the range for the bucket (inclusive)
-    std::map<double, unsigned int> bucketMap; // Map of bucket upper-bound to index into all vectors by bucket
+    std::vector<double> buckets;              // The upper-bound of the range for the bucket (inclusive), sorted
+
+    // The per (Y, X) statistics are stored in flat arrays, row Y of bucket X at index
+    // Y * buckets.size() + X, so that the per-block updates are straight loops over
+    // contiguous memory.
+    unsigned int maxConfirms{0};
 
     // feerate each bucket X:
     // Count the total # of txs in each bucket
@@ -83,9 +87,10 @@ private:
 
     // Count the total # of txs confirmed within Y blocks in each bucket
     // Track the historical moving average of theses totals over blocks
-    std::vector<std::vector<double> > confAvg; // confAvg[Y][X]
-    // and calcuate the totals for the current block to update the moving averages
-    std::vector<std::vector<int> > curBlockConf; // curBlockConf[Y][X]
+    std::vector<double> confAvg; // confAvg[Y][X]
+    // and count the txs confirmed in exactly Y blocks in the current block, which are
+    // accumulated over Y when the moving averages are updated
+    std::vector<int> curBlockConf; // curBlockConf[Y][X]
 
     // Sum the total feerate of all tx's in each bucket
     // Track the historical moving average of this total over blocks
@@ -101,10 +106,13 @@ private:
     // Mempool counts of outstanding transactions
     // For each bucket X, track the number of transactions in the mempool
     // that are unconfirmed for each possible confirmation value Y
-    std::vector<std::vector<int> > unconfTxs;  //unconfTxs[Y][X]
+    std::vector<int> unconfTxs;  //unconfTxs[Y][X]
     // transactions still unconfirmed after MAX_CONFIRMS for each bucket
     std::vector<int> oldUnconfTxs;
 
+    /** Index of the bucket holding feerate val */
+    unsigned int BucketIndex(double val) const;
+
 public:
     /**
      * Initialize the data structures.  This is called by BlockPolicyEstimator's
@@ -152,7 +160,7 @@ public:
                              double minSuccess, bool requireGreater, unsigned int nBlockHeight);
 
     /** Return the max number of confirms we're tracking */
-    unsigned int GetMaxConfirms() { return confAvg.size(); }
+    unsigned int GetMaxConfirms() const { return maxConfirms; }
 
     /** Write state of estimation data to a file*/
     void Write(CAutoFile& fileout);
@@ -215,14 +223,14 @@ public:
     /** Remove a transaction from the mempool tracking stats*/
     bool removeTx(const uint256& hash);
 
-    /** Return a feerate estimate */
-    CFeeRate estimateFee(int confTarget);
+    /** Return a feerate estimate, for shielded transactions if fShielded */
+    CFeeRate estimateFee(int confTarget, bool fShielded = false);
 
     /** Estimate feerate needed to get be included in a block within
      *  confTarget blocks. If no answer can be given at confTarget, return an
      *  estimate at the lowest target where one can be given.
      */
-    CFeeRate estimateSmartFee(int confTarget, int *answerFoundAtTarget, const CTxMemPool& pool);
+    CFeeRate estimateSmartFee(int confTarget, int *answerFoundAtTarget, const CTxMemPool& pool, bool fShielded = false);
 
     /** Write estimation data to a file */
     void Write(CAutoFile& fileout);
@@ -237,7 +245,8 @@ private:
     {
         unsigned int blockHeight;
         unsigned int bucketIndex;
-        TxStatsInfo() : blockHeight(0), bucketIndex(0) {}
+        bool fShielded;
+        TxStatsInfo() : blockHeight(0), bucketIndex(0), fShielded(false) {}
     };
 
     // map of txids to information about that transaction
@@ -245,6 +254,16 @@ private:
 
     /** Classes to track historical data on transaction confirmations */
     TxConfirmStats feeStats;
+    TxConfirmStats shieldedFeeStats;
+
+    /** Estimates answered since the last block, by (shielded, confirmation target).
+     *  Requests between two blocks are served from here. */
+    std::map<std::pair<bool, int>, double> mapMedianCache;
+
+    TxConfirmStats& GetStats(bool fShielded) { return fShielded ? shieldedFeeStats : feeStats; }
+
+    /** Median feerate for confTarget with the default success criteria, cached until the next block */
+    double EstimateMedianVal(int confTarget, bool fShielded);
 
     unsigned int trackedTxs;
     unsigned int untrackedTxs;
@@ -87,6 +87,9 @@ public:
 
     // memory only
     mutable bool fChecked{false};
+    // memory only: context-free checks already performed (e.g. by the reindex workers)
+    mutable bool fCheckedMerkleRoot{false};
+    mutable bool fCheckedBlockSig{false};
 
     CBlock()
     {
@@ -112,6 +115,8 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         fChecked = false;
+        fCheckedMerkleRoot = false;
+        fCheckedBlockSig = false;
         vchBlockSig.clear();
     }
 
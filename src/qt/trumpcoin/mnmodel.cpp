@@ -30,9 +30,9 @@ void PNModel::updatePNList()
             continue;
         const uint256& txHash = uint256S(mne.getTxHash());
         CTxIn txIn(txHash, uint32_t(nIndex));
-        CPatriotnode* pmn = mnodeman.Find(txIn.prevout);
+        PatriotnodeRef pmn = mnodeman.Find(txIn.prevout);
         if (!pmn) {
-            pmn = new CPatriotnode();
+            pmn = std::make_shared<CPatriotnode>();
             pmn->vin = txIn;
         }
         nodes.insert(QString::fromStdString(mne.getAlias()), std::make_pair(QString::fromStdString(mne.getIp()), pmn));
@@ -80,7 +80,7 @@ QVariant PNModel::data(const QModelIndex &index, int role) const
             case COLLATERAL_OUT_INDEX:
                 return (isAvailable) ? QString::number(rec->vin.prevout.n) : "Not available";
             case STATUS: {
-                std::pair<QString, CPatriotnode*> pair = nodes.values().value(row);
+                std::pair<QString, PatriotnodeRef> pair = nodes.values().value(row);
                 std::string status = "MISSING";
                 if (pair.second) {
                     status = pair.second->Status();
@@ -116,8 +116,8 @@ QVariant PNModel::data(const QModelIndex &index, int role) const
 QModelIndex PNModel::index(int row, int column, const QModelIndex& parent) const
 {
     Q_UNUSED(parent);
-    std::pair<QString, CPatriotnode*> pair = nodes.values().value(row);
-    CPatriotnode* data = pair.second;
+    std::pair<QString, PatriotnodeRef> pair = nodes.values().value(row);
+    CPatriotnode* data = pair.second.get();
     if (data) {
         return createIndex(row, column, data);
     } else if (!pair.first.isEmpty()) {
@@ -146,7 +146,7 @@ bool PNModel::addMn(CPatriotnodeConfig::CPatriotnodeEntry* mne)
     if (!mne->castOutputIndex(nIndex))
         return false;
 
-    CPatriotnode* pmn = mnodeman.Find(COutPoint(uint256S(mne->getTxHash()), uint32_t(nIndex)));
+    PatriotnodeRef pmn = mnodeman.Find(COutPoint(uint256S(mne->getTxHash()), uint32_t(nIndex)));
     nodes.insert(QString::fromStdString(mne->getAlias()), std::make_pair(QString::fromStdString(mne->getIp()), pmn));
     endInsertRows();
     return true;
@@ -154,7 +154,7 @@ bool PNModel::addMn(CPatriotnodeConfig::CPatriotnodeEntry* mne)
 
 int PNModel::getPNState(QString mnAlias)
 {
-    QMap<QString, std::pair<QString, CPatriotnode*>>::const_iterator it = nodes.find(mnAlias);
+    QMap<QString, std::pair<QString, PatriotnodeRef>>::const_iterator it = nodes.find(mnAlias);
     if (it != nodes.end()) return it.value().second->GetActiveState();
     throw std::runtime_error(std::string("Patriotnode alias not found"));
 }
@@ -173,7 +173,7 @@ bool PNModel::isPNActive(QString mnAlias)
 
 bool PNModel::isPNCollateralMature(QString mnAlias)
 {
-    QMap<QString, std::pair<QString, CPatriotnode*>>::const_iterator it = nodes.find(mnAlias);
+    QMap<QString, std::pair<QString, PatriotnodeRef>>::const_iterator it = nodes.find(mnAlias);
     if (it != nodes.end()) return collateralTxAccepted.value(it.value().second->vin.prevout.hash.GetHex());
     throw std::runtime_error(std::string("Patriotnode alias not found"));
 }
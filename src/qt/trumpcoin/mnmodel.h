@@ -59,7 +59,7 @@ public:
 private:
     WalletModel* walletModel;
     // alias mn node ---> pair <ip, patriot node>
-    QMap<QString, std::pair<QString, CPatriotnode*>> nodes;
+    QMap<QString, std::pair<QString, PatriotnodeRef>> nodes;
     QMap<std::string, bool> collateralTxAccepted;
 };
 
@@ -420,11 +420,13 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e)
     info.pushKV("descendantcount", e.GetCountWithDescendants());
     info.pushKV("descendantsize", e.GetSizeWithDescendants());
     info.pushKV("descendantfees", e.GetModFeesWithDescendants());
-    const CTransaction& tx = e.GetTx();
+    // The in-mempool parents are already linked to the entry, no need to look up every input
     std::set<std::string> setDepends;
-    for (const CTxIn& txin : tx.vin) {
-        if (mempool.exists(txin.prevout.hash))
-            setDepends.insert(txin.prevout.hash.ToString());
+    CTxMemPool::txiter it = mempool.mapTx.find(e.GetTx().GetHash());
+    if (it != mempool.mapTx.end()) {
+        for (CTxMemPool::txiter parent : mempool.GetMemPoolParents(it)) {
+            setDepends.insert(parent->GetTx().GetHash().ToString());
+        }
     }
 
     UniValue depends(UniValue::VARR);
@@ -995,6 +997,25 @@ void NetworkUpgradeDescPushBack(
     }
 }
 
+static UniValue VerifyDBStatusDesc(const VerifyDBStatus& status)
+{
+    std::string strStatus;
+    switch (status.state) {
+        case VerifyDBStatus::NOT_STARTED: strStatus = "not started"; break;
+        case VerifyDBStatus::RUNNING: strStatus = "running"; break;
+        case VerifyDBStatus::DONE: strStatus = "done"; break;
+        case VerifyDBStatus::FAILED: strStatus = "failed"; break;
+    }
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("status", strStatus);
+    obj.pushKV("background", status.fBackground);
+    obj.pushKV("checklevel", status.nCheckLevel);
+    obj.pushKV("checkblocks", status.nCheckDepth);
+    obj.pushKV("verified", status.nVerified);
+    obj.pushKV("progress", status.state == VerifyDBStatus::DONE ? 1.0 : status.nProgress / 100.0);
+    return obj;
+}
+
 UniValue getblockchaininfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -1016,6 +1037,14 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "    \"valueDelta\":        (numeric) Change in value held by the Sapling circuit over the chain tip block\n"
             "  },\n"
             "  \"initial_block_downloading\": true|false, (boolean) whether the node is in initial block downloading state or not\n"
+            "  \"verifydb\": {             (object) status of the block verification of -checkblocks\n"
+            "    \"status\": \"xxxx\",       (string) one of \"not started\", \"running\", \"done\", \"failed\"\n"
+            "    \"background\": true|false, (boolean) whether the verification runs in background (-backgroundverify)\n"
+            "    \"checklevel\": n,        (numeric) verification level\n"
+            "    \"checkblocks\": n,       (numeric) number of blocks to verify\n"
+            "    \"verified\": n,          (numeric) number of blocks verified so far\n"
+            "    \"progress\": x.xxx,      (numeric) estimate of the verification progress [0..1]\n"
+            "  },\n"
             "  \"softforks\": [            (array) status of softforks in progress\n"
             "     {\n"
             "        \"id\": \"xxxx\",        (string) name of softfork\n"
@@ -1054,6 +1083,7 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
     // Sapling shield pool value
     obj.pushKV("shield_pool_value", pChainTip ? ValuePoolDesc(pChainTip->nChainSaplingValue, pChainTip->nSaplingValue) : 0);
     obj.pushKV("initial_block_downloading", IsInitialBlockDownload());
+    obj.pushKV("verifydb", VerifyDBStatusDesc(GetVerifyDBStatus()));
     UniValue softforks(UniValue::VARR);
     softforks.push_back(SoftForkDesc("bip65", 5, pChainTip));
     obj.pushKV("softforks",             softforks);
@@ -319,7 +319,7 @@ static mnKeyList getPNKeys(const Optional<std::string>& mnAliasFilter,
             failed++;
             continue;
         }
-        CPatriotnode* pmn = mnodeman.Find(mnPubKey);
+        PatriotnodeRef pmn = mnodeman.Find(mnPubKey);
         if (!pmn) {
             resultsObj.push_back(packErrorRetStatus(mnAlias, "Can't find patriotnode by pubkey"));
             failed++;
@@ -341,7 +341,7 @@ static mnKeyList getPNKeysForActivePatriotnode(UniValue& resultsObj)
 
     CKey mnKey; CPubKey mnPubKey;
     activePatriotnode.GetKeys(mnKey, mnPubKey);
-    CPatriotnode* pmn = mnodeman.Find(mnPubKey);
+    PatriotnodeRef pmn = mnodeman.Find(mnPubKey);
     if (!pmn) {
         resultsObj.push_back(packErrorRetStatus("local", "Can't find patriotnode by pubkey"));
         return mnKeyList();
@@ -732,7 +732,7 @@ UniValue mnbudgetrawvote(const JSONRPCRequest& request)
     if (fInvalid)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Malformed base64 encoding");
 
-    CPatriotnode* pmn = mnodeman.Find(vin.prevout);
+    PatriotnodeRef pmn = mnodeman.Find(vin.prevout);
     if (!pmn) {
         return "Failure to find patriotnode in list : " + vin.ToString();
     }
@@ -44,7 +44,9 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "delegatestake", 4, "include_delegated" },
     { "delegatestake", 5, "from_shield" },
     { "estimatefee", 0, "nblocks" },
+    { "estimatefee", 1, "shielded" },
     { "estimatesmartfee", 0, "nblocks" },
+    { "estimatesmartfee", 1, "shielded" },
     { "fundrawtransaction", 1, "options" },
     { "generate", 0, "nblocks" },
     { "generatetoaddress", 0, "nblocks" },
@@ -65,6 +67,7 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "getnetworkhashps", 0, "nblocks" },
     { "getnetworkhashps", 1, "height" },
     { "getnodeaddresses", 0, "count" },
+    { "getpatriotnodescores", 1, "verbose" },
     { "getrawmempool", 0, "verbose" },
     { "getrawtransaction", 1, "verbose" },
     { "getreceivedbyaddress", 1, "minconf" },
@@ -790,15 +790,16 @@ UniValue submitblock(const JSONRPCRequest& request)
 
 UniValue estimatefee(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 1)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
         throw std::runtime_error(
-            "estimatefee nblocks\n"
+            "estimatefee nblocks ( shielded )\n"
             "\nEstimates the approximate fee per kilobyte\n"
             "needed for a transaction to begin confirmation\n"
             "within nblocks blocks.\n"
 
             "\nArguments:\n"
             "1. nblocks     (numeric)\n"
+            "2. shielded    (boolean, optional, default=false) estimate for shielded transactions\n"
 
             "\nResult:\n"
             "n :    (numeric) estimated fee-per-kilobyte\n"
@@ -809,13 +810,14 @@ UniValue estimatefee(const JSONRPCRequest& request)
             "\nExample:\n" +
             HelpExampleCli("estimatefee", "6"));
 
-    RPCTypeCheck(request.params, {UniValue::VNUM});
+    RPCTypeCheck(request.params, {UniValue::VNUM, UniValue::VBOOL});
 
     int nBlocks = request.params[0].get_int();
     if (nBlocks < 1)
         nBlocks = 1;
+    const bool fShielded = request.params.size() > 1 && request.params[1].get_bool();
 
-    CFeeRate feeRate = mempool.estimateFee(nBlocks);
+    CFeeRate feeRate = mempool.estimateFee(nBlocks, fShielded);
     if (feeRate == CFeeRate(0))
         return -1.0;
 
@@ -824,15 +826,16 @@ UniValue estimatefee(const JSONRPCRequest& request)
 
 UniValue estimatesmartfee(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 1)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
         throw std::runtime_error(
-                "estimatesmartfee nblocks\n"
+                "estimatesmartfee nblocks ( shielded )\n"
                 "\nDEPRECATED. WARNING: This interface is unstable and may disappear or change!\n"
                 "\nEstimates the approximate fee per kilobyte needed for a transaction to begin\n"
                 "confirmation within nblocks blocks if possible and return the number of blocks\n"
                 "for which the estimate is valid.\n"
                 "\nArguments:\n"
                 "1. nblocks     (numeric)\n"
+                "2. shielded    (boolean, optional, default=false) estimate for shielded transactions\n"
                 "\nResult:\n"
                 "{\n"
                 "  \"feerate\" : x.x,     (numeric) estimate fee-per-kilobyte (in BTC)\n"
@@ -846,13 +849,14 @@ UniValue estimatesmartfee(const JSONRPCRequest& request)
                 + HelpExampleCli("estimatesmartfee", "6")
         );
 
-    RPCTypeCheck(request.params, {UniValue::VNUM});
+    RPCTypeCheck(request.params, {UniValue::VNUM, UniValue::VBOOL});
 
     int nBlocks = request.params[0].get_int();
+    const bool fShielded = request.params.size() > 1 && request.params[1].get_bool();
 
     UniValue result(UniValue::VOBJ);
     int answerFound;
-    CFeeRate feeRate = mempool.estimateSmartFee(nBlocks, &answerFound);
+    CFeeRate feeRate = mempool.estimateSmartFee(nBlocks, &answerFound, fShielded);
     result.pushKV("feerate", feeRate == CFeeRate(0) ? -1.0 : ValueFromAmount(feeRate.GetFeePerK()));
     result.pushKV("blocks", answerFound);
     return result;
@@ -861,8 +865,8 @@ UniValue estimatesmartfee(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ --------
-    { "util",               "estimatefee",            &estimatefee,            true,  {"nblocks"} },
-    { "util",               "estimatesmartfee",       &estimatesmartfee,       true,  {"nblocks"} },
+    { "util",               "estimatefee",            &estimatefee,            true,  {"nblocks","shielded"} },
+    { "util",               "estimatesmartfee",       &estimatesmartfee,       true,  {"nblocks","shielded"} },
     { "mining",             "prioritisetransaction",  &prioritisetransaction,  true,  {"txid","priority_delta","fee_delta"} },
 
     /* Not shown in help */
@@ -5,6 +5,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "blockreadcache.h"
 #include "clientversion.h"
 #include "httpserver.h"
 #include "init.h"
@@ -718,6 +719,24 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCBlockReadCacheInfo()
+{
+    CBlockReadCache::Stats stats = g_blockreadcache.GetStats();
+    const uint64_t nLookups = stats.nHits + stats.nMisses;
+    const uint64_t nReads = stats.nMappedReads + stats.nFileReads;
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("blocks", (uint64_t)stats.nBlocks);
+    obj.pushKV("hits", stats.nHits);
+    obj.pushKV("misses", stats.nMisses);
+    obj.pushKV("hit_rate", nLookups ? (double)stats.nHits / nLookups : 0.0);
+    obj.pushKV("mapped_files", (uint64_t)stats.nMappedFiles);
+    obj.pushKV("mapped_bytes", (uint64_t)stats.nMappedBytes);
+    obj.pushKV("mapped_reads", stats.nMappedReads);
+    obj.pushKV("file_reads", stats.nFileReads);
+    obj.pushKV("mapped_read_rate", nReads ? (double)stats.nMappedReads / nReads : 0.0);
+    return obj;
+}
+
 UniValue getmemoryinfo(const JSONRPCRequest& request)
 {
     /* Please, avoid using the word "pool" here in the RPC interface or help,
@@ -736,6 +755,17 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"blockcache\": {           (json object) Information about the block read cache\n"
+            "    \"blocks\": xxxxx,        (numeric) Number of decoded blocks currently cached\n"
+            "    \"hits\": xxxxx,          (numeric) Block reads served from the decoded block cache\n"
+            "    \"misses\": xxxxx,        (numeric) Block reads not found in the decoded block cache\n"
+            "    \"hit_rate\": x.xxx,      (numeric) hits / (hits + misses)\n"
+            "    \"mapped_files\": xxxxx,  (numeric) Number of block and undo files currently memory-mapped\n"
+            "    \"mapped_bytes\": xxxxx,  (numeric) Total size of the memory-mapped files\n"
+            "    \"mapped_reads\": xxxxx,  (numeric) Block and undo records read from a memory-mapped file\n"
+            "    \"file_reads\": xxxxx,    (numeric) Block and undo records read through regular file access\n"
+            "    \"mapped_read_rate\": x.xxx, (numeric) mapped_reads / (mapped_reads + file_reads)\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -744,6 +774,7 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
         );
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("locked", RPCLockedMemoryInfo());
+    obj.pushKV("blockcache", RPCBlockReadCacheInfo());
     return obj;
 }
 
@@ -182,6 +182,73 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue getorphaninfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getorphaninfo\n"
+            "\nReturns details on the pool of transactions received with missing inputs.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": n,                (numeric) Number of orphan transactions\n"
+            "  \"bytes\": n,               (numeric) Total size of the orphan transactions\n"
+            "  \"maxsize\": n,             (numeric) Maximum number of orphan transactions (-maxorphantx)\n"
+            "  \"maxbytes\": n,            (numeric) Maximum total size of the orphan transactions (-maxorphantxsize)\n"
+            "  \"peers\": [                (array) Size of the orphans kept for each peer\n"
+            "    {\n"
+            "      \"id\": n,              (numeric) Peer index\n"
+            "      \"bytes\": n            (numeric) Total size of the orphans received from the peer\n"
+            "    }\n"
+            "    ,...\n"
+            "  ],\n"
+            "  \"resolved\": n,            (numeric) Orphans accepted to the mempool once their parents arrived\n"
+            "  \"rejected\": n,            (numeric) Orphans rejected once their parents arrived\n"
+            "  \"evicted\": n,             (numeric) Orphans evicted to keep the pool within its limits\n"
+            "  \"expired\": n,             (numeric) Orphans removed after waiting too long for their parents\n"
+            "  \"recent_rejects\": [       (array) Latest rejected orphans, most recent last\n"
+            "    {\n"
+            "      \"txid\": \"hash\",       (string) The transaction id\n"
+            "      \"reason\": \"str\"       (string) Why it was rejected\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getorphaninfo", "") + HelpExampleRpc("getorphaninfo", ""));
+
+    COrphanTxStats stats;
+    GetOrphanTxStats(stats);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("size", (uint64_t)stats.nCount);
+    obj.pushKV("bytes", (uint64_t)stats.nBytes);
+    obj.pushKV("maxsize", std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS)));
+    obj.pushKV("maxbytes", std::max((int64_t)0, gArgs.GetArg("-maxorphantxsize", DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE)) * 1000000);
+    UniValue peers(UniValue::VARR);
+    for (const auto& it : stats.mapBytesByPeer) {
+        UniValue peer(UniValue::VOBJ);
+        peer.pushKV("id", it.first);
+        peer.pushKV("bytes", (uint64_t)it.second);
+        peers.push_back(peer);
+    }
+    obj.pushKV("peers", peers);
+    obj.pushKV("resolved", stats.nResolved);
+    obj.pushKV("rejected", stats.nRejected);
+    obj.pushKV("evicted", stats.nEvicted);
+    obj.pushKV("expired", stats.nExpired);
+    UniValue rejects(UniValue::VARR);
+    for (const auto& it : stats.vRecentRejects) {
+        UniValue reject(UniValue::VOBJ);
+        reject.pushKV("txid", it.first.GetHex());
+        reject.pushKV("reason", it.second);
+        rejects.push_back(reject);
+    }
+    obj.pushKV("recent_rejects", rejects);
+    return obj;
+}
+
 UniValue addnode(const JSONRPCRequest& request)
 {
     std::string strCommand;
@@ -676,6 +743,7 @@ static const CRPCCommand commands[] =
     { "network",            "getnettotals",           &getnettotals,           true,  {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  {} },
     { "network",            "getnodeaddresses",       &getnodeaddresses,       true,  {"count"} },
+    { "network",            "getorphaninfo",          &getorphaninfo,          true,  {} },
     { "network",            "getpeerinfo",            &getpeerinfo,            true,  {} },
     { "network",            "listbanned",             &listbanned,             true,  {} },
     { "network",            "ping",                   &ping,                   true,  {} },
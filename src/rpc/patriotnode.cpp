@@ -339,7 +339,7 @@ bool StartPatriotnodeEntry(UniValue& statusObjRet, CPatriotnodeBroadcast& mnbRet
     }
 
     CTxIn vin = CTxIn(uint256S(mne.getTxHash()), uint32_t(nIndex));
-    CPatriotnode* pmn = mnodeman.Find(vin.prevout);
+    PatriotnodeRef pmn = mnodeman.Find(vin.prevout);
     if (pmn != NULL) {
         if (strCommand == "missing") return false;
         if (strCommand == "disabled" && pmn->IsEnabled()) return false;
@@ -641,7 +641,7 @@ UniValue listpatriotnodeconf(const JSONRPCRequest& request)
         if(!mne.castOutputIndex(nIndex))
             continue;
         CTxIn vin = CTxIn(uint256S(mne.getTxHash()), uint32_t(nIndex));
-        CPatriotnode* pmn = mnodeman.Find(vin.prevout);
+        PatriotnodeRef pmn = mnodeman.Find(vin.prevout);
 
         std::string strStatus = pmn ? pmn->Status() : "MISSING";
 
@@ -719,7 +719,7 @@ UniValue getpatriotnodestatus(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_MISC_ERROR, _("Legacy Patriotnode is obsolete."));
     }
 
-    CPatriotnode* pmn = mnodeman.Find(activePatriotnode.vin->prevout);
+    PatriotnodeRef pmn = mnodeman.Find(activePatriotnode.vin->prevout);
 
     if (pmn) {
         UniValue mnObj(UniValue::VOBJ);
@@ -834,13 +834,14 @@ UniValue getpatriotnodewinners(const JSONRPCRequest& request)
 
 UniValue getpatriotnodescores(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() > 1)
+    if (request.fHelp || request.params.size() > 2)
         throw std::runtime_error(
-            "getpatriotnodescores ( blocks )\n"
+            "getpatriotnodescores ( blocks verbose )\n"
             "\nPrint list of winning patriotnode by score\n"
 
             "\nArguments:\n"
             "1. blocks      (numeric, optional) Show the last n blocks (default 10)\n"
+            "2. verbose     (boolean, optional, default=false) Also return the ranking computation time and score cache statistics\n"
 
             "\nResult:\n"
             "{\n"
@@ -848,12 +849,24 @@ UniValue getpatriotnodescores(const JSONRPCRequest& request)
             "  ,...\n"
             "}\n"
 
+            "\nResult (verbose):\n"
+            "{\n"
+            "  \"winners\": {...},          (object) The object above\n"
+            "  \"ranking_time_ms\": n,      (numeric) Time spent computing the winners, in milliseconds\n"
+            "  \"score_cache\": {\n"
+            "    \"block_hashes\": n,       (numeric) Block hashes with cached patriotnode scores\n"
+            "    \"computed\": n,           (numeric) Scores computed since startup\n"
+            "    \"reused\": n              (numeric) Scores served from the cache since startup\n"
+            "  }\n"
+            "}\n"
+
             "\nExamples:\n" +
-            HelpExampleCli("getpatriotnodescores", "") + HelpExampleRpc("getpatriotnodescores", ""));
+            HelpExampleCli("getpatriotnodescores", "") + HelpExampleCli("getpatriotnodescores", "\"10\" true") +
+            HelpExampleRpc("getpatriotnodescores", ""));
 
     int nLast = 10;
 
-    if (request.params.size() == 1) {
+    if (!request.params[0].isNull()) {
         try {
             nLast = std::stoi(request.params[0].get_str());
         } catch (const std::invalid_argument&) {
@@ -861,8 +874,12 @@ UniValue getpatriotnodescores(const JSONRPCRequest& request)
         }
     }
 
+    const bool fVerbose = request.params.size() > 1 && request.params[1].get_bool();
+
+    const int64_t nTimeStart = GetTimeMicros();
     std::vector<std::pair<PatriotnodeRef, int>> vMnScores = mnodeman.GetMnScores(nLast);
-    if (vMnScores.empty()) return "unknown";
+    const int64_t nTimeRanking = GetTimeMicros() - nTimeStart;
+    if (vMnScores.empty() && !fVerbose) return "unknown";
 
     UniValue obj(UniValue::VOBJ);
     for (const auto& p : vMnScores) {
@@ -870,7 +887,20 @@ UniValue getpatriotnodescores(const JSONRPCRequest& request)
         const int nHeight = p.second;
         obj.pushKV(strprintf("%d", nHeight), mn->vin.prevout.hash.ToString().c_str());
     }
-    return obj;
+    if (!fVerbose) return obj;
+
+    size_t nHashes;
+    uint64_t nComputed, nReused;
+    mnodeman.GetScoreCacheStats(nHashes, nComputed, nReused);
+    UniValue cacheObj(UniValue::VOBJ);
+    cacheObj.pushKV("block_hashes", (uint64_t)nHashes);
+    cacheObj.pushKV("computed", nComputed);
+    cacheObj.pushKV("reused", nReused);
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("winners", obj);
+    ret.pushKV("ranking_time_ms", 0.001 * nTimeRanking);
+    ret.pushKV("score_cache", cacheObj);
+    return ret;
 }
 
 bool DecodeHexMnb(CPatriotnodeBroadcast& mnb, std::string strHexMnb) {
@@ -1100,7 +1130,7 @@ static const CRPCCommand commands[] =
     { "patriotnode",         "decodepatriotnodebroadcast", &decodepatriotnodebroadcast, true,  {"hexstring"} },
     { "patriotnode",         "getpatriotnodecount",        &getpatriotnodecount,        true,  {} },
     { "patriotnode",         "getpatriotnodeoutputs",      &getpatriotnodeoutputs,      true,  {} },
-    { "patriotnode",         "getpatriotnodescores",       &getpatriotnodescores,       true,  {"blocks"} },
+    { "patriotnode",         "getpatriotnodescores",       &getpatriotnodescores,       true,  {"blocks","verbose"} },
     { "patriotnode",         "getpatriotnodestatus",       &getpatriotnodestatus,       true,  {} },
     { "patriotnode",         "getpatriotnodewinners",      &getpatriotnodewinners,      true,  {"blocks","filter"} },
     { "patriotnode",         "initpatriotnode",            &initpatriotnode,            true,  {"privkey","address","deterministic"} },
@@ -34,12 +34,27 @@ CSporkManager::CSporkManager()
         sporkDefsById.emplace(sporkDef.sporkId, &sporkDef);
         sporkDefsByName.emplace(sporkDef.name, &sporkDef);
     }
+    LOCK(cs);
+    PublishSporkValues();
 }
 
 void CSporkManager::Clear()
 {
+    LOCK(cs);
     strMasterPrivKey = "";
     mapSporksActive.clear();
+    PublishSporkValues();
+}
+
+void CSporkManager::PublishSporkValues()
+{
+    AssertLockHeld(cs);
+    auto values = std::make_shared<SporkValues>();
+    for (const auto& it : sporkDefsById) {
+        auto itActive = mapSporksActive.find(it.first);
+        values->emplace(it.first, itActive != mapSporksActive.end() ? itActive->second.nValue : it.second->defaultValue);
+    }
+    std::atomic_store(&pSporkValues, std::shared_ptr<const SporkValues>(std::move(values)));
 }
 
 // TrumpCoin: on startup load spork values from previous session if they exist in the sporkDB
@@ -212,6 +227,7 @@ void CSporkManager::AddOrUpdateSporkMessage(const CSporkMessage& spork, bool flu
         LOCK(cs);
         mapSporks[spork.GetHash()] = spork;
         mapSporksActive[spork.nSporkID] = spork;
+        PublishSporkValues();
     }
     if (flush) {
         // add to spork database.
@@ -220,28 +236,21 @@ void CSporkManager::AddOrUpdateSporkMessage(const CSporkMessage& spork, bool flu
 }
 
 // grab the spork value, and see if it's off
-bool CSporkManager::IsSporkActive(SporkId nSporkID)
+bool CSporkManager::IsSporkActive(SporkId nSporkID) const
 {
     return GetSporkValue(nSporkID) < GetAdjustedTime();
 }
 
 // grab the value of the spork on the network, or the default
-int64_t CSporkManager::GetSporkValue(SporkId nSporkID)
+int64_t CSporkManager::GetSporkValue(SporkId nSporkID) const
 {
-    LOCK(cs);
-
-    if (mapSporksActive.count(nSporkID)) {
-        return mapSporksActive[nSporkID].nValue;
-
-    } else {
-        auto it = sporkDefsById.find(nSporkID);
-        if (it != sporkDefsById.end()) {
-            return it->second->defaultValue;
-        } else {
-            LogPrintf("%s : Unknown Spork %d\n", __func__, nSporkID);
-        }
+    const auto values = std::atomic_load(&pSporkValues);
+    auto it = values->find(nSporkID);
+    if (it != values->end()) {
+        return it->second;
     }
 
+    LogPrintf("%s : Unknown Spork %d\n", __func__, nSporkID);
     return -1;
 }
 
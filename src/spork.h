@@ -17,6 +17,8 @@
 
 #include "protocol.h"
 
+#include <memory>
+
 
 class CSporkMessage;
 class CSporkManager;
@@ -76,23 +78,34 @@ private:
     std::map<std::string, CSporkDef*> sporkDefsByName;
     std::map<SporkId, CSporkMessage> mapSporksActive;
 
+    // Values of all the known sporks (active or default), republished whenever
+    // mapSporksActive changes: GetSporkValue reads them without taking cs.
+    typedef std::map<SporkId, int64_t> SporkValues;
+    std::shared_ptr<const SporkValues> pSporkValues;
+    // cs held
+    void PublishSporkValues();
+
 public:
     CSporkManager();
 
-    SERIALIZE_METHODS(CSporkManager, obj) { READWRITE(obj.mapSporksActive); }
+    SERIALIZE_METHODS(CSporkManager, obj)
+    {
+        READWRITE(obj.mapSporksActive);
+        SER_READ(obj, WITH_LOCK(obj.cs, obj.PublishSporkValues()));
+    }
 
     void Clear();
     void LoadSporksFromDB();
 
     void ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
-    int64_t GetSporkValue(SporkId nSporkID);
+    int64_t GetSporkValue(SporkId nSporkID) const;
     // Create/Sign/Relay the spork message, and update the maps
     bool UpdateSpork(SporkId nSporkID, int64_t nValue);
     // Add spork message to mapSporks and mapSporksActive.
     // if flush=true, save to DB as well
     void AddOrUpdateSporkMessage(const CSporkMessage& spork, bool flush = false);
 
-    bool IsSporkActive(SporkId nSporkID);
+    bool IsSporkActive(SporkId nSporkID) const;
     std::string GetSporkNameByID(SporkId id);
     SporkId GetSporkIDByName(std::string strName);
 
@@ -25,13 +25,15 @@
 #include <boost/test/unit_test.hpp>
 
 // Tests this internal-to-validation.cpp method:
-extern bool AddOrphanTx(const CTransactionRef& tx, NodeId peer);
+extern bool AddOrphanTx(const CTransactionRef& tx, NodeId peer, size_t nMaxPeerBytes = std::numeric_limits<size_t>::max());
 extern void EraseOrphansFor(NodeId peer);
-extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
+extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans, size_t nMaxOrphanBytes = std::numeric_limits<size_t>::max());
 struct COrphanTx {
     CTransactionRef tx;
     NodeId fromPeer;
     int64_t nTimeExpire;
+    size_t list_pos;
+    size_t nSize;
 };
 extern RecursiveMutex g_cs_orphans;
 extern std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(g_cs_orphans);
@@ -252,6 +254,35 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
         BOOST_CHECK(mapOrphanTransactions.size() < sizeBefore);
     }
 
+    // Test the per-peer quota: peer 3 can't add more than its share
+    {
+        COrphanTxStats stats;
+        GetOrphanTxStats(stats);
+        const size_t nPeerBytes = stats.mapBytesByPeer[3];
+        BOOST_CHECK(nPeerBytes > 0);
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.hash = InsecureRand256();
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 1*CENT;
+        tx.vout[0].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+        CTransactionRef ptx = MakeTransactionRef(tx);
+        BOOST_CHECK(!AddOrphanTx(ptx, 3, nPeerBytes));
+        BOOST_CHECK(AddOrphanTx(ptx, 3, nPeerBytes + ptx->GetTotalSize()));
+    }
+
+    // Test LimitOrphanTxSize() function, by size:
+    {
+        COrphanTxStats stats;
+        GetOrphanTxStats(stats);
+        LimitOrphanTxSize(1000, stats.nBytes / 2);
+        GetOrphanTxStats(stats);
+        BOOST_CHECK(stats.nCount > 0);
+        size_t nTotal = 0;
+        for (const auto& it : mapOrphanTransactions) nTotal += it.second.tx->GetTotalSize();
+        BOOST_CHECK_EQUAL(stats.nBytes, nTotal);
+    }
+
     // Test LimitOrphanTxSize() function:
     LimitOrphanTxSize(40);
     BOOST_CHECK(mapOrphanTransactions.size() <= 40);
@@ -259,6 +290,10 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(mapOrphanTransactions.size() <= 10);
     LimitOrphanTxSize(0);
     BOOST_CHECK(mapOrphanTransactions.empty());
+    COrphanTxStats stats;
+    GetOrphanTxStats(stats);
+    BOOST_CHECK_EQUAL(stats.nBytes, 0U);
+    BOOST_CHECK(stats.mapBytesByPeer.empty());
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,9 +4,11 @@
 
 #include "test_trumpcoin.h"
 
+#include "budget/budgetdb.h"
 #include "budget/budgetmanager.h"
 #include "patriotnode-payments.h"
 #include "patriotnode-sync.h"
+#include "patriotnodeman.h"
 #include "spork.h"
 #include "test/util/blocksutil.h"
 #include "tinyformat.h"
@@ -450,4 +452,232 @@ BOOST_FIXTURE_TEST_CASE(IsCoinbaseValueValid_test, TestingSetup)
 
 }
 
+BOOST_FIXTURE_TEST_CASE(proposal_vote_tallies, TestingSetup)
+{
+    const CScript payee = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    CBudgetProposal prop("test", "https://test.com", 1, payee, 100 * COIN, 144, GetRandHash());
+    const uint256& propHash = prop.GetHash();
+    const CTxIn mnVin1(GetRandHash(), 0), mnVin2(GetRandHash(), 0), mnVin3(GetRandHash(), 0);
+    std::string strError;
+    BOOST_CHECK(prop.AddOrUpdateVote(CBudgetVote(mnVin1, propHash, CBudgetVote::VOTE_YES), strError));
+    BOOST_CHECK(prop.AddOrUpdateVote(CBudgetVote(mnVin2, propHash, CBudgetVote::VOTE_NO), strError));
+    BOOST_CHECK(prop.AddOrUpdateVote(CBudgetVote(mnVin3, propHash, CBudgetVote::VOTE_ABSTAIN), strError));
+    BOOST_CHECK_EQUAL(prop.GetYeas(), 1);
+    BOOST_CHECK_EQUAL(prop.GetNays(), 1);
+    BOOST_CHECK_EQUAL(prop.GetAbstains(), 1);
+
+    // Too soon to update the vote: the tallies don't change
+    CBudgetVote vote1(mnVin1, propHash, CBudgetVote::VOTE_NO);
+    BOOST_CHECK(!prop.AddOrUpdateVote(vote1, strError));
+    BOOST_CHECK_EQUAL(prop.GetYeas(), 1);
+    BOOST_CHECK_EQUAL(prop.GetNays(), 1);
+
+    // The update moves the vote from yes to no
+    vote1.SetTime(vote1.GetTime() + BUDGET_VOTE_UPDATE_MIN);
+    BOOST_CHECK(prop.AddOrUpdateVote(vote1, strError));
+    BOOST_CHECK_EQUAL(prop.GetYeas(), 0);
+    BOOST_CHECK_EQUAL(prop.GetNays(), 2);
+    BOOST_CHECK_EQUAL(prop.GetAbstains(), 1);
+    BOOST_CHECK_EQUAL(prop.GetRatio(), 0.0);
+
+    // The tallies are recomputed when the proposal is loaded from disk
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << prop;
+    CBudgetProposal prop2;
+    ss >> prop2;
+    BOOST_CHECK_EQUAL(prop2.GetYeas(), 0);
+    BOOST_CHECK_EQUAL(prop2.GetNays(), 2);
+    BOOST_CHECK_EQUAL(prop2.GetAbstains(), 1);
+}
+
+static CPatriotnode MakeEnabledPatriotnode()
+{
+    CPatriotnode mn;
+    mn.vin = CTxIn(GetRandHash(), 0);
+    mn.sigTime = GetAdjustedTime() - PatriotnodeMinPingSeconds();
+    mn.lastPing = CPatriotnodePing(mn.vin, GetRandHash(), GetAdjustedTime());
+    return mn;
+}
+
+BOOST_FIXTURE_TEST_CASE(budget_cache_invalidation, TestingSetup)
+{
+    const int nBlocksPerCycle = Params().GetConsensus().nBudgetCycleBlocks;
+    const CScript payee = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    CBudgetProposal prop("test", "https://test.com", 1, payee, 100 * COIN, nBlocksPerCycle, GetRandHash());
+    prop.nTime = GetAdjustedTime() - Params().GetConsensus().nProposalEstablishmentTime - 1;
+    const uint256& propHash = prop.GetHash();
+
+    // One enabled patriotnode votes yes
+    CPatriotnode mn = MakeEnabledPatriotnode();
+    BOOST_CHECK(mnodeman.Add(mn));
+    std::string strError;
+    BOOST_CHECK(prop.AddOrUpdateVote(CBudgetVote(mn.vin, propHash, CBudgetVote::VOTE_YES), strError));
+
+    // Expired: added to the map, but not ranked
+    BOOST_CHECK(!prop.UpdateValid(prop.GetBlockEnd() + 1));
+    CBudgetManager budgetman;
+    budgetman.SetBestHeight(100);
+    budgetman.ForceAddProposal(propHash, prop.GetFeeTXHash(), prop);
+    BOOST_CHECK(budgetman.GetBudget().empty());
+
+    // Valid again at the same height: the ranking is refreshed
+    budgetman.CheckAndRemove();
+    BOOST_CHECK(budgetman.HaveProposal(propHash));
+    std::vector<CBudgetProposal> vBudget = budgetman.GetBudget();
+    BOOST_CHECK_EQUAL(vBudget.size(), 1);
+    BOOST_CHECK(vBudget[0].GetHash() == propHash);
+
+    // Nothing changed: the cached ranking is returned
+    BOOST_CHECK_EQUAL(budgetman.GetBudget().size(), 1);
+
+    // More enabled patriotnodes raise the passing threshold to one net yes vote
+    std::vector<CTxIn> vNewVins;
+    for (int i = 0; i < 9; i++) {
+        CPatriotnode mn2 = MakeEnabledPatriotnode();
+        BOOST_CHECK(mnodeman.Add(mn2));
+        vNewVins.emplace_back(mn2.vin);
+    }
+    BOOST_CHECK_EQUAL(mnodeman.CountEnabled(ActiveProtocol()), 10);
+    BOOST_CHECK(budgetman.GetBudget().empty());
+
+    // And removing them lowers it again
+    for (const CTxIn& vin : vNewVins) {
+        mnodeman.Remove(vin.prevout);
+    }
+    BOOST_CHECK_EQUAL(budgetman.GetBudget().size(), 1);
+
+    mnodeman.Clear();
+}
+
+BOOST_FIXTURE_TEST_CASE(budget_db_incremental_write, TestingSetup)
+{
+    const CScript payee = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    const CTxBudgetPayment txBudgetPayment(GetRandHash(), payee, 100 * COIN);
+    CFinalizedBudget fin("main (test)", 144, {txBudgetPayment}, GetRandHash());
+    CFinalizedBudget fin2("main2 (test)", 144, {txBudgetPayment}, GetRandHash());
+
+    CBudgetDB db(true, true);
+    CBudgetManager budgetman;
+    budgetman.ForceAddFinalizedBudget(fin.GetHash(), fin.GetFeeTXHash(), fin);
+    BOOST_CHECK(db.Write(budgetman));
+
+    // Only the new budget is written, the first one is still there
+    budgetman.ForceAddFinalizedBudget(fin2.GetHash(), fin2.GetFeeTXHash(), fin2);
+    BOOST_CHECK(db.Write(budgetman));
+    CBudgetManager budgetman2;
+    BOOST_CHECK_EQUAL(db.Read(budgetman2, true), CBudgetDB::Ok);
+    BOOST_CHECK(budgetman2.HaveFinalizedBudget(fin.GetHash()));
+    BOOST_CHECK(budgetman2.HaveFinalizedBudget(fin2.GetHash()));
+
+    // Removed objects are erased from the db
+    budgetman.RemoveByFeeTxId(fin.GetFeeTXHash());
+    BOOST_CHECK(db.Write(budgetman));
+    CBudgetManager budgetman3;
+    BOOST_CHECK_EQUAL(db.Read(budgetman3, true), CBudgetDB::Ok);
+    BOOST_CHECK(!budgetman3.HaveFinalizedBudget(fin.GetHash()));
+    BOOST_CHECK(budgetman3.HaveFinalizedBudget(fin2.GetHash()));
+
+    budgetman.Clear();
+    BOOST_CHECK(db.Write(budgetman));
+    CBudgetManager budgetman4;
+    BOOST_CHECK_EQUAL(db.Read(budgetman4, true), CBudgetDB::Empty);
+}
+
+BOOST_FIXTURE_TEST_CASE(budget_db_votes, TestingSetup)
+{
+    const CScript payee = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    const CBudgetProposal prop("test", "https://test.com", 1, payee, 100 * COIN, 144, GetRandHash());
+    const uint256& propHash = prop.GetHash();
+
+    CBudgetDB db(true, true);
+    CBudgetManager budgetman;
+    budgetman.ForceAddProposal(propHash, prop.GetFeeTXHash(), prop);
+    BOOST_CHECK(db.Write(budgetman));
+
+    // Each vote is written as its own record
+    std::string strError;
+    BOOST_CHECK(budgetman.UpdateProposal(CBudgetVote(CTxIn(GetRandHash(), 0), propHash, CBudgetVote::VOTE_YES), nullptr, strError));
+    BOOST_CHECK(db.Write(budgetman));
+    BOOST_CHECK(budgetman.UpdateProposal(CBudgetVote(CTxIn(GetRandHash(), 0), propHash, CBudgetVote::VOTE_NO), nullptr, strError));
+    BOOST_CHECK(db.Write(budgetman));
+    CBudgetManager budgetman2;
+    BOOST_CHECK_EQUAL(db.Read(budgetman2, true), CBudgetDB::Ok);
+    CBudgetProposal prop2;
+    BOOST_CHECK(budgetman2.GetProposal(propHash, prop2));
+    BOOST_CHECK_EQUAL(prop2.GetYeas(), 1);
+    BOOST_CHECK_EQUAL(prop2.GetNays(), 1);
+
+    // The votes are erased with the proposal
+    budgetman.RemoveByFeeTxId(prop.GetFeeTXHash());
+    budgetman.ForceAddProposal(propHash, prop.GetFeeTXHash(), prop);
+    BOOST_CHECK(db.Write(budgetman));
+    CBudgetManager budgetman3;
+    BOOST_CHECK_EQUAL(db.Read(budgetman3, true), CBudgetDB::Ok);
+    BOOST_CHECK(budgetman3.GetProposal(propHash, prop2));
+    BOOST_CHECK_EQUAL(prop2.GetYeas(), 0);
+    BOOST_CHECK_EQUAL(prop2.GetNays(), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(budget_db_unreadable_record, TestingSetup)
+{
+    const CScript payee = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    const CBudgetProposal prop("test", "https://test.com", 1, payee, 100 * COIN, 144, GetRandHash());
+
+    // A record that can't be read fails the load once, then the db is empty
+    CBudgetDB db(true, true);
+    CBudgetManager budgetman;
+    budgetman.ForceAddProposal(prop.GetHash(), prop.GetFeeTXHash(), prop);
+    BOOST_CHECK(db.Write(budgetman));
+    static_cast<CDBWrapper&>(db).Write(std::make_pair('p', GetRandHash()), std::string("bad"));
+    CBudgetManager budgetman2;
+    BOOST_CHECK_EQUAL(db.Read(budgetman2, true), CBudgetDB::IncorrectFormat);
+    CBudgetManager budgetman3;
+    BOOST_CHECK_EQUAL(db.Read(budgetman3, true), CBudgetDB::Empty);
+
+    // Same for the patriotnode winners
+    CPatriotnodePaymentDB paymentdb(true, true);
+    static_cast<CDBWrapper&>(paymentdb).Write(std::make_pair('w', GetRandHash()), std::string("bad"));
+    CPatriotnodePayments payments;
+    BOOST_CHECK_EQUAL(paymentdb.Read(payments), CPatriotnodePaymentDB::IncorrectFormat);
+    BOOST_CHECK_EQUAL(paymentdb.Read(payments), CPatriotnodePaymentDB::Empty);
+}
+
+BOOST_FIXTURE_TEST_CASE(budget_db_import_legacy_file, TestingSetup)
+{
+    const CScript payee = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    CBudgetProposal prop("test", "https://test.com", 1, payee, 100 * COIN, 144, GetRandHash());
+    const uint256& propHash = prop.GetHash();
+    std::string strError;
+    BOOST_CHECK(prop.AddOrUpdateVote(CBudgetVote(CTxIn(GetRandHash(), 0), propHash, CBudgetVote::VOTE_YES), strError));
+
+    // budget.dat, as written by older versions
+    std::map<uint256, CBudgetProposal> mapProposals{{propHash, prop}};
+    std::map<uint256, uint256> mapFeeTxIndex{{prop.GetFeeTXHash(), propHash}};
+    std::map<uint256, CBudgetVote> mapVotes;
+    std::map<uint256, CFinalizedBudget> mapFinalizedBudgets;
+    std::map<uint256, CFinalizedBudgetVote> mapFinalizedVotes;
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << 1 << std::string("PatriotnodeBudget") << Params().MessageStart();
+    ss << mapProposals << mapFeeTxIndex << mapVotes << mapVotes;
+    ss << mapFinalizedBudgets << std::map<uint256, uint256>() << std::map<uint256, uint256>() << mapFinalizedVotes << mapFinalizedVotes;
+    ss << Hash(ss.begin(), ss.end());
+    const fs::path pathLegacy = GetDataDir() / "budget.dat";
+    CAutoFile fileout(fsbridge::fopen(pathLegacy, "wb"), SER_DISK, CLIENT_VERSION);
+    fileout << ss;
+    fileout.fclose();
+
+    // It is imported into the db once, then removed
+    CBudgetDB db(true, true);
+    CBudgetManager budgetman;
+    BOOST_CHECK_EQUAL(db.Read(budgetman, true), CBudgetDB::Ok);
+    BOOST_CHECK(!fs::exists(pathLegacy));
+    CBudgetProposal prop2;
+    BOOST_CHECK(budgetman.GetProposal(propHash, prop2));
+    BOOST_CHECK_EQUAL(prop2.GetYeas(), 1);
+
+    CBudgetManager budgetman2;
+    BOOST_CHECK_EQUAL(db.Read(budgetman2, true), CBudgetDB::Ok);
+    BOOST_CHECK(budgetman2.HaveProposal(propHash));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include "consensus/merkle.h"
 #include "evo/specialtx.h"
 #include "evo/deterministicmns.h"
+#include "evo/providertx.h"
 #include "patriotnode-payments.h"
 #include "patriotnode-sync.h"
 #include "messagesigner.h"
@@ -633,6 +634,21 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         auto tx2 = MalleateProTxPayout<ProUpRegPL>(tx);
         BOOST_CHECK_MESSAGE(!CheckSpecialTx(tx2, chainTip, state), "Malleated ProUpReg accepted");
         BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-protx-sig");
+        // the signature checks can be deferred
+        std::vector<CProTxSigCheck> vChecks;
+        state = CValidationState();
+        BOOST_CHECK(CheckSpecialTx(tx, chainTip, state, &vChecks));
+        BOOST_CHECK(CheckSpecialTx(tx2, chainTip, state, &vChecks));
+        BOOST_CHECK_EQUAL(vChecks.size(), 2U);
+        BOOST_CHECK(vChecks[0]());
+        BOOST_CHECK(!vChecks[1]());
+        // and are run by the signature check queue when connecting a block
+        CBlock block = CreateBlock({tx2}, coinbaseKey);
+        CBlockIndex indexFake(block);
+        indexFake.nHeight = nHeight;
+        indexFake.pprev = chainTip;
+        BOOST_CHECK(!ProcessSpecialTxsInBlock(block, &indexFake, state, true));
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-protx-sig");
 
         CreateAndProcessBlock({tx}, coinbaseKey);
         chainTip = chainActive.Tip();
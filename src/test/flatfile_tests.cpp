@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "blockreadcache.h"
 #include "flatfile.h"
 #include "test/test_trumpcoin.h"
 
@@ -120,4 +121,78 @@ BOOST_AUTO_TEST_CASE(flatfile_flush)
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+BOOST_AUTO_TEST_CASE(flatfile_map)
+{
+    auto data_dir = SetDataDir("flatfile_test");
+    FlatFileSeq seq(data_dir, "a", 100);
+
+    std::string line1("A purse or a wallet contains money for making purchases.\n");
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, 0)), SER_DISK, CLIENT_VERSION);
+        file << LIMITED_STRING(line1, 256);
+    }
+
+    // Missing file can't be mapped
+    BOOST_CHECK(seq.Map(FlatFilePos(1, 0)) == nullptr);
+    BOOST_CHECK(seq.Map(FlatFilePos()) == nullptr);
+
+#ifndef WIN32
+    std::shared_ptr<const FlatFileMapping> mapping = seq.Map(FlatFilePos(0, 0));
+    if (sizeof(void*) < 8) {
+        // mapping is disabled on 32-bit systems
+        BOOST_CHECK(mapping == nullptr);
+        return;
+    }
+    BOOST_REQUIRE(mapping != nullptr);
+    BOOST_CHECK_EQUAL(mapping->size(), fs::file_size(seq.FileName(FlatFilePos(0, 0))));
+
+    // Mapped content matches what was written
+    std::string text;
+    CDataStream ss((const char*)mapping->data(), (const char*)mapping->data() + mapping->size(), SER_DISK, CLIENT_VERSION);
+    ss >> LIMITED_STRING(text, 256);
+    BOOST_CHECK_EQUAL(text, line1);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(blockreadcache_drop_mappings)
+{
+    auto data_dir = SetDataDir("flatfile_test");
+    FlatFileSeq seq(data_dir, "a", 100);
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, 0)), SER_DISK, CLIENT_VERSION);
+        file << std::vector<unsigned char>(200, 0);
+    }
+
+    CBlockReadCache cache;
+    const FlatFilePos pos(0, 0);
+    std::shared_ptr<const FlatFileMapping> mapping = cache.GetMapping(seq, pos, false);
+#ifndef WIN32
+    if (sizeof(void*) >= 8) {
+        BOOST_REQUIRE(mapping != nullptr);
+        BOOST_CHECK_EQUAL(cache.GetStats().nMappedFiles, 1U);
+    }
+#endif
+    // The same mapping is handed out until the file is dropped
+    BOOST_CHECK(cache.GetMapping(seq, pos, false) == mapping);
+
+    // Truncate the file (as finalizing it does): a new mapping covers the new size only
+    cache.DropFile(0);
+    BOOST_CHECK_EQUAL(cache.GetStats().nMappedFiles, 0U);
+    mapping.reset();
+    BOOST_CHECK(seq.Flush(FlatFilePos(0, 50), true));
+    mapping = cache.GetMapping(seq, pos, false);
+#ifndef WIN32
+    if (sizeof(void*) >= 8) {
+        BOOST_REQUIRE(mapping != nullptr);
+        BOOST_CHECK_EQUAL(mapping->size(), 50U);
+    }
+#endif
+
+    cache.AddBlock(UINT256_ZERO, std::make_shared<const CBlock>());
+    BOOST_CHECK(cache.GetBlock(UINT256_ZERO) != nullptr);
+    cache.Clear();
+    BOOST_CHECK(cache.GetBlock(UINT256_ZERO) == nullptr);
+    BOOST_CHECK_EQUAL(cache.GetStats().nMappedFiles, 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,8 +5,10 @@
 #include "test/test_trumpcoin.h"
 
 #include "policy/feerate.h"
+#include "script/standard.h"
 #include "txmempool.h"
 #include "util/system.h"
+#include "validation.h"
 
 #include <boost/test/unit_test.hpp>
 
@@ -426,6 +428,162 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
 }
 
 
+static CMutableTransaction MakeChildTx(const std::vector<COutPoint>& vPrevouts, int nOutputs, CAmount nValue)
+{
+    CMutableTransaction tx;
+    for (const COutPoint& prevout : vPrevouts) {
+        tx.vin.emplace_back(prevout);
+        tx.vin.back().scriptSig = CScript() << OP_11;
+    }
+    tx.vout.resize(nOutputs);
+    for (CTxOut& out : tx.vout) {
+        out.scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        out.nValue = nValue;
+    }
+    return tx;
+}
+
+// Check the ancestor and descendant state of the entry of tx against the given remaining relatives
+static void CheckPackageState(const CTxMemPool& pool, const CMutableTransaction& tx,
+                              const std::vector<CMutableTransaction>& vAncestors,
+                              const std::vector<CMutableTransaction>& vDescendants)
+{
+    LOCK(pool.cs);
+    auto it = pool.mapTx.find(tx.GetHash());
+    BOOST_REQUIRE(it != pool.mapTx.end());
+    uint64_t nSize = 0;
+    CAmount nFees = 0;
+    for (const CMutableTransaction& ancestor : vAncestors) {
+        auto ait = pool.mapTx.find(ancestor.GetHash());
+        BOOST_REQUIRE(ait != pool.mapTx.end());
+        nSize += ait->GetTxSize();
+        nFees += ait->GetModifiedFee();
+    }
+    BOOST_CHECK_EQUAL(it->GetCountWithAncestors(), vAncestors.size() + 1);
+    BOOST_CHECK_EQUAL(it->GetSizeWithAncestors(), nSize + it->GetTxSize());
+    BOOST_CHECK_EQUAL(it->GetModFeesWithAncestors(), nFees + it->GetModifiedFee());
+    BOOST_CHECK_EQUAL(it->GetSigOpCountWithAncestors(), vAncestors.size() + 1);
+    nSize = 0;
+    nFees = 0;
+    for (const CMutableTransaction& descendant : vDescendants) {
+        auto dit = pool.mapTx.find(descendant.GetHash());
+        BOOST_REQUIRE(dit != pool.mapTx.end());
+        nSize += dit->GetTxSize();
+        nFees += dit->GetModifiedFee();
+    }
+    BOOST_CHECK_EQUAL(it->GetCountWithDescendants(), vDescendants.size() + 1);
+    BOOST_CHECK_EQUAL(it->GetSizeWithDescendants(), nSize + it->GetTxSize());
+    BOOST_CHECK_EQUAL(it->GetModFeesWithDescendants(), nFees + it->GetModifiedFee());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolRemoveForBlockPackagesTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    // Chain of 10 transactions
+    std::vector<CMutableTransaction> vChain;
+    for (int i = 0; i < 10; i++) {
+        std::vector<COutPoint> vPrevouts{i == 0 ? COutPoint(uint256S("0x01"), 0) : COutPoint(vChain.back().GetHash(), 0)};
+        vChain.emplace_back(MakeChildTx(vPrevouts, 1, (100 - i) * COIN));
+        pool.addUnchecked(vChain.back().GetHash(), entry.Fee(1000 * (i + 1)).FromTx(vChain.back()));
+    }
+    // Diamond: tx0 -> txA, txB -> txC (spending both) -> txD
+    CMutableTransaction tx0 = MakeChildTx({COutPoint(uint256S("0x02"), 0)}, 2, 10 * COIN);
+    CMutableTransaction txA = MakeChildTx({COutPoint(tx0.GetHash(), 0)}, 1, 9 * COIN);
+    CMutableTransaction txB = MakeChildTx({COutPoint(tx0.GetHash(), 1)}, 1, 8 * COIN);
+    CMutableTransaction txC = MakeChildTx({COutPoint(txA.GetHash(), 0), COutPoint(txB.GetHash(), 0)}, 1, 7 * COIN);
+    CMutableTransaction txD = MakeChildTx({COutPoint(txC.GetHash(), 0)}, 1, 6 * COIN);
+    pool.addUnchecked(tx0.GetHash(), entry.Fee(5000LL).FromTx(tx0));
+    pool.addUnchecked(txA.GetHash(), entry.Fee(6000LL).FromTx(txA));
+    pool.addUnchecked(txB.GetHash(), entry.Fee(7000LL).FromTx(txB));
+    pool.addUnchecked(txC.GetHash(), entry.Fee(8000LL).FromTx(txC));
+    pool.addUnchecked(txD.GetHash(), entry.Fee(9000LL).FromTx(txD));
+    BOOST_CHECK_EQUAL(pool.size(), 15);
+    CheckPackageState(pool, txC, {tx0, txA, txB}, {txD});
+    CheckPackageState(pool, vChain[4], {vChain.begin(), vChain.begin() + 4}, {vChain.begin() + 5, vChain.end()});
+
+    // The block confirms the first 4 transactions of the chain, tx0 and txA of the
+    // diamond, and conflicts with the 9th transaction of the chain (and so the 10th).
+    CMutableTransaction txConflict = MakeChildTx({COutPoint(vChain[7].GetHash(), 0)}, 1, 1 * COIN);
+    std::vector<CTransactionRef> vtx;
+    for (int i = 0; i < 4; i++) {
+        vtx.emplace_back(MakeTransactionRef(vChain[i]));
+    }
+    vtx.emplace_back(MakeTransactionRef(tx0));
+    vtx.emplace_back(MakeTransactionRef(txA));
+    vtx.emplace_back(MakeTransactionRef(txConflict));
+    pool.removeForBlock(vtx, 1);
+    BOOST_CHECK_EQUAL(pool.size(), 7);
+
+    for (int i = 4; i < 8; i++) {
+        CheckPackageState(pool, vChain[i], {vChain.begin() + 4, vChain.begin() + i}, {vChain.begin() + i + 1, vChain.begin() + 8});
+    }
+    BOOST_CHECK(!pool.exists(vChain[8].GetHash()));
+    BOOST_CHECK(!pool.exists(vChain[9].GetHash()));
+    CheckPackageState(pool, txB, {}, {txC, txD});
+    CheckPackageState(pool, txC, {txB}, {txD});
+    CheckPackageState(pool, txD, {txB, txC}, {});
+
+    // Confirm the rest of the diamond, leaving its last transaction alone
+    vtx.clear();
+    vtx.emplace_back(MakeTransactionRef(txB));
+    vtx.emplace_back(MakeTransactionRef(txC));
+    pool.removeForBlock(vtx, 2);
+    BOOST_CHECK_EQUAL(pool.size(), 5);
+    CheckPackageState(pool, txD, {}, {});
+}
+
+BOOST_AUTO_TEST_CASE(MempoolRemoveForReorgTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+    const int nMaturity = Params().GetConsensus().nCoinbaseMaturity;
+    const int nNextHeight = WITH_LOCK(cs_main, return chainActive.Height() + 1);
+
+    // Spends a coinstake output that is mature at height nMaturity + 1, but not at nMaturity
+    const COutPoint stakePrevout(uint256S("0x01"), 0);
+    coins.AddCoin(stakePrevout, Coin(CTxOut(10 * COIN, CScript() << OP_11 << OP_EQUAL), 1, false, true), false);
+    CMutableTransaction txStakeSpend = MakeChildTx({stakePrevout}, 1, 9 * COIN);
+    pool.addUnchecked(txStakeSpend.GetHash(), entry.SpendsCoinbaseOrCoinstake(true).FromTx(txStakeSpend));
+    // and its child, which does not depend on the tip by itself
+    CMutableTransaction txStakeChild = MakeChildTx({COutPoint(txStakeSpend.GetHash(), 0)}, 1, 8 * COIN);
+    pool.addUnchecked(txStakeChild.GetHash(), entry.SpendsCoinbaseOrCoinstake(false).FromTx(txStakeChild));
+
+    // Time-locked to a height above the next block of the active chain
+    CMutableTransaction txLockedHeight = MakeChildTx({COutPoint(uint256S("0x02"), 0)}, 1, 7 * COIN);
+    txLockedHeight.vin[0].nSequence = 0;
+    txLockedHeight.nLockTime = nNextHeight + 1;
+    pool.addUnchecked(txLockedHeight.GetHash(), entry.FromTx(txLockedHeight));
+
+    // Time-locked to a time long past
+    CMutableTransaction txLockedTime = MakeChildTx({COutPoint(uint256S("0x03"), 0)}, 1, 6 * COIN);
+    txLockedTime.vin[0].nSequence = 0;
+    txLockedTime.nLockTime = LOCKTIME_THRESHOLD + 1;
+    pool.addUnchecked(txLockedTime.GetHash(), entry.FromTx(txLockedTime));
+
+    // Not depending on the tip
+    CMutableTransaction txPlain = MakeChildTx({COutPoint(uint256S("0x04"), 0)}, 1, 5 * COIN);
+    pool.addUnchecked(txPlain.GetHash(), entry.FromTx(txPlain));
+    BOOST_CHECK_EQUAL(pool.size(), 5);
+
+    LOCK(cs_main);
+    // Coinstake mature: only the transaction that is not final goes
+    pool.removeForReorg(&coins, nMaturity + 1, STANDARD_LOCKTIME_VERIFY_FLAGS);
+    BOOST_CHECK_EQUAL(pool.size(), 4);
+    BOOST_CHECK(!pool.exists(txLockedHeight.GetHash()));
+
+    // One block lower: the coinstake spend is immature, and goes with its child
+    pool.removeForReorg(&coins, nMaturity, STANDARD_LOCKTIME_VERIFY_FLAGS);
+    BOOST_CHECK_EQUAL(pool.size(), 2);
+    BOOST_CHECK(!pool.exists(txStakeSpend.GetHash()));
+    BOOST_CHECK(!pool.exists(txStakeChild.GetHash()));
+    BOOST_CHECK(pool.exists(txLockedTime.GetHash()));
+    BOOST_CHECK(pool.exists(txPlain.GetHash()));
+}
+
 BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
 {
     CTxMemPool pool(CFeeRate(1000));
@@ -579,4 +737,87 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolSaplingAnchorTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool(CFeeRate(0));
+    const uint256 anchorA = uint256S("0xaa");
+    const uint256 anchorB = uint256S("0xbb");
+
+    // Shielded tx spending one note from each anchor
+    CMutableTransaction tx1;
+    tx1.nVersion = CTransaction::TxVersion::SAPLING;
+    tx1.vin.resize(1);
+    tx1.vin[0].scriptSig = CScript() << OP_11;
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    tx1.sapData = SaplingTxData();
+    tx1.sapData->vShieldedSpend.resize(2);
+    tx1.sapData->vShieldedSpend[0].anchor = anchorA;
+    tx1.sapData->vShieldedSpend[0].nullifier = uint256S("0x01");
+    tx1.sapData->vShieldedSpend[1].anchor = anchorB;
+    tx1.sapData->vShieldedSpend[1].nullifier = uint256S("0x02");
+
+    // Transparent child of tx1
+    CMutableTransaction tx2;
+    tx2.vin.resize(1);
+    tx2.vin[0].scriptSig = CScript() << OP_11;
+    tx2.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+    tx2.vout.resize(1);
+    tx2.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx2.vout[0].nValue = 9 * COIN;
+
+    // Shielded tx spending from anchorB only
+    CMutableTransaction tx3;
+    tx3.nVersion = CTransaction::TxVersion::SAPLING;
+    tx3.vin.resize(1);
+    tx3.vin[0].scriptSig = CScript() << OP_12;
+    tx3.vout.resize(1);
+    tx3.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx3.vout[0].nValue = 10 * COIN;
+    tx3.sapData = SaplingTxData();
+    tx3.sapData->vShieldedSpend.resize(1);
+    tx3.sapData->vShieldedSpend[0].anchor = anchorB;
+    tx3.sapData->vShieldedSpend[0].nullifier = uint256S("0x03");
+
+    pool.addUnchecked(tx1.GetHash(), entry.FromTx(tx1));
+    pool.addUnchecked(tx2.GetHash(), entry.FromTx(tx2));
+    pool.addUnchecked(tx3.GetHash(), entry.FromTx(tx3));
+    BOOST_CHECK(pool.nullifierExists(uint256S("0x01")));
+    BOOST_CHECK(pool.nullifierExists(uint256S("0x03")));
+
+    // Unknown anchor: nothing removed
+    pool.removeWithAnchor(uint256S("0xcc"));
+    BOOST_CHECK_EQUAL(pool.size(), 3);
+
+    // Invalidating anchorA removes tx1 and its descendants only
+    pool.removeWithAnchor(anchorA);
+    BOOST_CHECK_EQUAL(pool.size(), 1);
+    BOOST_CHECK(pool.exists(tx3.GetHash()));
+    BOOST_CHECK(!pool.nullifierExists(uint256S("0x01")));
+    BOOST_CHECK(!pool.nullifierExists(uint256S("0x02")));
+    BOOST_CHECK(pool.nullifierExists(uint256S("0x03")));
+
+    // anchorB is still indexed for tx3
+    pool.removeWithAnchor(anchorB);
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+    BOOST_CHECK(!pool.nullifierExists(uint256S("0x03")));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolEntryP2CSTest)
+{
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx.vout[0].nValue = 10 * COIN;
+    BOOST_CHECK(!entry.FromTx(tx).HasP2CSOutputs());
+
+    const CKeyID keyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35")));
+    tx.vout.emplace_back(10 * COIN, GetScriptForStakeDelegation(keyID, keyID));
+    BOOST_CHECK(entry.FromTx(tx).HasP2CSOutputs());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,86 @@
+// Copyright (c) 2021 The TrumpCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_trumpcoin.h"
+
+#include "patriotnode-sync.h"
+#include "spork.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(patriotnode_sync_tests, TestingSetup)
+
+static std::vector<std::unique_ptr<CNode>> MakeSyncPeers(int nPeers)
+{
+    std::vector<std::unique_ptr<CNode>> vPeers;
+    for (int i = 0; i < nPeers; i++) {
+        vPeers.emplace_back(new CNode(i, NODE_NETWORK, 0, INVALID_SOCKET, CAddress(CService(), NODE_NONE), 0, 0, "", false));
+        vPeers.back()->SetSendVersion(PROTOCOL_VERSION);
+        vPeers.back()->nVersion = PROTOCOL_VERSION;
+    }
+    return vPeers;
+}
+
+BOOST_AUTO_TEST_CASE(sync_request_rounds)
+{
+    const auto vPeers = MakeSyncPeers(20);
+    CPatriotnodeSync sync;
+
+    // Sporks: PATRIOTNODE_SYNC_REQUESTS_PER_ROUND peers are asked in the same round,
+    // then the sync moves to the next asset
+    sync.SwitchToNextAsset();
+    BOOST_CHECK_EQUAL(sync.RequestedPatriotnodeAssets, PATRIOTNODE_SYNC_SPORKS);
+    sync.BeginRequestRound();
+    BOOST_CHECK(sync.SyncWithNode(vPeers[0].get(), false));
+    BOOST_CHECK(sync.SyncWithNode(vPeers[1].get(), false));
+    BOOST_CHECK(!sync.SyncWithNode(vPeers[2].get(), false));
+    BOOST_CHECK_EQUAL(sync.RequestedPatriotnodeAssets, PATRIOTNODE_SYNC_LIST);
+
+    // Winners: the round ends after PATRIOTNODE_SYNC_REQUESTS_PER_ROUND requests
+    sync.RequestedPatriotnodeAssets = PATRIOTNODE_SYNC_PNW;
+    sync.RequestedPatriotnodeAttempt = 0;
+    sync.nAssetSyncStarted = GetTime();
+    sync.BeginRequestRound();
+    BOOST_CHECK(sync.SyncWithNode(vPeers[0].get(), false));
+    BOOST_CHECK(sync.SyncWithNode(vPeers[1].get(), false));
+    BOOST_CHECK(!sync.SyncWithNode(vPeers[2].get(), false));
+    BOOST_CHECK_EQUAL(sync.RequestedPatriotnodeAttempt, 3);
+
+    // Peers already asked are skipped, and not counted
+    sync.BeginRequestRound();
+    BOOST_CHECK(sync.SyncWithNode(vPeers[0].get(), false));
+    BOOST_CHECK(sync.SyncWithNode(vPeers[3].get(), false));
+    BOOST_CHECK(sync.SyncWithNode(vPeers[4].get(), false));
+    BOOST_CHECK(!sync.SyncWithNode(vPeers[5].get(), false));
+    BOOST_CHECK_EQUAL(sync.RequestedPatriotnodeAttempt, 6);
+
+    // The attempt cap keeps the window of PATRIOTNODE_SYNC_THRESHOLD * 3 request rounds
+    for (int nRound = 2; nRound < PATRIOTNODE_SYNC_THRESHOLD * 3; nRound++) {
+        sync.BeginRequestRound();
+        const int nFirst = nRound * PATRIOTNODE_SYNC_REQUESTS_PER_ROUND;
+        BOOST_CHECK(sync.SyncWithNode(vPeers[nFirst].get(), false));
+        BOOST_CHECK(sync.SyncWithNode(vPeers[nFirst + 1].get(), false));
+        BOOST_CHECK(!sync.SyncWithNode(vPeers[nFirst + 2].get(), false));
+        BOOST_CHECK_EQUAL(sync.RequestedPatriotnodeAssets, PATRIOTNODE_SYNC_PNW);
+    }
+    BOOST_CHECK_EQUAL(sync.RequestedPatriotnodeAttempt, 18);
+    sync.BeginRequestRound();
+    BOOST_CHECK(!sync.SyncWithNode(vPeers[18].get(), false));
+    BOOST_CHECK(!vPeers[18]->HasFulfilledRequest("mnwsync"));
+    BOOST_CHECK_EQUAL(sync.RequestedPatriotnodeAssets, sporkManager.IsSporkActive(SPORK_8_PATRIOTNODE_PAYMENT_ENFORCEMENT) ?
+                                                       PATRIOTNODE_SYNC_FAILED : PATRIOTNODE_SYNC_BUDGET);
+
+    // Budget: a single peer per round
+    sync.RequestedPatriotnodeAssets = PATRIOTNODE_SYNC_BUDGET;
+    sync.RequestedPatriotnodeAttempt = 0;
+    sync.nAssetSyncStarted = GetTime();
+    sync.BeginRequestRound();
+    BOOST_CHECK(!sync.SyncWithNode(vPeers[0].get(), false));
+    sync.BeginRequestRound();
+    BOOST_CHECK(sync.SyncWithNode(vPeers[0].get(), false));
+    BOOST_CHECK(!sync.SyncWithNode(vPeers[1].get(), false));
+    BOOST_CHECK_EQUAL(sync.RequestedPatriotnodeAttempt, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,99 @@
+// Copyright (c) 2021 The TrumpCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_trumpcoin.h"
+
+#include "chain.h"
+#include "patriotnodeman.h"
+#include "timedata.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(patriotnodeman_tests, TestingSetup)
+
+static CPatriotnode MakeEnabledPatriotnode()
+{
+    CPatriotnode mn;
+    mn.vin = CTxIn(GetRandHash(), 0);
+    mn.sigTime = GetAdjustedTime() - PatriotnodeMinPingSeconds();
+    mn.lastPing = CPatriotnodePing(mn.vin, GetRandHash(), GetAdjustedTime());
+    return mn;
+}
+
+// Cache the hashes of the blocks up to nHeight, and set it as the best height
+static void ConnectBlocks(CPatriotnodeMan& mnman, std::vector<uint256>& vHashes, int nHeight)
+{
+    for (int h = (int) vHashes.size(); h <= nHeight; h++) {
+        vHashes.emplace_back(GetRandHash());
+        CBlockIndex index;
+        index.nHeight = h;
+        index.phashBlock = &vHashes.back();
+        mnman.CacheBlockHash(&index);
+    }
+    mnman.SetBestHeight(nHeight);
+}
+
+static std::vector<COutPoint> RankedOutpoints(const CPatriotnodeMan& mnman, int nBlockHeight)
+{
+    std::vector<COutPoint> vOutpoints;
+    for (const auto& it : mnman.GetPatriotnodeRanks(nBlockHeight)) {
+        vOutpoints.emplace_back(it.second->vin.prevout);
+    }
+    return vOutpoints;
+}
+
+BOOST_AUTO_TEST_CASE(score_cache)
+{
+    CPatriotnodeMan mnman;
+    for (int i = 0; i < 3; i++) {
+        CPatriotnode mn = MakeEnabledPatriotnode();
+        BOOST_CHECK(mnman.Add(mn));
+    }
+    std::vector<uint256> vHashes;
+    ConnectBlocks(mnman, vHashes, 10);
+
+    size_t nHashes;
+    uint64_t nComputed, nReused;
+
+    // First ranking on the hash of block 9: all the scores are computed
+    const std::vector<COutPoint> vRanked = RankedOutpoints(mnman, 10);
+    BOOST_CHECK_EQUAL(vRanked.size(), 3);
+    mnman.GetScoreCacheStats(nHashes, nComputed, nReused);
+    BOOST_CHECK_EQUAL(nHashes, 1);
+    BOOST_CHECK_EQUAL(nComputed, 3);
+    BOOST_CHECK_EQUAL(nReused, 0);
+
+    // Same (block hash, outpoint) pairs: the cached scores are reused
+    BOOST_CHECK(RankedOutpoints(mnman, 10) == vRanked);
+    mnman.GetScoreCacheStats(nHashes, nComputed, nReused);
+    BOOST_CHECK_EQUAL(nHashes, 1);
+    BOOST_CHECK_EQUAL(nComputed, 3);
+    BOOST_CHECK_EQUAL(nReused, 3);
+
+    // Another block hash gets its own entries
+    RankedOutpoints(mnman, 11);
+    mnman.GetScoreCacheStats(nHashes, nComputed, nReused);
+    BOOST_CHECK_EQUAL(nHashes, 2);
+    BOOST_CHECK_EQUAL(nComputed, 6);
+
+    // Blocks 9 and 10 are evicted once they are more than SCORE_CACHE_DEPTH below the tip
+    ConnectBlocks(mnman, vHashes, 9 + SCORE_CACHE_DEPTH);
+    mnman.GetScoreCacheStats(nHashes, nComputed, nReused);
+    BOOST_CHECK_EQUAL(nHashes, 2);
+    ConnectBlocks(mnman, vHashes, 10 + SCORE_CACHE_DEPTH);
+    mnman.GetScoreCacheStats(nHashes, nComputed, nReused);
+    BOOST_CHECK_EQUAL(nHashes, 1);
+    ConnectBlocks(mnman, vHashes, 11 + SCORE_CACHE_DEPTH);
+    mnman.GetScoreCacheStats(nHashes, nComputed, nReused);
+    BOOST_CHECK_EQUAL(nHashes, 0);
+
+    // Scores of an evicted block are computed again, with the same ranking, and not stored
+    BOOST_CHECK(RankedOutpoints(mnman, 10) == vRanked);
+    mnman.GetScoreCacheStats(nHashes, nComputed, nReused);
+    BOOST_CHECK_EQUAL(nHashes, 0);
+    BOOST_CHECK_EQUAL(nComputed, 9);
+    BOOST_CHECK_EQUAL(nReused, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -186,4 +186,41 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ShieldedPolicyEstimates)
+{
+    CTxMemPool mpool(CFeeRate(1000));
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx;
+    tx.nVersion = CTransaction::TxVersion::SAPLING;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 0LL;
+    tx.sapData = SaplingTxData();
+    tx.sapData->vShieldedOutput.emplace_back();
+    const CFeeRate shieldedRate(1000 * DEFAULT_SHIELDEDTXFEE_K * 2);
+    const CAmount deltaFee(100 * DEFAULT_SHIELDEDTXFEE_K);
+
+    // Only shielded transactions, all mined in the next block
+    std::vector<CTransactionRef> block;
+    int blocknum = 0;
+    while (blocknum < 200) {
+        for (int k = 0; k < 4; k++) {
+            tx.vin[0].prevout.n = 10000 * blocknum + k;
+            const CAmount nFee = shieldedRate.GetFee(::GetSerializeSize(tx, PROTOCOL_VERSION));
+            mpool.addUnchecked(tx.GetHash(), entry.Fee(nFee).Time(GetTime()).Height(blocknum).FromTx(tx));
+            block.emplace_back(mpool.get(tx.GetHash()));
+        }
+        mpool.removeForBlock(block, ++blocknum);
+        block.clear();
+    }
+
+    // They are estimated on their own, and don't affect the transparent estimates
+    BOOST_CHECK(mpool.estimateFee(1) == CFeeRate(0));
+    BOOST_CHECK(mpool.estimateFee(1, true).GetFeePerK() < shieldedRate.GetFeePerK() + deltaFee);
+    BOOST_CHECK(mpool.estimateFee(1, true).GetFeePerK() > shieldedRate.GetFeePerK() - deltaFee);
+    int answerFound;
+    BOOST_CHECK(mpool.estimateSmartFee(1, &answerFound, true) == mpool.estimateFee(1, true) && answerFound == 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -13,6 +13,7 @@
 #include "evo/deterministicmns.h"
 #include "evo/evodb.h"
 #include "evo/evonotificationinterface.h"
+#include "evo/specialtx.h"
 #include "miner.h"
 #include "net_processing.h"
 #include "rpc/server.h"
@@ -106,6 +107,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         nScriptCheckThreads = 3;
         for (int i=0; i < nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i < nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadProTxSigCheck);
+        for (int i=0; i < nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadParallelTask);
         peerLogic.reset(new PeerLogicValidation(connman));
 }
 
@@ -8,6 +8,8 @@
 #include "chainparams.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "fs.h"
+#include "protocol.h"
 #include "pow.h"
 #include "random.h"
 #include "test/test_trumpcoin.h"
@@ -165,4 +167,57 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
     BOOST_CHECK_EQUAL(sub.m_expected_tip, WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash()));
 }
 
+// Append a block record (magic, size, block) to the stream. nSizeExtra is added to the size field.
+static void WriteBlockRecord(CDataStream& ss, const CBlock& block, unsigned int nSizeExtra = 0)
+{
+    CDataStream ssBlock(SER_DISK, CLIENT_VERSION);
+    ssBlock << block;
+    ss.write((const char*)Params().MessageStart(), MESSAGE_START_SIZE);
+    ss << (unsigned int)(ssBlock.size() + nSizeExtra);
+    ss.write(ssBlock.data(), ssBlock.size());
+}
+
+BOOST_AUTO_TEST_CASE(loadexternalblockfile_corrupt_records)
+{
+    BOOST_CHECK(ProcessNewBlock(std::make_shared<CBlock>(Params().GenesisBlock()), nullptr));
+
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    uint256 prev_hash = Params().GenesisBlock().GetHash();
+    for (int i = 0; i < 5; i++) {
+        blocks.emplace_back(GoodBlock(prev_hash));
+        prev_hash = blocks.back()->GetHash();
+    }
+    const unsigned int nRecordSize2 = ::GetSerializeSize(*blocks[2], CLIENT_VERSION) + MESSAGE_START_SIZE + 4;
+    const unsigned int nRecordSize3 = ::GetSerializeSize(*blocks[3], CLIENT_VERSION) + MESSAGE_START_SIZE + 4;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    WriteBlockRecord(ss, *blocks[0]);
+    // oversized size field, covering the next record too
+    WriteBlockRecord(ss, *blocks[1], nRecordSize2);
+    WriteBlockRecord(ss, *blocks[2]);
+    // a record that can't be deserialized, with a size field covering the next record too
+    const std::vector<unsigned char> vchGarbage(128, 0xff);
+    ss.write((const char*)Params().MessageStart(), MESSAGE_START_SIZE);
+    ss << (unsigned int)(vchGarbage.size() + nRecordSize3);
+    ss.write((const char*)vchGarbage.data(), vchGarbage.size());
+    WriteBlockRecord(ss, *blocks[3]);
+    WriteBlockRecord(ss, *blocks[4]);
+
+    const fs::path path = GetDataDir() / "corrupt_blocks.dat";
+    FILE* file = fsbridge::fopen(path, "wb");
+    BOOST_REQUIRE(file);
+    BOOST_REQUIRE_EQUAL(fwrite(ss.data(), 1, ss.size(), file), ss.size());
+    fclose(file);
+
+    file = fsbridge::fopen(path, "rb");
+    BOOST_REQUIRE(file);
+    BOOST_CHECK(LoadExternalBlockFile(file));
+    SyncWithValidationInterfaceQueue();
+
+    // every block got imported
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(chainActive.Height(), 5);
+    BOOST_CHECK_EQUAL(chainActive.Tip()->GetBlockHash(), blocks.back()->GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -159,4 +159,52 @@ BOOST_FIXTURE_TEST_CASE(zerocoin_rejection_tests, WalletRegTestingSetup)
     CheckMempoolZcRejection(mtx, "bad-txns-zc-public-spend");
 }
 
+BOOST_FIXTURE_TEST_CASE(assumevalid_tests, BasicTestingSetup)
+{
+    // Build a chain of 2000 blocks, one every 60 seconds.
+    const int nLength = 2000;
+    std::vector<CBlockIndex> vBlocks(nLength);
+    for (int i = 0; i < nLength; i++) {
+        vBlocks[i].nHeight = i;
+        vBlocks[i].nTime = 1600000000 + i * 60;
+        vBlocks[i].pprev = i ? &vBlocks[i - 1] : nullptr;
+        vBlocks[i].BuildSkip();
+    }
+    // A fork branching off at height 500.
+    std::vector<CBlockIndex> vFork(100);
+    for (int i = 0; i < (int)vFork.size(); i++) {
+        vFork[i].nHeight = 501 + i;
+        vFork[i].nTime = vBlocks[501 + i].nTime;
+        vFork[i].pprev = i ? &vFork[i - 1] : &vBlocks[500];
+        vFork[i].BuildSkip();
+    }
+
+    // Not enough time between the block and the best header: never assumed valid.
+    const CBlockIndex* pindexAV = &vBlocks[1500];
+    const CBlockIndex* pindexBest = &vBlocks[nLength - 1];
+    BOOST_CHECK(!IsAssumedValid(&vBlocks[100], pindexAV, pindexBest));
+
+    // Push the best header far enough in the future.
+    CBlockIndex tip;
+    tip.nHeight = nLength;
+    tip.nTime = vBlocks[nLength - 1].nTime + ASSUMEVALID_MIN_BURIAL_TIME;
+    tip.pprev = &vBlocks[nLength - 1];
+    tip.BuildSkip();
+    pindexBest = &tip;
+
+    // Ancestors of the assumevalid block (and the block itself) are assumed valid.
+    BOOST_CHECK(IsAssumedValid(&vBlocks[0], pindexAV, pindexBest));
+    BOOST_CHECK(IsAssumedValid(&vBlocks[1000], pindexAV, pindexBest));
+    BOOST_CHECK(IsAssumedValid(&vBlocks[1500], pindexAV, pindexBest));
+    // Descendants are not.
+    BOOST_CHECK(!IsAssumedValid(&vBlocks[1501], pindexAV, pindexBest));
+    // Neither are blocks off the assumevalid chain.
+    BOOST_CHECK(!IsAssumedValid(&vFork[50], pindexAV, pindexBest));
+    // Nor anything, if the assumevalid block is not in the best header chain.
+    BOOST_CHECK(!IsAssumedValid(&vBlocks[100], &vFork[99], pindexBest));
+    // Null inputs disable the optimization.
+    BOOST_CHECK(!IsAssumedValid(&vBlocks[100], nullptr, pindexBest));
+    BOOST_CHECK(!IsAssumedValid(&vBlocks[100], pindexAV, nullptr));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
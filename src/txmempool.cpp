@@ -21,6 +21,16 @@
 #include "validation.h"
 #include "validationinterface.h"
 
+#include <algorithm>
+
+
+/** Whether tx can become non-final if the chain tip goes back. */
+static bool IsTimeLocked(const CTransaction& tx)
+{
+    if (tx.nLockTime == 0)
+        return false;
+    return std::any_of(tx.vin.begin(), tx.vin.end(), [](const CTxIn& txin) { return !txin.IsFinal(); });
+}
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
@@ -32,6 +42,7 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     nUsageSize = _tx->DynamicMemoryUsage();
     hasZerocoins = _tx->ContainsZerocoins();
     m_isShielded = _tx->IsShieldedTx();
+    m_hasP2CSOutputs = _tx->HasP2CSOutputs();
 
     nCountWithDescendants = 1;
     nSizeWithDescendants = nTxSize;
@@ -55,7 +66,7 @@ void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
 // Update the given tx for any in-mempool descendants.
 // Assumes that setMemPoolChildren is correct for the given tx and all
 // descendants.
-void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
+void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude, deltaMap &mapAncestorDeltas)
 {
     setEntries stageEntries, setAllDescendants;
     stageEntries = GetMemPoolChildren(updateIt);
@@ -90,8 +101,12 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
             modifyFee += cit->GetModifiedFee();
             modifyCount++;
             cachedDescendants[updateIt].insert(cit);
-            // Update ancestor state for each descendant
-            mapTx.modify(cit, update_ancestor_state(updateIt->GetTxSize(), updateIt->GetModifiedFee(), 1, updateIt->GetSigOpCount()));
+            // Accumulate the ancestor state update for each descendant
+            StateDelta& delta = mapAncestorDeltas[cit];
+            delta.nSize += updateIt->GetTxSize();
+            delta.nFee += updateIt->GetModifiedFee();
+            delta.nCount++;
+            delta.nSigOps += updateIt->GetSigOpCount();
         }
     }
     mapTx.modify(updateIt, update_descendant_state(modifySize, modifyFee, modifyCount));
@@ -109,6 +124,9 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
     // in-vHashesToUpdate transactions, so that we don't have to recalculate
     // descendants when we come across a previously seen entry.
     cacheMap mapMemPoolDescendantsToUpdate;
+    // Descendants reachable from several of the entries get their ancestor
+    // state modified once, after all the entries have been processed.
+    deltaMap mapAncestorDeltas;
 
     // Use a set for lookups into vHashesToUpdate (these entries are already
     // accounted for in the state of their ancestors)
@@ -141,7 +159,11 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
                 UpdateParent(childIter, it, true);
             }
         }
-        UpdateForDescendants(it, mapMemPoolDescendantsToUpdate, setAlreadyIncluded);
+        UpdateForDescendants(it, mapMemPoolDescendantsToUpdate, setAlreadyIncluded, mapAncestorDeltas);
+    }
+    for (const auto& it : mapAncestorDeltas) {
+        const StateDelta& delta = it.second;
+        mapTx.modify(it.first, update_ancestor_state(delta.nSize, delta.nFee, delta.nCount, delta.nSigOps));
     }
 }
 
@@ -244,11 +266,130 @@ void CTxMemPool::UpdateChildrenForRemoval(txiter it)
     }
 }
 
+const CTxMemPool::setEntries& CTxMemPool::GetRemovedSet(removedMap& mapRemoved, const RemovedRelatives& relatives, bool fDescendants)
+{
+    if (relatives.pset) return *relatives.pset;
+    // Closed entry: it is removed with all of its relatives in that direction
+    RemovedRelatives& closed = mapRemoved.at(relatives.itClosed);
+    if (!closed.pset) {
+        auto pset = std::make_shared<setEntries>();
+        if (fDescendants) {
+            const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+            std::string dummy;
+            CalculateMemPoolAncestors(*closed.itClosed, *pset, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+            pset->insert(closed.itClosed);
+        } else {
+            CalculateDescendants(closed.itClosed, *pset);
+        }
+        closed.pset = std::move(pset);
+    }
+    return *closed.pset;
+}
+
+void CTxMemPool::CalculateRemovalDeltas(const setEntries& entriesToRemove, bool fDescendants, deltaMap& mapDeltas)
+{
+    // The entries that stay in the mempool and are reached from the removed
+    // ones, following children (fDescendants) or parents.
+    setEntries setRemaining;
+    std::vector<txiter> vStack(entriesToRemove.begin(), entriesToRemove.end());
+    setEntries setVisited(entriesToRemove);
+    while (!vStack.empty()) {
+        const txiter it = vStack.back();
+        vStack.pop_back();
+        for (const txiter& linkIt : fDescendants ? GetMemPoolChildren(it) : GetMemPoolParents(it)) {
+            if (setVisited.insert(linkIt).second) {
+                if (!entriesToRemove.count(linkIt)) setRemaining.insert(linkIt);
+                vStack.push_back(linkIt);
+            }
+        }
+    }
+
+    // Removed relatives of each entry, computed from those of its links in the
+    // opposite direction, in topological order.
+    removedMap mapRemoved;
+    for (const txiter& remainingIt : setRemaining) {
+        vStack.assign(1, remainingIt);
+        while (!vStack.empty()) {
+            const txiter it = vStack.back();
+            if (mapRemoved.count(it)) {
+                vStack.pop_back();
+                continue;
+            }
+            const setEntries& setBack = fDescendants ? GetMemPoolParents(it) : GetMemPoolChildren(it);
+            bool fReady = true;
+            for (const txiter& linkIt : setBack) {
+                if (setVisited.count(linkIt) && !mapRemoved.count(linkIt)) {
+                    vStack.push_back(linkIt);
+                    fReady = false;
+                }
+            }
+            if (!fReady) continue;
+            vStack.pop_back();
+
+            const bool fRemoved = entriesToRemove.count(it);
+            bool fClosed = fRemoved;
+            std::vector<const RemovedRelatives*> vLinked;
+            for (const txiter& linkIt : setBack) {
+                if (!setVisited.count(linkIt)) {
+                    fClosed = false;
+                    continue;
+                }
+                const RemovedRelatives& linked = mapRemoved.at(linkIt);
+                if (!linked.fClosed) fClosed = false;
+                vLinked.push_back(&linked);
+            }
+            RemovedRelatives& relatives = mapRemoved[it];
+            if (fClosed) {
+                relatives.fClosed = true;
+                relatives.itClosed = it;
+                relatives.sum.nSize = fDescendants ? it->GetSizeWithAncestors() : it->GetSizeWithDescendants();
+                relatives.sum.nFee = fDescendants ? it->GetModFeesWithAncestors() : it->GetModFeesWithDescendants();
+                relatives.sum.nCount = fDescendants ? it->GetCountWithAncestors() : it->GetCountWithDescendants();
+                relatives.sum.nSigOps = fDescendants ? it->GetSigOpCountWithAncestors() : 0;
+            } else if (!fRemoved && vLinked.size() == 1) {
+                // Same removed relatives as the only link leading to them
+                relatives = *vLinked.front();
+            } else {
+                auto pset = std::make_shared<setEntries>();
+                if (fRemoved) pset->insert(it);
+                for (const RemovedRelatives* linked : vLinked) {
+                    const setEntries& setLinked = GetRemovedSet(mapRemoved, *linked, fDescendants);
+                    pset->insert(setLinked.begin(), setLinked.end());
+                }
+                for (const txiter& removedIt : *pset) {
+                    relatives.sum.nSize += removedIt->GetTxSize();
+                    relatives.sum.nFee += removedIt->GetModifiedFee();
+                    relatives.sum.nCount++;
+                    relatives.sum.nSigOps += removedIt->GetSigOpCount();
+                }
+                relatives.pset = std::move(pset);
+            }
+        }
+        const StateDelta& sum = mapRemoved.at(remainingIt).sum;
+        StateDelta& delta = mapDeltas[remainingIt];
+        delta.nSize -= sum.nSize;
+        delta.nFee -= sum.nFee;
+        delta.nCount -= sum.nCount;
+        delta.nSigOps -= sum.nSigOps;
+    }
+}
+
 void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants)
 {
-    // For each entry, walk back all ancestors and decrement size associated with this
-    // transaction
-    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    // The whole set is handled as a batch: only entries that stay in the
+    // mempool have their state updated, the walks are shared between removed
+    // entries of the same cluster, and every remaining entry is modified once,
+    // so the cost scales with the size of the clusters touched rather than
+    // with the number of removed entries times the cluster size.
+    //
+    // Relatives are found through mapLinks rather than by searching mapTx.
+    // If we are in the middle of processing a reorg, ie before
+    // UpdateTransactionsFromBlock() has been called, mapLinks[] will differ
+    // from the set of mempool parents we'd calculate by searching, and it's
+    // important that we use the mapLinks[] notion of ancestor transactions as
+    // the set of things to update for removal, since those are the ones whose
+    // packages include the removed transactions.
+    deltaMap mapRemainingDeltas;
     if (updateDescendants) {
         // updateDescendants should be true whenever we're not recursively
         // removing a tx and all its descendants, eg when a transaction is
@@ -256,47 +397,26 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // Here we only update statistics and not data in mapLinks (which
         // we need to preserve until we're finished with all operations that
         // need to traverse the mempool).
-        for (const txiter& removeIt : entriesToRemove) {
-            setEntries setDescendants;
-            CalculateDescendants(removeIt, setDescendants);
-            setDescendants.erase(removeIt); // don't update state for self
-            int64_t modifySize = -((int64_t)removeIt->GetTxSize());
-            CAmount modifyFee = -removeIt->GetModifiedFee();
-            int modifySigOps = -removeIt->GetSigOpCount();
-            for (const txiter& dit : setDescendants) {
-                mapTx.modify(dit, update_ancestor_state(modifySize, modifyFee, -1, modifySigOps));
-            }
+        CalculateRemovalDeltas(entriesToRemove, true, mapRemainingDeltas);
+        for (const auto& it : mapRemainingDeltas) {
+            const StateDelta& delta = it.second;
+            mapTx.modify(it.first, update_ancestor_state(delta.nSize, delta.nFee, delta.nCount, delta.nSigOps));
         }
+        mapRemainingDeltas.clear();
     }
+    CalculateRemovalDeltas(entriesToRemove, false, mapRemainingDeltas);
+    for (const auto& it : mapRemainingDeltas) {
+        const StateDelta& delta = it.second;
+        mapTx.modify(it.first, update_descendant_state(delta.nSize, delta.nFee, delta.nCount));
+    }
+    // After updating all the ancestor and descendant sizes, we can now sever
+    // the links between each transaction being removed and its in-mempool
+    // parents and children.
     for (const txiter& removeIt : entriesToRemove) {
-        setEntries setAncestors;
-        const CTxMemPoolEntry &entry = *removeIt;
-        std::string dummy;
-        // Since this is a tx that is already in the mempool, we can call CMPA
-        // with fSearchForParents = false.  If the mempool is in a consistent
-        // state, then using true or false should both be correct, though false
-        // should be a bit faster.
-        // However, if we happen to be in the middle of processing a reorg, then
-        // the mempool can be in an inconsistent state.  In this case, the set
-        // of ancestors reachable via mapLinks will be the same as the set of
-        // ancestors whose packages include this transaction, because when we
-        // add a new transaction to the mempool in addUnchecked(), we assume it
-        // has no children, and in the case of a reorg where that assumption is
-        // false, the in-mempool children aren't linked to the in-block tx's
-        // until UpdateTransactionsFromBlock() is called.
-        // So if we're being called during a reorg, ie before
-        // UpdateTransactionsFromBlock() has been called, then mapLinks[] will
-        // differ from the set of mempool parents we'd calculate by searching,
-        // and it's important that we use the mapLinks[] notion of ancestor
-        // transactions as the set of things to update for removal.
-        CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
-        // Note that UpdateAncestorsOf severs the child links that point to
-        // removeIt in the entries for the parents of removeIt.
-        UpdateAncestorsOf(false, removeIt, setAncestors);
-    }
-    // After updating all the ancestor sizes, we can now sever the link between each
-    // transaction being removed and any mempool children (ie, update setMemPoolParents
-    // for each direct child of a transaction being removed).
+        for (const txiter& piter : GetMemPoolParents(removeIt)) {
+            UpdateChild(piter, removeIt, false);
+        }
+    }
     for (const txiter& removeIt : entriesToRemove) {
         UpdateChildrenForRemoval(removeIt);
     }
@@ -460,10 +580,18 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     UpdateAncestorsOf(true, newit, setAncestors);
     UpdateEntryForAncestors(newit, setAncestors);
 
-    // Save spent nullifiers
+    if (entry.GetSpendsCoinbaseOrCoinstake() || IsTimeLocked(tx)) {
+        setTipDependent.insert(newit);
+    }
+
+    // Save spent nullifiers and anchors
     if (tx.IsShieldedTx()) {
         for (const SpendDescription& sd : tx.sapData->vShieldedSpend) {
-            mapSaplingNullifiers[sd.nullifier] = newit->GetSharedTx();
+            mapSaplingNullifiers[sd.nullifier] = newit;
+            setEntries& anchorTxes = mapSaplingAnchors[sd.anchor];
+            if (anchorTxes.insert(newit).second) {
+                cachedInnerUsage += memusage::IncrementalDynamicUsage(anchorTxes);
+            }
         }
     }
 
@@ -550,10 +678,17 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     const CTransaction& tx = it->GetTx();
     for (const CTxIn& txin : tx.vin)
         mapNextTx.erase(txin.prevout);
-    // Remove spent nullifiers
+    setTipDependent.erase(it);
+
+    // Remove spent nullifiers and anchors
     if (tx.IsShieldedTx()) {
         for (const SpendDescription& sd : tx.sapData->vShieldedSpend) {
             mapSaplingNullifiers.erase(sd.nullifier);
+            auto anchorIt = mapSaplingAnchors.find(sd.anchor);
+            if (anchorIt != mapSaplingAnchors.end() && anchorIt->second.erase(it)) {
+                cachedInnerUsage -= memusage::IncrementalDynamicUsage(anchorIt->second);
+                if (anchorIt->second.empty()) mapSaplingAnchors.erase(anchorIt);
+            }
         }
     }
 
@@ -635,7 +770,7 @@ void CTxMemPool::removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMem
     // Remove transactions spending a coinbase which are now immature and no-longer-final transactions
     LOCK(cs);
     setEntries txToRemove;
-    for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
+    for (txiter it : setTipDependent) {
         const CTransactionRef& tx = it->GetSharedTx();
         if (!CheckFinalTx(tx, flags)) {
             txToRemove.insert(it);
@@ -668,52 +803,50 @@ void CTxMemPool::removeWithAnchor(const uint256& invalidRoot)
     // from that root -- almost as though they were spending coinbases
     // which are no longer valid to spend due to coinbase maturity.
     LOCK(cs);
-    std::list<CTransaction> transactionsToRemove;
-    for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
-        const CTransaction& tx = it->GetTx();
-        if (!tx.IsShieldedTx()) continue;
-        for (const auto& sd : tx.sapData->vShieldedSpend) {
-            if (sd.anchor == invalidRoot) {
-                transactionsToRemove.emplace_back(tx);
-                break;
-            }
-        }
-    }
-    for (const CTransaction& tx : transactionsToRemove) {
-        removeRecursive(tx);
+    const auto& anchorIt = mapSaplingAnchors.find(invalidRoot);
+    if (anchorIt == mapSaplingAnchors.end()) return;
+    setEntries setAllRemoves;
+    for (txiter it : anchorIt->second) {
+        CalculateDescendants(it, setAllRemoves);
     }
+    RemoveStaged(setAllRemoves, false);
 }
 
-void CTxMemPool::removeConflicts(const CTransaction& tx)
+void CTxMemPool::CalculateConflicts(const CTransaction& tx, setEntries& setConflicts) const
 {
-    // Remove transactions which depend on inputs of tx, recursively
-    std::list<CTransaction> result;
-    LOCK(cs);
+    AssertLockHeld(cs);
+    const uint256& hash = tx.GetHash();
     for (const CTxIn& txin : tx.vin) {
         auto it = mapNextTx.find(txin.prevout);
-        if (it != mapNextTx.end()) {
-            const CTransaction& txConflict = *it->second;
-            if (txConflict != tx) {
-                removeRecursive(txConflict, MemPoolRemovalReason::CONFLICT);
-                ClearPrioritisation(txConflict.GetHash());
-            }
+        if (it != mapNextTx.end() && it->second->GetHash() != hash) {
+            setConflicts.insert(mapTx.find(it->second->GetHash()));
         }
     }
-    // Remove txes with conflicting nullifier
+    // Txes with conflicting nullifier
     if (tx.IsShieldedTx()) {
         for (const SpendDescription& sd : tx.sapData->vShieldedSpend) {
             const auto& it = mapSaplingNullifiers.find(sd.nullifier);
-            if (it != mapSaplingNullifiers.end()) {
-                const CTransaction& txConflict = *it->second;
-                if (txConflict != tx) {
-                    removeRecursive(txConflict, MemPoolRemovalReason::CONFLICT);
-                    ClearPrioritisation(txConflict.GetHash());
-                }
+            if (it != mapSaplingNullifiers.end() && it->second->GetTx().GetHash() != hash) {
+                setConflicts.insert(it->second);
             }
         }
     }
 }
 
+void CTxMemPool::removeConflicts(const CTransaction& tx)
+{
+    // Remove transactions which depend on inputs of tx, recursively
+    LOCK(cs);
+    setEntries setConflicts;
+    CalculateConflicts(tx, setConflicts);
+    setEntries setAllRemoves;
+    for (const txiter& it : setConflicts) {
+        ClearPrioritisation(it->GetTx().GetHash());
+        CalculateDescendants(it, setAllRemoves);
+    }
+    RemoveStaged(setAllRemoves, false, MemPoolRemovalReason::CONFLICT);
+}
+
 void CTxMemPool::removeProTxPubKeyConflicts(const CTransaction& tx, const CKeyID& keyId)
 {
     if (mapProTxPubKeyIDs.count(keyId)) {
@@ -833,23 +966,31 @@ void CTxMemPool::removeProTxConflicts(const CTransaction &tx)
 void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight)
 {
     LOCK(cs);
+    setEntries stage;
     std::vector<const CTxMemPoolEntry*> entries;
-    for (const auto& tx : vtx) {
-        uint256 hash = tx->GetHash();
-        indexed_transaction_set::iterator i = mapTx.find(hash);
-        if (i != mapTx.end())
-            entries.push_back(&*i);
-    }
-    // Before the txs in the new block have been removed from the mempool, update policy estimates
-    minerPolicyEstimator->processBlock(nBlockHeight, entries);
     for (const auto& tx : vtx) {
         txiter it = mapTx.find(tx->GetHash());
         if (it != mapTx.end()) {
-            setEntries stage;
             stage.insert(it);
-            RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
+            entries.push_back(&*it);
         }
-        removeConflicts(*tx);
+    }
+    // Before the txs in the new block have been removed from the mempool, update policy estimates
+    minerPolicyEstimator->processBlock(nBlockHeight, entries);
+    // Remove all the block's transactions in a single pass, then everything
+    // conflicting with them (together with its descendants) in another one.
+    RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
+    setEntries setConflicts;
+    for (const auto& tx : vtx) {
+        CalculateConflicts(*tx, setConflicts);
+    }
+    setEntries setAllRemoves;
+    for (const txiter& it : setConflicts) {
+        ClearPrioritisation(it->GetTx().GetHash());
+        CalculateDescendants(it, setAllRemoves);
+    }
+    RemoveStaged(setAllRemoves, false, MemPoolRemovalReason::CONFLICT);
+    for (const auto& tx : vtx) {
         removeProTxConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
     }
@@ -863,6 +1004,9 @@ void CTxMemPool::_clear()
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
+    mapSaplingNullifiers.clear();
+    mapSaplingAnchors.clear();
+    setTipDependent.clear();
     mapProTxAddresses.clear();
     mapProTxPubKeyIDs.clear();
     totalTxSize = 0;
@@ -943,9 +1087,14 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
                 SaplingMerkleTree tree;
                 assert(pcoins->GetSaplingAnchorAt(sd.anchor, tree));
                 assert(!pcoins->GetNullifier(sd.nullifier));
+                const auto& nfIt = mapSaplingNullifiers.find(sd.nullifier);
+                assert(nfIt != mapSaplingNullifiers.end() && nfIt->second == it);
+                const auto& anchorIt = mapSaplingAnchors.find(sd.anchor);
+                assert(anchorIt != mapSaplingAnchors.end() && anchorIt->second.count(it));
             }
         }
         assert(setParentCheck == GetMemPoolParents(it));
+        assert(setTipDependent.count(it) == (it->GetSpendsCoinbaseOrCoinstake() || IsTimeLocked(tx)));
         // Verify ancestor state is correct.
         setEntries setAncestors;
         uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -1019,8 +1168,11 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
         assert(tx == it->second);
     }
 
-    // Consistency check for sapling nullifiers
+    // Consistency check for sapling nullifiers and anchors
     checkNullifiers();
+    for (const auto& anchorIt : mapSaplingAnchors) {
+        innerUsage += memusage::DynamicUsage(anchorIt.second);
+    }
 
     assert(totalTxSize == checkTotal);
     assert(innerUsage == cachedInnerUsage);
@@ -1029,11 +1181,15 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
 void CTxMemPool::checkNullifiers() const
 {
     for (const auto& it : mapSaplingNullifiers) {
-        const uint256& hash = it.second->GetHash();
-        const auto& findTx = mapTx.find(hash);
-        assert(findTx != mapTx.end());
-        const CTransactionRef& tx = findTx->GetSharedTx();
-        assert(*tx == *it.second);
+        const auto& findTx = mapTx.find(it.second->GetTx().GetHash());
+        assert(findTx == it.second);
+    }
+    for (const auto& it : mapSaplingAnchors) {
+        assert(!it.second.empty());
+        for (txiter txit : it.second) {
+            const auto& vSpends = txit->GetTx().sapData->vShieldedSpend;
+            assert(std::any_of(vSpends.begin(), vSpends.end(), [&](const SpendDescription& sd) { return sd.anchor == it.first; }));
+        }
     }
 }
 
@@ -1193,16 +1349,16 @@ bool CTxMemPool::existsProviderTxConflict(const CTransaction &tx) const
     return false;
 }
 
-CFeeRate CTxMemPool::estimateFee(int nBlocks) const
+CFeeRate CTxMemPool::estimateFee(int nBlocks, bool fShielded) const
 {
     LOCK(cs);
-    return minerPolicyEstimator->estimateFee(nBlocks);
+    return minerPolicyEstimator->estimateFee(nBlocks, fShielded);
 }
 
-CFeeRate CTxMemPool::estimateSmartFee(int nBlocks, int *answerFoundAtBlocks) const
+CFeeRate CTxMemPool::estimateSmartFee(int nBlocks, int *answerFoundAtBlocks, bool fShielded) const
 {
     LOCK(cs);
-    return minerPolicyEstimator->estimateSmartFee(nBlocks, answerFoundAtBlocks, *this);
+    return minerPolicyEstimator->estimateSmartFee(nBlocks, answerFoundAtBlocks, *this, fShielded);
 }
 
 bool CTxMemPool::WriteFeeEstimates(CAutoFile& fileout) const
@@ -1330,7 +1486,9 @@ size_t CTxMemPool::DynamicMemoryUsage() const
             memusage::DynamicUsage(mapDeltas) +
             memusage::DynamicUsage(mapLinks) +
             cachedInnerUsage +
-            memusage::DynamicUsage(mapSaplingNullifiers);
+            memusage::DynamicUsage(mapSaplingNullifiers) +
+            memusage::DynamicUsage(mapSaplingAnchors) +
+            memusage::DynamicUsage(setTipDependent);
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason)
@@ -10,6 +10,7 @@
 #include <list>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 #include "amount.h"
 #include "coins.h"
@@ -59,6 +60,7 @@ private:
     CFeeRate feeRate;     //! ... and fee per kB
     bool hasZerocoins{false}; //! ... and checking if it contains zTRUMP (mints/spends)
     bool m_isShielded{false}; //! ... and checking if it contains shielded spends/outputs
+    bool m_hasP2CSOutputs{false}; //! ... and checking if it pays to cold staking scripts
     int64_t nTime;        //! Local time when entering the mempool
     unsigned int entryHeight; //! Chain height when entering the mempool
     bool spendsCoinbaseOrCoinstake; //! keep track of transactions that spend a coinbase or a coinstake
@@ -93,6 +95,7 @@ public:
     unsigned int GetHeight() const { return entryHeight; }
     bool HasZerocoins() const { return hasZerocoins; }
     bool IsShielded() const { return m_isShielded; }
+    bool HasP2CSOutputs() const { return m_hasP2CSOutputs; }
     unsigned int GetSigOpCount() const { return sigOpCount; }
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
@@ -397,10 +400,6 @@ private:
 
     void trackPackageRemoved(const CFeeRate& rate);
 
-    // Shielded txes
-    std::map<uint256, CTransactionRef> mapSaplingNullifiers;
-    void checkNullifiers() const;
-
     bool m_is_loaded GUARDED_BY(cs){false};
 
 public:
@@ -484,6 +483,16 @@ public:
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
+    /** Change to the ancestor or descendant state of an entry, accumulated
+     *  over a batch of updates so that the entry is modified only once. */
+    struct StateDelta {
+        int64_t nSize{0};
+        CAmount nFee{0};
+        int64_t nCount{0};
+        int nSigOps{0};
+    };
+    typedef std::map<txiter, StateDelta, CompareIteratorByHash> deltaMap;
+
     struct TxLinks {
         setEntries parents;
         setEntries children;
@@ -497,6 +506,15 @@ private:
     std::map<CKeyID, uint256> mapProTxPubKeyIDs;
     std::map<COutPoint, uint256> mapProTxCollaterals;
 
+    // Shielded txes: spent nullifier -> spending tx, and anchor -> txes spending notes from it
+    std::unordered_map<uint256, txiter, SaltedIdHasher> mapSaplingNullifiers;
+    std::unordered_map<uint256, setEntries, SaltedIdHasher> mapSaplingAnchors;
+    void checkNullifiers() const;
+
+    //! Entries that the chain tip going back can invalidate: the time-locked ones and
+    //! those spending coinbase or coinstake outputs. removeForReorg only looks at these.
+    setEntries setTipDependent;
+
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -653,12 +671,13 @@ public:
 
     /** Estimate fee rate needed to get into the next nBlocks
      *  If no answer can be given at nBlocks, return an estimate
-     *  at the lowest number of blocks where one can be given
+     *  at the lowest number of blocks where one can be given.
+     *  fShielded selects the estimates of shielded transactions.
      */
-    CFeeRate estimateSmartFee(int nBlocks, int *answerFoundAtBlocks = NULL) const;
+    CFeeRate estimateSmartFee(int nBlocks, int *answerFoundAtBlocks = NULL, bool fShielded = false) const;
 
     /** Estimate fee rate needed to get into the next nBlocks */
-    CFeeRate estimateFee(int nBlocks) const;
+    CFeeRate estimateFee(int nBlocks, bool fShielded = false) const;
 
     /** Write/Read estimates to disk */
     bool WriteFeeEstimates(CAutoFile& fileout) const;
@@ -679,10 +698,15 @@ private:
      *  cachedDescendants will be updated with the descendants of the transaction
      *  being updated, so that future invocations don't need to walk the
      *  same transaction again, if encountered in another transaction chain.
+     *
+     *  The ancestor state changes of the descendants are accumulated in
+     *  mapAncestorDeltas, to be applied by the caller once all the
+     *  transactions have been updated.
      */
     void UpdateForDescendants(txiter updateIt,
             cacheMap &cachedDescendants,
-            const std::set<uint256> &setExclude);
+            const std::set<uint256> &setExclude,
+            deltaMap &mapAncestorDeltas);
     /** Update ancestors of hash to add/remove it as a descendant transaction. */
     void UpdateAncestorsOf(bool add, txiter hash, setEntries &setAncestors);
     /** Set ancestor state for an entry */
@@ -693,6 +717,28 @@ private:
     void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants);
     /** Sever link between specified transaction and direct children. */
     void UpdateChildrenForRemoval(txiter entry);
+    /** The removed transactions among an entry and its ancestors (or its
+     *  descendants), with their summed state. A removed entry whose relatives
+     *  in that direction are all removed too is fClosed: the sum is its cached
+     *  ancestor (or descendant) state, and the set is only built on demand. */
+    struct RemovedRelatives {
+        std::shared_ptr<const setEntries> pset;
+        StateDelta sum;
+        bool fClosed{false};
+        txiter itClosed;
+    };
+    typedef std::map<txiter, RemovedRelatives, CompareIteratorByHash> removedMap;
+    /** Add to mapDeltas the state that each in-mempool descendant (fDescendants)
+     *  or ancestor of entriesToRemove, which is not removed itself, loses with
+     *  the removal. Entries with a single path to the removed ones share their
+     *  result, so a chained package costs one walk rather than one per removed
+     *  transaction. */
+    void CalculateRemovalDeltas(const setEntries& entriesToRemove, bool fDescendants, deltaMap& mapDeltas);
+    /** Build (once) and return the set of removed transactions of relatives. */
+    const setEntries& GetRemovedSet(removedMap& mapRemoved, const RemovedRelatives& relatives, bool fDescendants);
+    /** Add to setConflicts the in-mempool transactions spending an input or a
+     *  nullifier of tx (other than tx itself). */
+    void CalculateConflicts(const CTransaction& tx, setEntries& setConflicts) const;
 
     /** Before calling removeUnchecked for a given transaction,
      *  UpdateForRemoveFromMempool must be called on the entire (dependent) set
@@ -777,6 +823,9 @@ struct DisconnectedBlockTransactions {
 
     indexed_disconnected_transactions queuedTx;
     uint64_t cachedInnerUsage = 0;
+    // Heights of the disconnected blocks
+    int nLowestHeight = std::numeric_limits<int>::max();
+    int nHighestHeight = -1;
 
     // Estimate the overhead of queuedTx to be 6 pointers + an allocation, as
     // no exact formula for boost::multi_index_contained is implemented.
@@ -817,6 +866,8 @@ struct DisconnectedBlockTransactions {
     {
         cachedInnerUsage = 0;
         queuedTx.clear();
+        nLowestHeight = std::numeric_limits<int>::max();
+        nHighestHeight = -1;
     }
 };
 
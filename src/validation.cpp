@@ -11,6 +11,7 @@
 #include "validation.h"
 
 #include "addrman.h"
+#include "blockreadcache.h"
 #include "blocksignature.h"
 #include "util/blockstatecatcher.h"
 #include "budget/budgetmanager.h"
@@ -54,7 +55,9 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
 #include <atomic>
+#include <condition_variable>
 #include <queue>
+#include <thread>
 
 
 #if defined(NDEBUG)
@@ -93,6 +96,7 @@ std::atomic<bool> fImporting{false};
 std::atomic<bool> fReindex{false};
 bool fTxIndex = true;
 bool fRequireStandard = true;
+uint256 hashAssumeValid;
 bool fCheckBlockIndex = false;
 size_t nCoinCacheUsage = 5000 * 300;
 
@@ -321,6 +325,17 @@ std::string FormatStateMessage(const CValidationState &state)
         state.GetRejectCode());
 }
 
+/** Whether the same network upgrades are active at nHeightA and nHeightB (and so at every height in between). */
+static bool SameNetworkUpgrades(const Consensus::Params& consensus, int nHeightA, int nHeightB)
+{
+    for (int idx = Consensus::BASE_NETWORK + 1; idx < (int) Consensus::MAX_NETWORK_UPGRADES; idx++) {
+        if (consensus.NetworkUpgradeActive(nHeightA, (Consensus::UpgradeIndex) idx) !=
+                consensus.NetworkUpgradeActive(nHeightB, (Consensus::UpgradeIndex) idx))
+            return false;
+    }
+    return true;
+}
+
 /* Make mempool consistent after a reorg, by re-adding or recursively erasing
  * disconnected block transactions from the mempool, and also removing any
  * other transactions from the mempool that are no longer valid given the new
@@ -345,6 +360,7 @@ void UpdateMempoolForReorg(DisconnectedBlockTransactions &disconnectpool, bool f
     // Iterate disconnectpool in reverse, so that we add transactions
     // back to the mempool starting with the earliest transaction that had
     // been previously seen in a block.
+    std::vector<CTransactionRef> vtx;
     auto it = disconnectpool.queuedTx.get<insertion_order>().rbegin();
     while (it != disconnectpool.queuedTx.get<insertion_order>().rend()) {
         // if we are resurrecting a ProReg tx, we need to evict any special transaction that
@@ -352,19 +368,36 @@ void UpdateMempoolForReorg(DisconnectedBlockTransactions &disconnectpool, bool f
         if ((*it)->IsProRegTx()) {
             mempool.removeProTxReferences((*it)->GetHash(), MemPoolRemovalReason::REORG);
         }
-        // ignore validation errors in resurrected transactions
-        CValidationState stateDummy;
-        if (!fAddToMempool || (*it)->IsCoinBase() || (*it)->IsCoinStake() ||
-                !AcceptToMemoryPool(mempool, stateDummy, *it, false, nullptr, true)) {
-            // If the transaction doesn't make it in to the mempool, remove any
-            // transactions that depend on it (which would now be orphans).
+        if (!fAddToMempool || (*it)->IsCoinBase() || (*it)->IsCoinStake()) {
             mempool.removeRecursive(**it, MemPoolRemovalReason::REORG);
-        } else if (mempool.exists((*it)->GetHash())) {
-            vHashUpdate.emplace_back((*it)->GetHash());
+        } else {
+            vtx.emplace_back(*it);
         }
         ++it;
     }
-    disconnectpool.queuedTx.clear();
+
+    if (!vtx.empty()) {
+        // The transactions passed the consensus proof and script checks when their block was
+        // connected. Unless a network upgrade activates between the heights they were mined at
+        // and the next block, the same rules still apply, so only the policy is checked again.
+        const int nNextHeight = chainActive.Height() + 1;
+        const bool fConsensusVerified = SameNetworkUpgrades(Params().GetConsensus(),
+                                                          std::min(disconnectpool.nLowestHeight, nNextHeight),
+                                                          std::max(disconnectpool.nHighestHeight, nNextHeight));
+        // ignore validation errors in resurrected transactions.
+        // The mempool is trimmed below, once the descendant state is up to date.
+        std::vector<MemPoolAcceptResult> vResults = AcceptToMemoryPoolBatch(mempool, vtx, false, {}, fConsensusVerified, true);
+        for (size_t i = 0; i < vtx.size(); i++) {
+            if (!vResults[i].fAccepted) {
+                // If the transaction doesn't make it in to the mempool, remove any
+                // transactions that depend on it (which would now be orphans).
+                mempool.removeRecursive(*vtx[i], MemPoolRemovalReason::REORG);
+            } else if (mempool.exists(vtx[i]->GetHash())) {
+                vHashUpdate.emplace_back(vtx[i]->GetHash());
+            }
+        }
+    }
+    disconnectpool.clear();
     // AcceptToMemoryPool/addUnchecked all assume that new mempool entries have
     // no in-mempool children, which is generally not true when adding
     // previously-confirmed transactions back to the mempool.
@@ -391,35 +424,60 @@ static bool IsCurrentForFeeEstimation()
     return true;
 }
 
-bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const CTransactionRef& _tx, bool fLimitFree,
-                              bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool ignoreFees,
-                              std::vector<COutPoint>& coins_to_uncache)
+namespace {
+
+/**
+ * Inputs of a transaction being accepted to the mempool, and the chain and mempool state they
+ * were read against. Filled under cs_main by AcceptToMemoryPoolPreChecks, then used without
+ * locks by CheckTxProofsAndScripts.
+ */
+struct MemPoolAcceptWorkspace
 {
-    AssertLockHeld(cs_main);
-    const CTransaction& tx = *_tx;
-    if (pfMissingInputs)
-        *pfMissingInputs = false;
+    CCoinsView dummy;
+    CCoinsViewCache view{&dummy};
+    const CBlockIndex* pindexTip{nullptr};
+    unsigned int nMempoolUpdated{0};
+    int nextBlockHeight{0};
+    int nSpendHeight{0};
+    bool fIBD{false};
+    unsigned int nStandardFlags{0};
+    unsigned int nMandatoryFlags{0};
+    unsigned int nSigOps{0};
+    std::unique_ptr<CTxMemPoolEntry> entry;
+    CTxMemPool::setEntries setAncestors;
+};
+
+} // anon namespace
+
+/** In-mempool ancestors of ws.entry, within the ancestor and descendant limits. */
+static bool CalculateWorkspaceAncestors(CTxMemPool& pool, CValidationState& state, MemPoolAcceptWorkspace& ws)
+{
+    AssertLockHeld(pool.cs);
+    ws.setAncestors.clear();
+    size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
+    size_t nLimitAncestorSize = gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
+    size_t nLimitDescendants = gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
+    size_t nLimitDescendantSize = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
+    std::string errString;
+    if (!pool.CalculateMemPoolAncestors(*ws.entry, ws.setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
+        return state.DoS(0, error("AcceptToMemoryPool : %s", errString), REJECT_NONSTANDARD, "too-long-mempool-chain", false);
+    }
+    return true;
+}
 
+/** Checks that need neither the chain nor the mempool. */
+static bool AcceptToMemoryPoolContextFreeChecks(const CTransaction& tx, CValidationState& state)
+{
     // Check maintenance mode
     if (sporkManager.IsSporkActive(SPORK_20_SAPLING_MAINTENANCE) && tx.IsShieldedTx())
         return state.DoS(10, error("%s : Shielded transactions are temporarily disabled for maintenance",
                 __func__), REJECT_INVALID, "bad-tx-sapling-maintenance");
 
-    const CChainParams& params = Params();
-    const Consensus::Params& consensus = params.GetConsensus();
-    int chainHeight = chainActive.Height();
-
     // Check transaction
     bool fColdStakingActive = !sporkManager.IsSporkActive(SPORK_19_COLDSTAKING_MAINTENANCE);
     if (!CheckTransaction(tx, state, fColdStakingActive))
         return error("%s : transaction checks for %s failed with %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
 
-    int nextBlockHeight = chainHeight + 1;
-    // Check transaction contextually against consensus rules at block height
-    if (!ContextualCheckTransaction(_tx, state, params, nextBlockHeight, false /* isMined */, IsInitialBlockDownload())) {
-        return error("AcceptToMemoryPool: ContextualCheckTransaction failed");
-    }
-
     // Coinbase is only valid in a block, not as a loose transaction
     if (tx.IsCoinBase())
         return state.DoS(100, false, REJECT_INVALID, "coinbase");
@@ -428,6 +486,25 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
     if (tx.IsCoinStake())
         return state.DoS(100, false, REJECT_INVALID, "coinstake");
 
+    return true;
+}
+
+/** Policy, conflicts, inputs, fees and mempool limits. Cheap, requires cs_main. */
+static bool AcceptToMemoryPoolPreChecks(CTxMemPool& pool, CValidationState& state, const CTransactionRef& _tx, bool fLimitFree,
+                                        bool* pfMissingInputs, int64_t nAcceptTime, bool fRejectAbsurdFee, bool ignoreFees,
+                                        std::vector<COutPoint>& coins_to_uncache, MemPoolAcceptWorkspace& ws)
+{
+    AssertLockHeld(cs_main);
+    const CTransaction& tx = *_tx;
+    const Consensus::Params& consensus = Params().GetConsensus();
+    int chainHeight = chainActive.Height();
+    int nextBlockHeight = chainHeight + 1;
+
+    ws.pindexTip = chainActive.Tip();
+    ws.nMempoolUpdated = pool.GetTransactionsUpdated();
+    ws.nextBlockHeight = nextBlockHeight;
+    ws.fIBD = IsInitialBlockDownload();
+
     if (pool.existsProviderTxConflict(tx)) {
         return state.DoS(0, false, REJECT_DUPLICATE, "protx-dup");
     }
@@ -469,165 +546,308 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
         }
     }
 
-    {
-        CCoinsView dummy;
-        CCoinsViewCache view(&dummy);
-
-        CAmount nValueIn = 0;
+    CCoinsViewCache& view = ws.view;
+    CAmount nValueIn = 0;
 
-        LOCK(pool.cs);
-        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
-        view.SetBackend(viewMemPool);
-
-        // do we already have it?
-        for (size_t out = 0; out < tx.vout.size(); out++) {
-            COutPoint outpoint(hash, out);
-            bool had_coin_in_cache = pcoinsTip->HaveCoinInCache(outpoint);
-            if (view.HaveCoin(outpoint)) {
-                if (!had_coin_in_cache) {
-                    coins_to_uncache.push_back(outpoint);
-                }
-                return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-known");
+    LOCK(pool.cs);
+    CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
+    view.SetBackend(viewMemPool);
+
+    // do we already have it?
+    for (size_t out = 0; out < tx.vout.size(); out++) {
+        COutPoint outpoint(hash, out);
+        bool had_coin_in_cache = pcoinsTip->HaveCoinInCache(outpoint);
+        if (view.HaveCoin(outpoint)) {
+            if (!had_coin_in_cache) {
+                coins_to_uncache.push_back(outpoint);
             }
+            view.SetBackend(ws.dummy);
+            return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-known");
         }
+    }
 
-        // do all inputs exist?
-        for (const CTxIn& txin : tx.vin) {
-            if (!pcoinsTip->HaveCoinInCache(txin.prevout)) {
-                coins_to_uncache.push_back(txin.prevout);
-            }
-            if (!view.HaveCoin(txin.prevout)) {
-                if (pfMissingInputs) {
-                    *pfMissingInputs = true;
-                }
-                return false; // fMissingInputs and !state.IsInvalid() is used to detect this condition, don't set state.Invalid()
-            }
+    // do all inputs exist?
+    for (const CTxIn& txin : tx.vin) {
+        if (!pcoinsTip->HaveCoinInCache(txin.prevout)) {
+            coins_to_uncache.push_back(txin.prevout);
         }
-
-        // Sapling: are the sapling spends' requirements met in tx(valid anchors/nullifiers)?
-        if (!view.HaveShieldedRequirements(tx))
-            return state.Invalid(error("AcceptToMemoryPool: shielded requirements not met"),
-                                 REJECT_DUPLICATE, "bad-txns-shielded-requirements-not-met");
-
-        // Bring the best block into scope
-        view.GetBestBlock();
-
-        nValueIn = view.GetValueIn(tx);
-
-        // we have all inputs cached now, so switch back to dummy, so we don't need to keep lock on mempool
-        view.SetBackend(dummy);
-
-        // Check for non-standard pay-to-script-hash in inputs
-        if (fRequireStandard && !AreInputsStandard(tx, view))
-            return state.Invalid(false, REJECT_NONSTANDARD, "bad-txns-nonstandard-inputs");
-
-        // Check that the transaction doesn't have an excessive number of
-        // sigops, making it impossible to mine. Since the coinbase transaction
-        // itself can contain sigops MAX_TX_SIGOPS is less than
-        // MAX_BLOCK_SIGOPS; we still consider this an invalid rather than
-        // merely non-standard transaction.
-        unsigned int nSigOps = GetLegacySigOpCount(tx);
-        unsigned int nMaxSigOps = MAX_TX_SIGOPS_CURRENT;
-        nSigOps += GetP2SHSigOpCount(tx, view);
-        if(nSigOps > nMaxSigOps)
-            return state.DoS(0, false, REJECT_NONSTANDARD, "bad-txns-too-many-sigops", false,
-                strprintf("%d > %d", nSigOps, nMaxSigOps));
-
-        CAmount nValueOut = tx.GetValueOut();
-        CAmount nFees = nValueIn - nValueOut;
-        bool fSpendsCoinbaseOrCoinstake = false;
-
-        // Keep track of transactions that spend a coinbase, which we re-scan
-        // during reorgs to ensure COINBASE_MATURITY is still met.
-        for (const CTxIn &txin : tx.vin) {
-            const Coin &coin = view.AccessCoin(txin.prevout);
-            if (coin.IsCoinBase() || coin.IsCoinStake()) {
-                fSpendsCoinbaseOrCoinstake = true;
-                break;
+        if (!view.HaveCoin(txin.prevout)) {
+            if (pfMissingInputs) {
+                *pfMissingInputs = true;
             }
+            view.SetBackend(ws.dummy);
+            return false; // fMissingInputs and !state.IsInvalid() is used to detect this condition, don't set state.Invalid()
         }
+    }
 
-        CTxMemPoolEntry entry(_tx, nFees, nAcceptTime, chainHeight,
-                              fSpendsCoinbaseOrCoinstake, nSigOps);
-        unsigned int nSize = entry.GetTxSize();
+    // Sapling: are the sapling spends' requirements met in tx(valid anchors/nullifiers)?
+    if (!view.HaveShieldedRequirements(tx)) {
+        view.SetBackend(ws.dummy);
+        return state.Invalid(error("AcceptToMemoryPool: shielded requirements not met"),
+                             REJECT_DUPLICATE, "bad-txns-shielded-requirements-not-met");
+    }
 
-        // Don't accept it if it can't get into a block
-        if (!ignoreFees) {
-            const CAmount txMinFee = GetMinRelayFee(tx, pool, nSize);
-            if (fLimitFree && nFees < txMinFee) {
-                return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "insufficient fee", false,
-                    strprintf("%d < %d", nFees, txMinFee));
-            }
+    // Bring the best block into scope
+    view.GetBestBlock();
 
-            // No transactions are allowed below minRelayTxFee except from disconnected blocks
-            if (fLimitFree && nFees < ::minRelayTxFee.GetFee(nSize)) {
-                return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "min relay fee not met");
-            }
+    nValueIn = view.GetValueIn(tx);
+    ws.nSpendHeight = GetSpendHeight(view);
+
+    // we have all inputs cached now, so switch back to dummy, so we don't need to keep lock on mempool
+    view.SetBackend(ws.dummy);
+
+    // The standardness of the inputs and the sigop count are checked without
+    // locks, by CheckTxInputsPolicy.
+
+    CAmount nValueOut = tx.GetValueOut();
+    CAmount nFees = nValueIn - nValueOut;
+    bool fSpendsCoinbaseOrCoinstake = false;
+
+    // Keep track of transactions that spend a coinbase, which we re-scan
+    // during reorgs to ensure COINBASE_MATURITY is still met.
+    for (const CTxIn &txin : tx.vin) {
+        const Coin &coin = view.AccessCoin(txin.prevout);
+        if (coin.IsCoinBase() || coin.IsCoinStake()) {
+            fSpendsCoinbaseOrCoinstake = true;
+            break;
         }
+    }
 
-        if (fRejectAbsurdFee) {
-            const CAmount nMaxFee = tx.IsShieldedTx() ? GetShieldedTxMinFee(tx) * 100 :
-                                                        GetMinRelayFee(nSize) * 10000;
-            if (nFees > nMaxFee)
-                return state.Invalid(false, REJECT_HIGHFEE, "absurdly-high-fee",
-                                     strprintf("%d > %d", nFees, nMaxFee));
+    ws.entry.reset(new CTxMemPoolEntry(_tx, nFees, nAcceptTime, chainHeight,
+                                       fSpendsCoinbaseOrCoinstake, 0));
+    unsigned int nSize = ws.entry->GetTxSize();
+
+    // Don't accept it if it can't get into a block
+    if (!ignoreFees) {
+        const CAmount txMinFee = GetMinRelayFee(tx, pool, nSize);
+        if (fLimitFree && nFees < txMinFee) {
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "insufficient fee", false,
+                strprintf("%d < %d", nFees, txMinFee));
         }
 
-        // Calculate in-mempool ancestors, up to a limit.
-        CTxMemPool::setEntries setAncestors;
-        size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
-        size_t nLimitAncestorSize = gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
-        size_t nLimitDescendants = gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
-        size_t nLimitDescendantSize = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
-        std::string errString;
-        if (!pool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
-            return state.DoS(0, error("%s : %s", __func__, errString), REJECT_NONSTANDARD, "too-long-mempool-chain", false);
+        // No transactions are allowed below minRelayTxFee except from disconnected blocks
+        if (fLimitFree && nFees < ::minRelayTxFee.GetFee(nSize)) {
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "min relay fee not met");
         }
+    }
 
-        if (!CheckSpecialTx(tx, chainActive.Tip(), state)) {
-            // pass the state returned by the function above
+    if (fRejectAbsurdFee) {
+        const CAmount nMaxFee = tx.IsShieldedTx() ? GetShieldedTxMinFee(tx) * 100 :
+                                                    GetMinRelayFee(nSize) * 10000;
+        if (nFees > nMaxFee)
+            return state.Invalid(false, REJECT_HIGHFEE, "absurdly-high-fee",
+                                 strprintf("%d > %d", nFees, nMaxFee));
+    }
+
+    // Calculate in-mempool ancestors, up to a limit.
+    if (!CalculateWorkspaceAncestors(pool, state, ws)) {
+        return false;
+    }
+
+    if (!CheckSpecialTx(tx, chainActive.Tip(), state)) {
+        // pass the state returned by the function above
+        return false;
+    }
+
+    bool fCLTVIsActivated = consensus.NetworkUpgradeActive(chainHeight, Consensus::UPGRADE_BIP65);
+    ws.nStandardFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    ws.nMandatoryFlags = MANDATORY_SCRIPT_VERIFY_FLAGS;
+    if (fCLTVIsActivated) {
+        ws.nStandardFlags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
+        ws.nMandatoryFlags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
+    }
+
+    return true;
+}
+
+/** Record the sigop count of the transaction in ws and in its mempool entry. */
+static void SetWorkspaceSigOps(MemPoolAcceptWorkspace& ws, unsigned int nSigOps)
+{
+    const CTxMemPoolEntry& e = *ws.entry;
+    ws.nSigOps = nSigOps;
+    ws.entry.reset(new CTxMemPoolEntry(e.GetSharedTx(), e.GetFee(), e.GetTime(), e.GetHeight(),
+                                       e.GetSpendsCoinbaseOrCoinstake(), nSigOps));
+}
+
+/**
+ * Standardness of the spent scripts and sigop count, against the coins read by the prechecks.
+ * Takes no lock. The result only depends on the transaction and the coins it spends.
+ */
+static bool CheckTxInputsPolicy(const CTransactionRef& _tx, CValidationState& state, MemPoolAcceptWorkspace& ws)
+{
+    const CTransaction& tx = *_tx;
+
+    // Check for non-standard pay-to-script-hash in inputs
+    if (fRequireStandard && !AreInputsStandard(tx, ws.view))
+        return state.Invalid(false, REJECT_NONSTANDARD, "bad-txns-nonstandard-inputs");
+
+    // Check that the transaction doesn't have an excessive number of
+    // sigops, making it impossible to mine. Since the coinbase transaction
+    // itself can contain sigops MAX_TX_SIGOPS is less than
+    // MAX_BLOCK_SIGOPS; we still consider this an invalid rather than
+    // merely non-standard transaction.
+    unsigned int nSigOps = GetLegacySigOpCount(tx);
+    unsigned int nMaxSigOps = MAX_TX_SIGOPS_CURRENT;
+    nSigOps += GetP2SHSigOpCount(tx, ws.view);
+    if(nSigOps > nMaxSigOps)
+        return state.DoS(0, false, REJECT_NONSTANDARD, "bad-txns-too-many-sigops", false,
+            strprintf("%d > %d", nSigOps, nMaxSigOps));
+
+    SetWorkspaceSigOps(ws, nSigOps);
+    return true;
+}
+
+/** Sapling proofs and signatures, and input scripts, against the coins read by the prechecks. Takes no lock. */
+static bool CheckTxProofsAndScripts(const CTransactionRef& _tx, CValidationState& state, const MemPoolAcceptWorkspace& ws,
+                                    bool fConsensusVerified = false)
+{
+    const CTransaction& tx = *_tx;
+
+    // Check transaction contextually against consensus rules at block height
+    if (!fConsensusVerified && !ContextualCheckTransaction(_tx, state, Params(), ws.nextBlockHeight, false /* isMined */, ws.fIBD)) {
+        return error("AcceptToMemoryPool: ContextualCheckTransaction failed");
+    }
+
+    // Check against previous transactions
+    // This is done last to help prevent CPU exhaustion denial-of-service attacks.
+    PrecomputedTransactionData precomTxData(tx);
+    if (!CheckInputs(tx, state, ws.view, ws.nSpendHeight, true, ws.nStandardFlags, true, precomTxData)) {
+        return false;
+    }
+    if (fConsensusVerified) {
+        // Known to pass the consensus rules, only the policy was checked
+        return true;
+    }
+
+    // Check again against just the consensus-critical mandatory script
+    // verification flags, in case of bugs in the standard flags that cause
+    // transactions to pass as valid when they're actually invalid. For
+    // instance the STRICTENC flag was incorrectly allowing certain
+    // CHECKSIG NOT scripts to pass, even though they were invalid.
+    //
+    // There is a similar check in CreateNewBlock() to prevent creating
+    // invalid blocks, however allowing such transactions into the mempool
+    // can be exploited as a DoS attack.
+    if (!CheckInputs(tx, state, ws.view, ws.nSpendHeight, true, ws.nMandatoryFlags, true, precomTxData)) {
+        return error("%s: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s, %s",
+                __func__, tx.GetHash().ToString(), FormatStateMessage(state));
+    }
+
+    return true;
+}
+
+/** Whether ws and wsNew read the same coins for the inputs of tx (and so CheckTxInputsPolicy agrees). */
+static bool SameSpentCoins(const CTransaction& tx, const MemPoolAcceptWorkspace& ws, const MemPoolAcceptWorkspace& wsNew)
+{
+    for (const CTxIn& txin : tx.vin) {
+        const Coin& coin = ws.view.AccessCoin(txin.prevout);
+        const Coin& coinNew = wsNew.view.AccessCoin(txin.prevout);
+        if (coin.out != coinNew.out || coin.nHeight != coinNew.nHeight ||
+                coin.fCoinBase != coinNew.fCoinBase || coin.fCoinStake != coinNew.fCoinStake)
+            return false;
+    }
+    return true;
+}
+
+/** Whether the proof and script checks done against ws still hold for wsNew. */
+static bool SameScriptContext(const CTransaction& tx, const MemPoolAcceptWorkspace& ws, const MemPoolAcceptWorkspace& wsNew)
+{
+    return ws.nextBlockHeight == wsNew.nextBlockHeight && ws.nSpendHeight == wsNew.nSpendHeight &&
+           ws.nStandardFlags == wsNew.nStandardFlags && ws.nMandatoryFlags == wsNew.nMandatoryFlags &&
+           SameSpentCoins(tx, ws, wsNew);
+}
+
+/**
+ * Under cs_main, make sure the checks done against ws still apply and add the transaction to the
+ * pool, without trimming it. nOwnUpdates is the number of transactions the caller added to the
+ * pool since ws was filled, none of them spent by this one.
+ */
+static bool AcceptToMemoryPoolFinalize(CTxMemPool& pool, CValidationState& state, const CTransactionRef& _tx, bool fLimitFree,
+                                       bool* pfMissingInputs, int64_t nAcceptTime, bool fRejectAbsurdFee, bool ignoreFees,
+                                       std::vector<COutPoint>& coins_to_uncache, MemPoolAcceptWorkspace& ws, unsigned int nOwnUpdates)
+{
+    AssertLockHeld(cs_main);
+    const CTransaction& tx = *_tx;
+    std::unique_ptr<MemPoolAcceptWorkspace> wsNew;
+    if (chainActive.Tip() != ws.pindexTip || pool.GetTransactionsUpdated() != ws.nMempoolUpdated + nOwnUpdates) {
+        // The chain or the mempool changed in the meantime: repeat the prechecks (inputs,
+        // anchors, nullifiers, conflicts, ancestors). Proofs and scripts only need to be
+        // checked again if the spent coins or the script flags changed.
+        wsNew.reset(new MemPoolAcceptWorkspace());
+        if (!AcceptToMemoryPoolPreChecks(pool, state, _tx, fLimitFree, pfMissingInputs, nAcceptTime, fRejectAbsurdFee, ignoreFees, coins_to_uncache, *wsNew))
+            return false;
+        if (SameSpentCoins(tx, ws, *wsNew)) {
+            SetWorkspaceSigOps(*wsNew, ws.nSigOps);
+        } else if (!CheckTxInputsPolicy(_tx, state, *wsNew)) {
             return false;
         }
+        if (!SameScriptContext(tx, ws, *wsNew) && !CheckTxProofsAndScripts(_tx, state, *wsNew))
+            return false;
+    } else if (nOwnUpdates > 0) {
+        // Only siblings were added: the inputs are still there, unless a sibling spent them too.
+        LOCK(pool.cs);
+        if (pool.existsProviderTxConflict(tx))
+            return state.DoS(0, false, REJECT_DUPLICATE, "protx-dup");
+        for (const CTxIn& txin : tx.vin) {
+            if (pool.mapNextTx.count(txin.prevout))
+                return state.Invalid(false, REJECT_CONFLICT, "txn-mempool-conflict");
+        }
+        if (tx.IsShieldedTx()) {
+            for (const auto& sd : tx.sapData->vShieldedSpend) {
+                if (pool.nullifierExists(sd.nullifier))
+                    return state.Invalid(false, REJECT_INVALID, "bad-txns-nullifier-double-spent");
+            }
+        }
+        if (!CalculateWorkspaceAncestors(pool, state, ws))
+            return false;
+    }
+    MemPoolAcceptWorkspace& wsFinal = wsNew ? *wsNew : ws;
+
+    LOCK(pool.cs);
+    // todo: pool.removeStaged for all conflicting entries
+
+    // This transaction should only count for fee estimation if
+    // the node is not behind and it is not dependent on any other
+    // transactions in the mempool
+    bool validForFeeEstimation = IsCurrentForFeeEstimation() && pool.HasNoInputsOf(tx);
+
+    // Store transaction in memory
+    pool.addUnchecked(tx.GetHash(), *wsFinal.entry, wsFinal.setAncestors, validForFeeEstimation);
+    return true;
+}
 
-        bool fCLTVIsActivated = consensus.NetworkUpgradeActive(chainHeight, Consensus::UPGRADE_BIP65);
+bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const CTransactionRef& _tx, bool fLimitFree,
+                              bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool ignoreFees,
+                              std::vector<COutPoint>& coins_to_uncache)
+{
+    AssertLockNotHeld(pool.cs);
+    const CTransaction& tx = *_tx;
+    if (pfMissingInputs)
+        *pfMissingInputs = false;
 
-        // Check against previous transactions
-        // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
-        if (fCLTVIsActivated)
-            flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
+    if (!AcceptToMemoryPoolContextFreeChecks(tx, state))
+        return false;
 
-        PrecomputedTransactionData precomTxData(tx);
-        if (!CheckInputs(tx, state, view, true, flags, true, precomTxData)) {
+    // Phase 1: read the inputs and apply the policy checks against the current tip and mempool.
+    MemPoolAcceptWorkspace ws;
+    {
+        LOCK(cs_main);
+        if (!AcceptToMemoryPoolPreChecks(pool, state, _tx, fLimitFree, pfMissingInputs, nAcceptTime, fRejectAbsurdFee, ignoreFees, coins_to_uncache, ws))
             return false;
-        }
+    }
+
+    // Phase 2: the expensive checks. cs_main is only released if the caller doesn't hold it.
+    if (!CheckTxInputsPolicy(_tx, state, ws) || !CheckTxProofsAndScripts(_tx, state, ws))
+        return false;
 
-        // Check again against just the consensus-critical mandatory script
-        // verification flags, in case of bugs in the standard flags that cause
-        // transactions to pass as valid when they're actually invalid. For
-        // instance the STRICTENC flag was incorrectly allowing certain
-        // CHECKSIG NOT scripts to pass, even though they were invalid.
-        //
-        // There is a similar check in CreateNewBlock() to prevent creating
-        // invalid blocks, however allowing such transactions into the mempool
-        // can be exploited as a DoS attack.
-        flags = MANDATORY_SCRIPT_VERIFY_FLAGS;
-        if (fCLTVIsActivated)
-            flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
-        if (!CheckInputs(tx, state, view, true, flags, true, precomTxData)) {
-            return error("%s: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s, %s",
-                    __func__, hash.ToString(), FormatStateMessage(state));
-        }
-        // todo: pool.removeStaged for all conflicting entries
-
-        // This transaction should only count for fee estimation if
-        // the node is not behind and it is not dependent on any other
-        // transactions in the mempool
-        bool validForFeeEstimation = IsCurrentForFeeEstimation() && pool.HasNoInputsOf(tx);
-
-        // Store transaction in memory
-        pool.addUnchecked(hash, entry, setAncestors, validForFeeEstimation);
+    // Phase 3: make sure the result still applies to the current state, and add the transaction.
+    {
+        LOCK(cs_main);
+        if (!AcceptToMemoryPoolFinalize(pool, state, _tx, fLimitFree, pfMissingInputs, nAcceptTime, fRejectAbsurdFee, ignoreFees, coins_to_uncache, ws, 0))
+            return false;
 
+        LOCK(pool.cs);
+        const uint256& hash = tx.GetHash();
         // trim mempool and check if tx was trimmed
         if (!fOverrideMempoolLimit) {
             LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
@@ -636,7 +856,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
         }
 
         pool.TrimToSize(gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000);
-        if (!pool.exists(tx.GetHash()))
+        if (!pool.exists(hash))
             return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
     }
 
@@ -651,6 +871,7 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
     std::vector<COutPoint> coins_to_uncache;
     bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, fOverrideMempoolLimit, fRejectAbsurdFee, fIgnoreFees, coins_to_uncache);
     if (!res) {
+        LOCK(cs_main);
         for (const COutPoint& outpoint: coins_to_uncache)
             pcoinsTip->Uncache(outpoint);
     }
@@ -667,6 +888,168 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
     return AcceptToMemoryPoolWithTime(pool, state, tx, fLimitFree, pfMissingInputs, GetTime(), fOverrideMempoolLimit, fRejectInsaneFee, ignoreFees);
 }
 
+/** Runs fn(i) for ParallelForEach on the parallel task threads. */
+class CParallelTask
+{
+private:
+    const std::function<void(size_t)>* fn;
+    size_t i;
+
+public:
+    CParallelTask() : fn(nullptr), i(0) {}
+    CParallelTask(const std::function<void(size_t)>& fnIn, size_t iIn) : fn(&fnIn), i(iIn) {}
+
+    bool operator()()
+    {
+        (*fn)(i);
+        return true;
+    }
+
+    void swap(CParallelTask& task)
+    {
+        std::swap(fn, task.fn);
+        std::swap(i, task.i);
+    }
+};
+
+static CCheckQueue<CParallelTask> paralleltaskqueue(16);
+//! CCheckQueueControl requires an idle queue: one ParallelForEach at a time
+static Mutex cs_paralleltaskqueue;
+
+void ThreadParallelTask()
+{
+    util::ThreadRename("trumpcoin-partask");
+    paralleltaskqueue.Thread();
+}
+
+void ParallelForEach(size_t n, const std::function<void(size_t)>& fn)
+{
+    if (nScriptCheckThreads == 0 || n < 2) {
+        for (size_t i = 0; i < n; i++)
+            fn(i);
+        return;
+    }
+    std::vector<CParallelTask> vTasks;
+    vTasks.reserve(n);
+    for (size_t i = 0; i < n; i++)
+        vTasks.emplace_back(fn, i);
+
+    LOCK(cs_paralleltaskqueue);
+    CCheckQueueControl<CParallelTask> control(&paralleltaskqueue);
+    control.Add(vTasks);
+    control.Wait();
+}
+
+std::vector<MemPoolAcceptResult> AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& vtx, bool fLimitFree,
+                                                         const std::vector<int64_t>& vAcceptTime, bool fConsensusVerified,
+                                                         bool fOverrideMempoolLimit)
+{
+    assert(vAcceptTime.empty() || vAcceptTime.size() == vtx.size());
+    const size_t nTxs = vtx.size();
+    const int64_t nNow = GetTime();
+    auto acceptTime = [&](size_t i) { return vAcceptTime.empty() ? nNow : vAcceptTime[i]; };
+    std::vector<MemPoolAcceptResult> vResults(nTxs);
+    std::vector<std::vector<COutPoint>> vCoinsToUncache(nTxs);
+
+    // Schedule the batch in rounds: a transaction goes in the round after the last of its
+    // parents in the batch, so that they are in the pool when its inputs are looked up.
+    std::map<uint256, size_t> mapBatchIndex;
+    for (size_t i = 0; i < nTxs; i++)
+        mapBatchIndex.emplace(vtx[i]->GetHash(), i);
+    std::vector<std::vector<size_t>> vChildren(nTxs);
+    std::vector<size_t> vParentsLeft(nTxs, 0);
+    std::vector<size_t> vRound;
+    for (size_t i = 0; i < nTxs; i++) {
+        std::set<size_t> setParents;
+        for (const CTxIn& txin : vtx[i]->vin) {
+            auto it = mapBatchIndex.find(txin.prevout.hash);
+            if (it != mapBatchIndex.end() && it->second != i)
+                setParents.insert(it->second);
+        }
+        for (size_t parent : setParents)
+            vChildren[parent].push_back(i);
+        vParentsLeft[i] = setParents.size();
+        if (setParents.empty())
+            vRound.push_back(i);
+    }
+
+    std::vector<std::unique_ptr<MemPoolAcceptWorkspace>> vWorkspaces(nTxs);
+    while (!vRound.empty()) {
+        // Context-free checks and prechecks, under a single cs_main acquisition
+        std::vector<size_t> vChecked;
+        {
+            LOCK(cs_main);
+            for (size_t i : vRound) {
+                MemPoolAcceptResult& result = vResults[i];
+                if (!AcceptToMemoryPoolContextFreeChecks(*vtx[i], result.state))
+                    continue;
+                vWorkspaces[i].reset(new MemPoolAcceptWorkspace());
+                if (AcceptToMemoryPoolPreChecks(pool, result.state, vtx[i], fLimitFree, &result.fMissingInputs, acceptTime(i),
+                                                false, false, vCoinsToUncache[i], *vWorkspaces[i]))
+                    vChecked.push_back(i);
+            }
+        }
+
+        // Input policy, proofs and scripts, spread over the script check threads
+        std::vector<char> vValid(vChecked.size(), 0);
+        ParallelForEach(vChecked.size(), [&](size_t k) {
+            const size_t i = vChecked[k];
+            vValid[k] = CheckTxInputsPolicy(vtx[i], vResults[i].state, *vWorkspaces[i]) &&
+                        CheckTxProofsAndScripts(vtx[i], vResults[i].state, *vWorkspaces[i], fConsensusVerified);
+        });
+
+        // Add the round, again under a single cs_main acquisition
+        {
+            LOCK(cs_main);
+            unsigned int nOwnUpdates = 0;
+            for (size_t k = 0; k < vChecked.size(); k++) {
+                const size_t i = vChecked[k];
+                MemPoolAcceptResult& result = vResults[i];
+                if (vValid[k] && AcceptToMemoryPoolFinalize(pool, result.state, vtx[i], fLimitFree, &result.fMissingInputs, acceptTime(i),
+                                                            false, false, vCoinsToUncache[i], *vWorkspaces[i], nOwnUpdates)) {
+                    result.fAccepted = true;
+                    nOwnUpdates++;
+                }
+                vWorkspaces[i].reset();
+            }
+        }
+
+        std::vector<size_t> vNextRound;
+        for (size_t i : vRound) {
+            for (size_t child : vChildren[i]) {
+                if (--vParentsLeft[child] == 0)
+                    vNextRound.push_back(child);
+            }
+        }
+        vRound = std::move(vNextRound);
+    }
+
+    // Expire and trim once for the whole batch
+    {
+        LOCK2(cs_main, pool.cs);
+        if (!fOverrideMempoolLimit)
+            LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+        for (size_t i = 0; i < nTxs; i++) {
+            MemPoolAcceptResult& result = vResults[i];
+            if (result.fAccepted && !pool.exists(vtx[i]->GetHash())) {
+                result.fAccepted = false;
+                result.state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
+            }
+            if (!result.fAccepted) {
+                for (const COutPoint& outpoint : vCoinsToUncache[i])
+                    pcoinsTip->Uncache(outpoint);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < nTxs; i++) {
+        if (vResults[i].fAccepted)
+            GetMainSignals().TransactionAddedToMempool(vtx[i]);
+    }
+
+    return vResults;
+}
+
 bool GetOutput(const uint256& hash, unsigned int index, CValidationState& state, CTxOut& out)
 {
     CTransactionRef txPrev;
@@ -769,20 +1152,60 @@ bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos)
     return true;
 }
 
+/**
+ * Copy the record stored at pos (plus nTrailing bytes after it) out of the memory-mapped file,
+ * using the size from the record header. Only finalized files are mapped: returns false
+ * if the file is still being written, can't be mapped, or the record lies outside the mapping.
+ */
+static bool ReadMappedRecord(const FlatFileSeq& seq, const FlatFilePos& pos, bool fUndo, size_t nTrailing, CDataStream& ss)
+{
+    if (pos.IsNull() || pos.nPos < MESSAGE_START_SIZE + sizeof(uint32_t) ||
+            WITH_LOCK(cs_LastBlockFile, return pos.nFile >= nLastBlockFile; )) {
+        return false;
+    }
+    std::shared_ptr<const FlatFileMapping> mapping = g_blockreadcache.GetMapping(seq, pos, fUndo);
+    if (!mapping || pos.nPos > mapping->size()) {
+        return false;
+    }
+    const unsigned char* pheader = mapping->data() + pos.nPos - MESSAGE_START_SIZE - sizeof(uint32_t);
+    if (memcmp(pheader, Params().MessageStart(), MESSAGE_START_SIZE) != 0) {
+        return false;
+    }
+    const uint64_t nSize = ReadLE32(pheader + MESSAGE_START_SIZE);
+    if (pos.nPos + nSize + nTrailing > mapping->size()) {
+        return false;
+    }
+    const char* pbegin = (const char*)mapping->data() + pos.nPos;
+    ss.write(pbegin, nSize + nTrailing);
+    return true;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk : OpenBlockFile failed");
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    if (ReadMappedRecord(BlockFileSeq(), pos, false, 0, ss)) {
+        g_blockreadcache.CountRead(true);
+        try {
+            ss >> block;
+        } catch (const std::exception& e) {
+            return error("%s : Deserialize error - %s", __func__, e.what());
+        }
+    } else {
+        g_blockreadcache.CountRead(false);
 
-    // Read block
-    try {
-        filein >> block;
-    } catch (const std::exception& e) {
-        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk : OpenBlockFile failed");
+
+        // Read block
+        try {
+            filein >> block;
+        } catch (const std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
     }
 
     // Check the header
@@ -796,14 +1219,22 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos)
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
 {
+    const uint256& hashBlock = pindex->GetBlockHash();
+    std::shared_ptr<const CBlock> pblockCached = g_blockreadcache.GetBlock(hashBlock);
+    if (pblockCached) {
+        block = *pblockCached;
+        return true;
+    }
+
     FlatFilePos blockPos = WITH_LOCK(cs_main, return pindex->GetBlockPos(); );
     if (!ReadBlockFromDisk(block, blockPos)) {
         return false;
     }
-    if (block.GetHash() != pindex->GetBlockHash()) {
-        LogPrintf("%s : block=%s index=%s\n", __func__, block.GetHash().GetHex(), pindex->GetBlockHash().GetHex());
+    if (block.GetHash() != hashBlock) {
+        LogPrintf("%s : block=%s index=%s\n", __func__, block.GetHash().GetHex(), hashBlock.GetHex());
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*) : GetHash() doesn't match index");
     }
+    g_blockreadcache.AddBlock(hashBlock, std::make_shared<const CBlock>(block));
     return true;
 }
 
@@ -1146,10 +1577,16 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoins
 }// namespace Consensus
 
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck> *pvChecks)
+{
+    const int nSpendHeight = (tx.IsCoinBase() || tx.HasZerocoinSpendInputs()) ? 0 : GetSpendHeight(inputs);
+    return CheckInputs(tx, state, inputs, nSpendHeight, fScriptChecks, flags, cacheStore, precomTxData, pvChecks);
+}
+
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, int nSpendHeight, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck> *pvChecks)
 {
     if (!tx.IsCoinBase() && !tx.HasZerocoinSpendInputs()) {
 
-        if (!Consensus::CheckTxInputs(tx, state, inputs, GetSpendHeight(inputs)))
+        if (!Consensus::CheckTxInputs(tx, state, inputs, nSpendHeight))
             return false;
 
         if (pvChecks)
@@ -1257,6 +1694,25 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint25
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const FlatFilePos& pos, const uint256& hashBlock)
 {
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    if (ReadMappedRecord(UndoFileSeq(), pos, true, sizeof(uint256), ss)) {
+        g_blockreadcache.CountRead(true);
+        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+        hasher << hashBlock;
+        hasher.write(ss.data(), ss.size() - sizeof(uint256));
+        uint256 hashChecksum;
+        try {
+            ss >> blockundo;
+            ss >> hashChecksum;
+        } catch (const std::exception& e) {
+            return error("%s : Deserialize error - %s", __func__, e.what());
+        }
+        if (hashChecksum != hasher.GetHash())
+            return error("%s : Checksum mismatch", __func__);
+        return true;
+    }
+    g_blockreadcache.CountRead(false);
+
     // Open history file to read
     CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -1442,6 +1898,11 @@ void static FlushBlockFile(bool fFinalize = false)
     FlatFilePos block_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nSize);
     FlatFilePos undo_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nUndoSize);
 
+    if (fFinalize) {
+        // Reading a mapping past the end of a truncated file raises SIGBUS
+        g_blockreadcache.DropFile(nLastBlockFile);
+    }
+
     bool status = true;
     status &= BlockFileSeq().Flush(block_pos_old, fFinalize);
     status &= UndoFileSeq().Flush(undo_pos_old, fFinalize);
@@ -1540,7 +2001,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
     }
 
-    bool fScriptChecks = pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate();
+    bool fScriptChecks = pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate() && !IsAssumedValid(pindex);
 
     // If scripts won't be checked anyways, don't bother seeing if CLTV is activated
     bool fCLTVIsActivated = false;
@@ -1970,6 +2431,8 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
         for (auto it = block.vtx.rbegin(); it != block.vtx.rend(); ++it) {
             disconnectpool->addTransaction(*it);
         }
+        disconnectpool->nLowestHeight = std::min(disconnectpool->nLowestHeight, pindexDelete->nHeight);
+        disconnectpool->nHighestHeight = std::max(disconnectpool->nHighestHeight, pindexDelete->nHeight);
         while (disconnectpool->DynamicMemoryUsage() > MAX_DISCONNECTED_TX_POOL_SIZE * 1000) {
             // Drop the earliest entry, and remove its children from the mempool.
             auto it = disconnectpool->queuedTx.get<insertion_order>().begin();
@@ -2476,7 +2939,25 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex* pindex)
     return true;
 }
 
-CBlockIndex* AddToBlockIndex(const CBlock& block)
+/**
+ * Compute the stake modifier of pindex. It needs the block body (the coinstake
+ * prevout for V2 modifiers), so entries added from a bare header get it later,
+ * when the block is received.
+ */
+static void SetBlockIndexStakeModifier(CBlockIndex* pindex, const CBlock& block)
+{
+    assert(pindex->pprev);
+    if (!Params().GetConsensus().NetworkUpgradeActive(pindex->nHeight, Consensus::UPGRADE_V3_4)) {
+        // compute and set new V1 stake modifier (entropy bits)
+        pindex->SetNewStakeModifier();
+
+    } else {
+        // compute and set new V2 stake modifier (hash of prevout and prevModifier)
+        pindex->SetNewStakeModifier(block.vtx[1]->vin[0].prevout.hash);
+    }
+}
+
+CBlockIndex* AddToBlockIndex(const CBlock& block)
 {
     // Check for duplicate
     uint256 hash = block.GetHash();
@@ -2499,15 +2980,9 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
         pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
         pindexNew->BuildSkip();
 
-        const Consensus::Params& consensus = Params().GetConsensus();
-        if (!consensus.NetworkUpgradeActive(pindexNew->nHeight, Consensus::UPGRADE_V3_4)) {
-            // compute and set new V1 stake modifier (entropy bits)
-            pindexNew->SetNewStakeModifier();
-
-        } else {
-            // compute and set new V2 stake modifier (hash of prevout and prevModifier)
-            pindexNew->SetNewStakeModifier(block.vtx[1]->vin[0].prevout.hash);
-        }
+        // Header-only entry (headers-first sync): the stake modifier is set in AcceptBlock
+        if (!block.vtx.empty())
+            SetBlockIndexStakeModifier(pindexNew, block);
     }
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
@@ -2703,6 +3178,67 @@ static unsigned int GetTotalShieldedTxSize(const CBlock& block)
     return nSizeShielded;
 }
 
+bool IsAssumedValid(const CBlockIndex* pindex, const CBlockIndex* pindexAssumeValid, const CBlockIndex* pindexBestHeaderIn)
+{
+    if (!pindex || !pindexAssumeValid || !pindexBestHeaderIn)
+        return false;
+    // The block must be an ancestor of the assumed-valid block...
+    if (pindexAssumeValid->GetAncestor(pindex->nHeight) != pindex)
+        return false;
+    // ...which must be part of our best header chain, so that we know about a chain with
+    // at least as much work as the one the assumed-valid block was taken from.
+    if (pindexBestHeaderIn->GetAncestor(pindexAssumeValid->nHeight) != pindexAssumeValid)
+        return false;
+    // Only skip the checks for blocks that are buried deep enough in the header chain, so that
+    // a long chain needs to be built on top of an invalid block before it can be assumed valid.
+    return pindexBestHeaderIn->GetBlockTime() - pindex->GetBlockTime() >= ASSUMEVALID_MIN_BURIAL_TIME;
+}
+
+bool IsAssumedValid(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (hashAssumeValid.IsNull())
+        return false;
+    auto it = mapBlockIndex.find(hashAssumeValid);
+    if (it == mapBlockIndex.end())
+        return false;
+    return IsAssumedValid(pindex, it->second, pindexBestHeader);
+}
+
+bool CheckMerkleRoot(const CBlock& block, CValidationState& state)
+{
+    if (block.fCheckedMerkleRoot)
+        return true;
+
+    bool mutated;
+    uint256 hashMerkleRoot2 = BlockMerkleRoot(block, &mutated);
+    if (block.hashMerkleRoot != hashMerkleRoot2)
+        return state.DoS(100, false, REJECT_INVALID, "bad-txnmrklroot", true, "hashMerkleRoot mismatch");
+
+    // Check for merkle tree malleability (CVE-2012-2459): repeating sequences
+    // of transactions in a block without affecting the merkle root of a block,
+    // while still invalidating it.
+    if (mutated)
+        return state.DoS(100, false, REJECT_INVALID, "bad-txns-duplicate", true, "duplicate transaction");
+
+    block.fCheckedMerkleRoot = true;
+    return true;
+}
+
+bool CheckBlockSig(const CBlock& block, CValidationState& state)
+{
+    if (block.fCheckedBlockSig)
+        return true;
+
+    if (!CheckBlockSignature(block)) {
+        return state.DoS(100, error("%s : bad proof-of-stake block signature", __func__),
+                         REJECT_INVALID, "bad-PoS-sig", true);
+    }
+
+    block.fCheckedBlockSig = true;
+    return true;
+}
+
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
 {
     if (block.fChecked)
@@ -2721,18 +3257,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
     // because we receive the wrong transactions for it.
 
     // Check the merkle root.
-    if (fCheckMerkleRoot) {
-        bool mutated;
-        uint256 hashMerkleRoot2 = BlockMerkleRoot(block, &mutated);
-        if (block.hashMerkleRoot != hashMerkleRoot2)
-            return state.DoS(100, false, REJECT_INVALID, "bad-txnmrklroot", true, "hashMerkleRoot mismatch");
-
-        // Check for merkle tree malleability (CVE-2012-2459): repeating sequences
-        // of transactions in a block without affecting the merkle root of a block,
-        // while still invalidating it.
-        if (mutated)
-            return state.DoS(100, false, REJECT_INVALID, "bad-txns-duplicate", true, "duplicate transaction");
-    }
+    if (fCheckMerkleRoot && !CheckMerkleRoot(block, state))
+        return false;
 
     // Size limits
     unsigned int nMaxBlockSize = MAX_BLOCK_SIZE_CURRENT;
@@ -2823,10 +3349,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
             REJECT_INVALID, "bad-blk-sigops", true);
 
     // Check PoS signature.
-    if (fCheckSig && !CheckBlockSignature(block)) {
-        return state.DoS(100, error("%s : bad proof-of-stake block signature", __func__),
-                         REJECT_INVALID, "bad-PoS-sig", true);
-    }
+    if (fCheckSig && !CheckBlockSig(block, state))
+        return false;
 
     if (fCheckPOW && fCheckMerkleRoot && fCheckSig)
         block.fChecked = true;
@@ -2834,14 +3358,19 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
     return true;
 }
 
-bool CheckWork(const CBlock& block, const CBlockIndex* const pindexPrev)
+/**
+ * Check the difficulty target of a block. fProofOfWork enables the tolerance
+ * applied to proof-of-work blocks before the DGW fork; it is also used for
+ * headers, whose block type is not known without the body.
+ */
+static bool CheckWorkRequired(const CBlockHeader& block, bool fProofOfWork, const CBlockIndex* const pindexPrev)
 {
     if (pindexPrev == NULL)
         return error("%s : null pindexPrev for block %s", __func__, block.GetHash().GetHex());
 
     unsigned int nBitsRequired = GetNextWorkRequired(pindexPrev, &block);
 
-    if (!Params().IsRegTestNet() && block.IsProofOfWork() && (pindexPrev->nHeight + 1 <= 68589)) {
+    if (!Params().IsRegTestNet() && fProofOfWork && (pindexPrev->nHeight + 1 <= 68589)) {
         double n1 = ConvertBitsToDouble(block.nBits);
         double n2 = ConvertBitsToDouble(nBitsRequired);
 
@@ -2866,6 +3395,11 @@ bool CheckWork(const CBlock& block, const CBlockIndex* const pindexPrev)
     return true;
 }
 
+bool CheckWork(const CBlock& block, const CBlockIndex* const pindexPrev)
+{
+    return CheckWorkRequired(block, block.IsProofOfWork(), pindexPrev);
+}
+
 bool CheckBlockTime(const CBlockHeader& block, CValidationState& state, CBlockIndex* const pindexPrev)
 {
     // Not enforced on RegTest
@@ -3052,6 +3586,38 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
     return true;
 }
 
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, CBlockIndex** ppindex)
+{
+    AssertLockHeld(cs_main);
+
+    CBlockIndex* pindexLast = nullptr;
+    for (const CBlockHeader& header : headers) {
+        if (pindexLast && header.hashPrevBlock != pindexLast->GetBlockHash())
+            return state.DoS(20, error("%s : non-continuous headers sequence", __func__), REJECT_INVALID, "bad-headers-chain");
+
+        const CBlock block(header);
+        BlockMap::iterator mi = mapBlockIndex.find(block.GetHash());
+        if (mi == mapBlockIndex.end()) {
+            // Without the body the coinstake (and thus the proof of stake) can't be verified yet:
+            // check the difficulty target here, the rest in AcceptBlockHeader, and leave the
+            // kernel and block signature to AcceptBlock.
+            CBlockIndex* pindexPrev = nullptr;
+            if (!GetPrevIndex(block, &pindexPrev, state))
+                return false;
+            if (pindexPrev && !CheckWorkRequired(block, true, pindexPrev))
+                return state.DoS(100, false, REJECT_INVALID, "bad-diffbits");
+            if (!AcceptBlockHeader(block, state, &pindexLast, pindexPrev))
+                return false;
+        } else if (!AcceptBlockHeader(block, state, &pindexLast)) {
+            return false;
+        }
+    }
+
+    if (ppindex)
+        *ppindex = pindexLast;
+    return true;
+}
+
 /*
  * Collect the sets of the inputs (either regular utxos or zerocoin serials) spent
  * by in-block txes.
@@ -3253,6 +3819,12 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockInde
     if (!GetPrevIndex(block, &pindexPrev, state))
         return false;
 
+    // Blocks are connected in order: an entry added from a header only has no
+    // stake modifier until its own data is received.
+    if (pindexPrev && !(pindexPrev->nStatus & BLOCK_HAVE_DATA))
+        return state.DoS(0, error("%s : prev block %s not received yet", __func__, block.hashPrevBlock.GetHex()), 0,
+                         "prevblk-no-data");
+
     if (block.GetHash() != consensus.hashGenesisBlock && !CheckWork(block, pindexPrev))
         return state.DoS(100, false, REJECT_INVALID);
 
@@ -3273,6 +3845,14 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockInde
         return true;
     }
 
+    if (pindex->pprev && pindex->vStakeModifier.empty()) {
+        // Index entry created by ProcessNewBlockHeaders
+        if (isPoS)
+            pindex->SetProofOfStake();
+        SetBlockIndexStakeModifier(pindex, block);
+        setDirtyBlockIndex.insert(pindex);
+    }
+
     if (!CheckBlock(block, state) || !ContextualCheckBlock(block, state, pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -3648,6 +4228,151 @@ bool LoadChainTip(const CChainParams& chainparams)
     return true;
 }
 
+namespace {
+
+/** Block (and undo) data of one block, read and pre-checked ahead of the CVerifyDB main loop */
+struct VerifyDBBlock
+{
+    CBlockIndex* pindex;
+    const uint256 hashBlock;
+    const uint256 hashPrevBlock;
+    const FlatFilePos blockPos;
+    const FlatFilePos undoPos;
+    CBlock block;
+    CBlockUndo undo;
+    bool fReadOk{false};
+    bool fUndoOk{false};
+    bool fDone{false};
+
+    explicit VerifyDBBlock(CBlockIndex* pindexIn) :
+        pindex(pindexIn),
+        hashBlock(pindexIn->GetBlockHash()),
+        hashPrevBlock(pindexIn->pprev ? pindexIn->pprev->GetBlockHash() : UINT256_ZERO),
+        blockPos(pindexIn->GetBlockPos()),
+        undoPos(pindexIn->GetUndoPos())
+    {}
+};
+
+/**
+ * Performs the context-free part of the block verification in parallel: read from disk
+ * (level 0), merkle root and block signature checks (level 1, cached in the block for
+ * CheckBlock) and undo data read (level 2).
+ * Blocks are handed back in the original order through Next(), and at most
+ * MAX_VERIFYDB_BLOCKS_IN_FLIGHT of them are held in memory at any time.
+ * Doesn't need (nor take) cs_main: everything needed from the index is copied upfront.
+ */
+class CVerifyDBPrefetcher
+{
+private:
+    std::mutex cs;
+    std::condition_variable condWorker;
+    std::condition_variable condConsumer;
+    std::vector<std::unique_ptr<VerifyDBBlock>> vBlocks;
+    size_t nNextToLoad{0};
+    size_t nNextToConsume{0};
+    bool fInterrupted{false};
+    const int nCheckLevel;
+    std::vector<std::thread> threads;
+
+    void Load(VerifyDBBlock& item)
+    {
+        if (!ReadBlockFromDisk(item.block, item.blockPos) || item.block.GetHash() != item.hashBlock) {
+            return;
+        }
+        item.fReadOk = true;
+        if (nCheckLevel >= 1) {
+            // failures are reported by CheckBlock, in the main loop
+            CValidationState state;
+            if (CheckMerkleRoot(item.block, state)) {
+                CheckBlockSig(item.block, state);
+            }
+        }
+        item.fUndoOk = nCheckLevel < 2 || item.undoPos.IsNull() ||
+                       UndoReadFromDisk(item.undo, item.undoPos, item.hashPrevBlock);
+    }
+
+    void ThreadLoad()
+    {
+        util::ThreadRename("trumpcoin-verifydb");
+        while (true) {
+            VerifyDBBlock* item;
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                while (!fInterrupted && nNextToLoad < vBlocks.size() && nNextToLoad >= nNextToConsume + MAX_VERIFYDB_BLOCKS_IN_FLIGHT)
+                    condWorker.wait(lock);
+                if (fInterrupted || nNextToLoad >= vBlocks.size())
+                    return;
+                item = vBlocks[nNextToLoad++].get();
+            }
+            try {
+                Load(*item);
+            } catch (const std::exception& e) {
+                LogPrintf("%s: %s\n", __func__, e.what());
+                item->fReadOk = false;
+            }
+            std::unique_lock<std::mutex> lock(cs);
+            item->fDone = true;
+            condConsumer.notify_all();
+        }
+    }
+
+public:
+    CVerifyDBPrefetcher(std::vector<std::unique_ptr<VerifyDBBlock>>&& vBlocksIn, int nCheckLevelIn) :
+        vBlocks(std::move(vBlocksIn)),
+        nCheckLevel(nCheckLevelIn)
+    {
+        const int nThreads = std::min<int>(std::max(1, nScriptCheckThreads), vBlocks.size());
+        for (int i = 0; i < nThreads; i++)
+            threads.emplace_back(&CVerifyDBPrefetcher::ThreadLoad, this);
+    }
+
+    ~CVerifyDBPrefetcher()
+    {
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            fInterrupted = true;
+            condWorker.notify_all();
+        }
+        for (std::thread& t : threads)
+            t.join();
+    }
+
+    /** Next block, in the original order, or nullptr when done. Honors boost thread interruption. */
+    std::unique_ptr<VerifyDBBlock> Next()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (nNextToConsume >= vBlocks.size())
+            return nullptr;
+        while (!vBlocks[nNextToConsume]->fDone) {
+            condConsumer.wait_for(lock, std::chrono::milliseconds(100));
+            lock.unlock();
+            boost::this_thread::interruption_point();
+            lock.lock();
+        }
+        std::unique_ptr<VerifyDBBlock> item = std::move(vBlocks[nNextToConsume++]);
+        condWorker.notify_all();
+        return item;
+    }
+};
+
+Mutex cs_verifydb_status;
+VerifyDBStatus g_verifydb_status;
+
+template <typename Callable>
+void UpdateVerifyDBStatus(Callable update)
+{
+    LOCK(cs_verifydb_status);
+    update(g_verifydb_status);
+}
+
+} // anon namespace
+
+VerifyDBStatus GetVerifyDBStatus()
+{
+    LOCK(cs_verifydb_status);
+    return g_verifydb_status;
+}
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks..."), 0);
@@ -3661,8 +4386,15 @@ CVerifyDB::~CVerifyDB()
 bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth)
 {
     LOCK(cs_main);
-    if (chainActive.Tip() == NULL || chainActive.Tip()->pprev == NULL)
+    if (chainActive.Tip() == NULL || chainActive.Tip()->pprev == NULL) {
+        // nothing to verify
+        UpdateVerifyDBStatus([&](VerifyDBStatus& status) {
+            status = VerifyDBStatus();
+            status.state = VerifyDBStatus::DONE;
+            status.nCheckLevel = nCheckLevel;
+        });
         return true;
+    }
 
     const int chainHeight = chainActive.Height();
 
@@ -3676,6 +4408,23 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
         nCheckDepth = chainHeight;
     nCheckLevel = std::max(0, std::min(4, nCheckLevel));
     LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
+    UpdateVerifyDBStatus([&](VerifyDBStatus& status) {
+        status = VerifyDBStatus();
+        status.state = VerifyDBStatus::RUNNING;
+        status.nCheckLevel = nCheckLevel;
+        status.nCheckDepth = nCheckDepth;
+    });
+    const bool fResult = VerifyDBInternal(coinsview, chainHeight, nCheckLevel, nCheckDepth);
+    UpdateVerifyDBStatus([&](VerifyDBStatus& status) {
+        status.state = fResult ? VerifyDBStatus::DONE : VerifyDBStatus::FAILED;
+    });
+    return fResult;
+}
+
+bool CVerifyDB::VerifyDBInternal(CCoinsView* coinsview, int chainHeight, int nCheckLevel, int nCheckDepth)
+{
+    AssertLockHeld(cs_main);
+
     CCoinsViewCache coins(coinsview);
     CBlockIndex* pindexState = chainActive.Tip();
     CBlockIndex* pindexFailure = NULL;
@@ -3683,8 +4432,15 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
     int reportDone = 0;
     LogPrintf("[0%%]...");
     CValidationState state;
-    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
-        boost::this_thread::interruption_point();
+
+    // levels 0-2 are performed in parallel, ahead of this loop
+    std::vector<std::unique_ptr<VerifyDBBlock>> vBlocks;
+    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev && pindex->nHeight >= chainHeight - nCheckDepth; pindex = pindex->pprev) {
+        vBlocks.emplace_back(new VerifyDBBlock(pindex));
+    }
+    CVerifyDBPrefetcher prefetcher(std::move(vBlocks), nCheckLevel);
+    while (std::unique_ptr<VerifyDBBlock> item = prefetcher.Next()) {
+        CBlockIndex* pindex = item->pindex;
         int percentageDone = std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
         if (reportDone < percentageDone/10) {
             // report every 10% step
@@ -3692,24 +4448,19 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
             reportDone = percentageDone/10;
         }
         uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
-        if (pindex->nHeight < chainHeight - nCheckDepth)
-            break;
-        CBlock block;
+        UpdateVerifyDBStatus([&](VerifyDBStatus& status) {
+            status.nProgress = percentageDone;
+        });
+        CBlock& block = item->block;
         // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex))
+        if (!item->fReadOk)
             return error("%s: *** ReadBlockFromDisk failed at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
         // check level 1: verify block validity
         if (nCheckLevel >= 1 && !CheckBlock(block, state))
             return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
         // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            FlatFilePos pos = pindex->GetUndoPos();
-            if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
-                    return error("%s: *** found bad undo data at %d, hash=%s\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
-            }
-        }
+        if (nCheckLevel >= 2 && !item->fUndoOk)
+            return error("%s: *** found bad undo data at %d, hash=%s\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             assert(coins.GetBestBlock() == pindex->GetBlockHash());
@@ -3726,23 +4477,30 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
                 nGoodTransactions += block.vtx.size();
             }
         }
+        if (pindexFailure != pindex) {
+            UpdateVerifyDBStatus([&](VerifyDBStatus& status) {
+                status.nVerified++;
+            });
+        }
         if (ShutdownRequested())
             return true;
     }
     if (pindexFailure)
         return error("%s: *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", __func__, chainHeight - pindexFailure->nHeight + 1, nGoodTransactions);
 
-    // check level 4: try reconnecting blocks
+    // check level 4: try reconnecting blocks (serially, with the block reads done ahead)
     if (nCheckLevel >= 4) {
-        CBlockIndex* pindex = pindexState;
-        while (pindex != chainActive.Tip()) {
-            boost::this_thread::interruption_point();
+        std::vector<std::unique_ptr<VerifyDBBlock>> vReconnect;
+        for (CBlockIndex* pindex = chainActive.Next(pindexState); pindex; pindex = chainActive.Next(pindex)) {
+            vReconnect.emplace_back(new VerifyDBBlock(pindex));
+        }
+        CVerifyDBPrefetcher prefetcherReconnect(std::move(vReconnect), 0);
+        while (std::unique_ptr<VerifyDBBlock> item = prefetcherReconnect.Next()) {
+            CBlockIndex* pindex = item->pindex;
             uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 100 - (int)(((double)(chainHeight - pindex->nHeight)) / (double)nCheckDepth * 50))));
-            pindex = chainActive.Next(pindex);
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex))
+            if (!item->fReadOk)
                 return error("%s: *** ReadBlockFromDisk failed at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
-            if (!ConnectBlock(block, state, pindex, coins, false))
+            if (!ConnectBlock(item->block, state, pindex, coins, false))
                 return error("%s: *** found unconnectable block at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
         }
     }
@@ -3752,6 +4510,69 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
     return true;
 }
 
+bool CVerifyDB::VerifyBlocks(int nCheckLevel, int nCheckDepth)
+{
+    // Only the levels that don't depend on the chain state (0-2) can run while the node is active
+    nCheckLevel = std::max(0, std::min(2, nCheckLevel));
+
+    std::vector<std::unique_ptr<VerifyDBBlock>> vBlocks;
+    {
+        LOCK(cs_main);
+        const int chainHeight = chainActive.Height();
+        if (nCheckDepth <= 0 || nCheckDepth > chainHeight)
+            nCheckDepth = chainHeight;
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev && pindex->nHeight >= chainHeight - nCheckDepth; pindex = pindex->pprev) {
+            vBlocks.emplace_back(new VerifyDBBlock(pindex));
+        }
+    }
+    LogPrintf("Verifying last %i blocks at level %i in background\n", vBlocks.size(), nCheckLevel);
+    UpdateVerifyDBStatus([&](VerifyDBStatus& status) {
+        status = VerifyDBStatus();
+        status.state = VerifyDBStatus::RUNNING;
+        status.fBackground = true;
+        status.nCheckLevel = nCheckLevel;
+        status.nCheckDepth = nCheckDepth;
+    });
+
+    const size_t nBlocks = vBlocks.size();
+    size_t nProcessed = 0;
+    size_t nVerified = 0;
+    bool fResult = true;
+    CVerifyDBPrefetcher prefetcher(std::move(vBlocks), nCheckLevel);
+    while (std::unique_ptr<VerifyDBBlock> item = prefetcher.Next()) {
+        const CBlockIndex* pindex = item->pindex;
+        const int percentageDone = std::max(1, std::min(99, (int)(100.0 * ++nProcessed / nBlocks)));
+        UpdateVerifyDBStatus([&](VerifyDBStatus& status) {
+            status.nProgress = percentageDone;
+        });
+        if (!item->fReadOk) {
+            fResult = error("%s: *** ReadBlockFromDisk failed at %d, hash=%s", __func__, pindex->nHeight, item->hashBlock.ToString());
+            break;
+        }
+        CValidationState state;
+        if (nCheckLevel >= 1 && !WITH_LOCK(cs_main, return CheckBlock(item->block, state); )) {
+            fResult = error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__, pindex->nHeight, item->hashBlock.ToString(), FormatStateMessage(state));
+            break;
+        }
+        if (nCheckLevel >= 2 && !item->fUndoOk) {
+            fResult = error("%s: *** found bad undo data at %d, hash=%s\n", __func__, pindex->nHeight, item->hashBlock.ToString());
+            break;
+        }
+        nVerified++;
+        UpdateVerifyDBStatus([&](VerifyDBStatus& status) {
+            status.nVerified++;
+        });
+        if (ShutdownRequested())
+            break;
+    }
+    UpdateVerifyDBStatus([&](VerifyDBStatus& status) {
+        status.state = fResult ? VerifyDBStatus::DONE : VerifyDBStatus::FAILED;
+    });
+    if (fResult)
+        LogPrintf("Background verification of %i blocks done\n", nVerified);
+    return fResult;
+}
+
 /** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
 static bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params)
 {
@@ -3868,6 +4689,7 @@ void UnloadBlockIndex()
     nBlockSequenceId = 1;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
+    g_blockreadcache.Clear();
 
     for (BlockMap::value_type& entry : mapBlockIndex) {
         delete entry.second;
@@ -3932,110 +4754,323 @@ bool LoadGenesisBlock()
 }
 
 
+namespace {
+
+/** A serialized block located by the import scanner, travelling through the import pipeline */
+struct ImportedBlock
+{
+    uint64_t nSeq{0};
+    uint64_t nSize{0};
+    FlatFilePos pos;
+    std::shared_ptr<CBlock> block{nullptr};
+};
+
+/**
+ * Pipelined reader for LoadExternalBlockFile:
+ * - a scanner thread locates the serialized blocks in the file and deserializes them. The
+ *   scan resumes after the bytes actually consumed by the block (or one byte after the
+ *   magic if it can't be deserialized), so that a corrupt size field can't hide the
+ *   blocks that follow it,
+ * - a pool of workers runs the context-free checks (merkle root and block signature,
+ *   cached in the block for CheckBlock),
+ * - the importing thread receives them back in file order through Next() and only
+ *   does the contextual work (ProcessNewBlock).
+ * The amount of block data in flight is bounded by nMaxBytesInFlight.
+ */
+class CBlockImportPipeline
+{
+private:
+    //! Mutex protecting the queues and the counters below
+    std::mutex cs;
+    //! Scanner blocks on this when too much data is in flight
+    std::condition_variable condScanner;
+    //! Workers block on this when out of work
+    std::condition_variable condWorker;
+    //! Importing thread blocks on this while the next block isn't ready
+    std::condition_variable condImporter;
+
+    //! Blocks read by the scanner, waiting to be deserialized and checked
+    std::deque<std::shared_ptr<ImportedBlock>> queueToCheck;
+    //! Checked blocks (or failures), by sequence number, waiting to be connected
+    std::map<uint64_t, std::shared_ptr<ImportedBlock>> mapReady;
+    //! Sequence number of the next block to hand out through Next()
+    uint64_t nNextSeq{0};
+    //! Number of blocks found by the scanner so far
+    uint64_t nScanned{0};
+    uint64_t nBytesInFlight{0};
+    bool fScanDone{false};
+    bool fInterrupted{false};
+
+    const uint64_t nMaxBytesInFlight;
+    const FlatFilePos* const dbp;
+    std::vector<std::thread> threads;
+
+    // Per-stage statistics
+    std::atomic<uint64_t> nScanBytes{0};
+    std::atomic<int64_t> nScanMicros{0};
+    std::atomic<uint64_t> nChecked{0};
+    std::atomic<int64_t> nCheckMicros{0};
+
+    void ThreadScan(FILE* fileIn)
+    {
+        util::ThreadRename("trumpcoin-impscan");
+        const int64_t nStart = GetTimeMicros();
+        try {
+            // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+            CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
+            uint64_t nRewind = blkdat.GetPos();
+            while (!blkdat.eof() && !IsInterrupted()) {
+                blkdat.SetPos(nRewind);
+                nRewind++;         // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[MESSAGE_START_SIZE];
+                    blkdat.FindByte(Params().MessageStart()[0]);
+                    nRewind = blkdat.GetPos()+1;
+                    blkdat >> buf;
+                    if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    break;
+                }
+                try {
+                    // read block
+                    auto item = std::make_shared<ImportedBlock>();
+                    uint64_t nBlockPos = blkdat.GetPos();
+                    if (dbp) {
+                        item->pos = *dbp;
+                        item->pos.nPos = nBlockPos;
+                    }
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    blkdat.SetPos(nBlockPos);
+                    item->block = std::make_shared<CBlock>();
+                    blkdat >> *item->block;
+                    nRewind = blkdat.GetPos();
+                    item->nSize = nRewind - nBlockPos;
+                    nScanBytes += item->nSize;
+                    if (!Push(item))
+                        break;
+                } catch (const std::exception& e) {
+                    LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+                }
+            }
+        } catch (const std::runtime_error& e) {
+            AbortNode(std::string("System error: ") + e.what());
+        }
+        nScanMicros = GetTimeMicros() - nStart;
+        std::unique_lock<std::mutex> lock(cs);
+        fScanDone = true;
+        condImporter.notify_all();
+    }
+
+    void ThreadCheck()
+    {
+        util::ThreadRename("trumpcoin-impcheck");
+        while (true) {
+            std::shared_ptr<ImportedBlock> item;
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                while (!fInterrupted && queueToCheck.empty() && !fScanDone)
+                    condWorker.wait(lock);
+                if (fInterrupted || queueToCheck.empty())
+                    return;
+                item = queueToCheck.front();
+                queueToCheck.pop_front();
+            }
+
+            const int64_t nStart = GetTimeMicros();
+            // Context-free checks. A failure here is not final: ProcessNewBlock
+            // runs CheckBlock again and reports the invalid state itself.
+            CValidationState state;
+            if (CheckMerkleRoot(*item->block, state)) {
+                CheckBlockSig(*item->block, state);
+            }
+            nCheckMicros += GetTimeMicros() - nStart;
+            nChecked++;
+
+            std::unique_lock<std::mutex> lock(cs);
+            mapReady.emplace(item->nSeq, item);
+            if (item->nSeq == nNextSeq)
+                condImporter.notify_one();
+        }
+    }
+
+    bool Push(const std::shared_ptr<ImportedBlock>& item)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        while (!fInterrupted && nBytesInFlight > 0 && nBytesInFlight + item->nSize > nMaxBytesInFlight)
+            condScanner.wait(lock);
+        if (fInterrupted)
+            return false;
+        item->nSeq = nScanned++;
+        nBytesInFlight += item->nSize;
+        queueToCheck.push_back(item);
+        condWorker.notify_one();
+        return true;
+    }
+
+    bool IsInterrupted()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        return fInterrupted;
+    }
+
+public:
+    CBlockImportPipeline(FILE* fileIn, const FlatFilePos* dbpIn, int nWorkers, uint64_t nMaxBytesInFlightIn) :
+        nMaxBytesInFlight(nMaxBytesInFlightIn),
+        dbp(dbpIn)
+    {
+        threads.emplace_back(&CBlockImportPipeline::ThreadScan, this, fileIn);
+        for (int i = 0; i < nWorkers; i++)
+            threads.emplace_back(&CBlockImportPipeline::ThreadCheck, this);
+    }
+
+    ~CBlockImportPipeline()
+    {
+        Interrupt();
+        for (std::thread& t : threads)
+            t.join();
+    }
+
+    void Interrupt()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        fInterrupted = true;
+        condScanner.notify_all();
+        condWorker.notify_all();
+        condImporter.notify_all();
+    }
+
+    /**
+     * Get the next block in file order. Returns false once the whole file has been processed.
+     * Honors boost thread interruption of the calling thread.
+     */
+    bool Next(std::shared_ptr<ImportedBlock>& item)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        while (true) {
+            auto it = mapReady.find(nNextSeq);
+            if (it != mapReady.end()) {
+                item = it->second;
+                mapReady.erase(it);
+                nNextSeq++;
+                nBytesInFlight -= item->nSize;
+                condScanner.notify_one();
+                return true;
+            }
+            if (fInterrupted || (fScanDone && nNextSeq == nScanned))
+                return false;
+            condImporter.wait_for(lock, std::chrono::milliseconds(100));
+            lock.unlock();
+            boost::this_thread::interruption_point();
+            lock.lock();
+        }
+    }
+
+    std::string ToString(int64_t nElapsedMicros, uint64_t nConnected, int64_t nConnectMicros) const
+    {
+        const double nElapsed = std::max<int64_t>(nElapsedMicros, 1) * 0.000001;
+        return strprintf("scan: %.1fMB (%.1fMB/s), check: %u blocks (%.1f blk/s, %.2fms/blk), connect: %u blocks (%.1f blk/s, %.2fms/blk)",
+                         nScanBytes * 0.000001, nScanBytes * 0.000001 / nElapsed,
+                         nChecked.load(), nChecked / nElapsed, nChecked ? nCheckMicros * 0.001 / nChecked : 0.0,
+                         nConnected, nConnected / nElapsed, nConnected ? nConnectMicros * 0.001 / nConnected : 0.0);
+    }
+};
+
+} // anon namespace
+
 bool LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
     static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+    const int64_t nStart = GetTimeMicros();
+    int64_t nLastProgress = nStart;
+    int64_t nConnectMicros = 0;
 
     // Block checked event listener
     BlockStateCatcher stateCatcher(UINT256_ZERO);
     stateCatcher.registerEvent();
 
     int nLoaded = 0;
-    try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++;         // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
+    uint64_t nProcessed = 0;
+    CBlockImportPipeline pipeline(fileIn, dbp, std::max(1, nScriptCheckThreads), MAX_IMPORT_BYTES_IN_FLIGHT);
+    std::shared_ptr<ImportedBlock> item;
+    while (pipeline.Next(item)) {
+        const int64_t nConnectStart = GetTimeMicros();
+        try {
+            std::shared_ptr<const CBlock> block_ptr = item->block;
+            if (dbp)
+                *dbp = item->pos;
+
+            // detect out of order blocks, and store them for later
+            uint256 hash = block_ptr->GetHash();
+            if (hash != Params().GetConsensus().hashGenesisBlock && WITH_LOCK(cs_main, auto mi = mapBlockIndex.find(block_ptr->hashPrevBlock); return mi == mapBlockIndex.end() || !(mi->second->nStatus & BLOCK_HAVE_DATA))) {
+                LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
+                        hash.GetHex(), block_ptr->hashPrevBlock.GetHex());
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != Params().GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
-                            hash.GetHex(), block.hashPrevBlock.GetHex());
-                    if (dbp)
-                        mapBlocksUnknownParent.emplace(block.hashPrevBlock, *dbp);
-                    continue;
-                }
+                    mapBlocksUnknownParent.emplace(block_ptr->hashPrevBlock, *dbp);
+                continue;
+            }
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    std::shared_ptr<const CBlock> block_ptr = std::make_shared<const CBlock>(block);
-                    stateCatcher.setBlockHash(block_ptr->GetHash());
-                    if (ProcessNewBlock(block_ptr, dbp)) {
-                        nLoaded++;
-                    }
-                    if (stateCatcher.stateErrorFound()) {
-                        break;
-                    }
-                } else if (hash != Params().GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+            // process in case the block isn't known yet
+            CBlockIndex* pindex = WITH_LOCK(cs_main, auto mi = mapBlockIndex.find(hash); return mi == mapBlockIndex.end() ? nullptr : mi->second);
+            if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+                stateCatcher.setBlockHash(hash);
+                if (ProcessNewBlock(block_ptr, dbp)) {
+                    nLoaded++;
+                }
+                if (stateCatcher.stateErrorFound()) {
+                    break;
                 }
+            } else if (hash != Params().GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+                LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+            }
 
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second)) {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
-                                head.ToString());
-                            std::shared_ptr<const CBlock> block_ptr = std::make_shared<const CBlock>(block);
-                            if (ProcessNewBlock(block_ptr, &it->second)) {
-                                nLoaded++;
-                                queue.emplace_back(block.GetHash());
-                            }
+            // Recursively process earlier encountered successors of this block
+            std::deque<uint256> queue;
+            queue.push_back(hash);
+            while (!queue.empty()) {
+                uint256 head = queue.front();
+                queue.pop_front();
+                std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                while (range.first != range.second) {
+                    std::multimap<uint256, FlatFilePos>::iterator it = range.first;
+                    std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                    if (ReadBlockFromDisk(*pblockrecursive, it->second)) {
+                        LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                            head.ToString());
+                        if (ProcessNewBlock(pblockrecursive, &it->second)) {
+                            nLoaded++;
+                            queue.emplace_back(pblockrecursive->GetHash());
                         }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
                     }
+                    range.first++;
+                    mapBlocksUnknownParent.erase(it);
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
             }
+        } catch (const std::exception& e) {
+            LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
         }
-    } catch (const std::runtime_error& e) {
-        AbortNode(std::string("System error: ") + e.what());
+        nConnectMicros += GetTimeMicros() - nConnectStart;
+        nProcessed++;
+
+        const int64_t nNow = GetTimeMicros();
+        if (nNow - nLastProgress > IMPORT_PROGRESS_INTERVAL * 1000000) {
+            nLastProgress = nNow;
+            LogPrint(BCLog::REINDEX, "Block Import: %s\n", pipeline.ToString(nNow - nStart, nProcessed, nConnectMicros));
+        }
+    }
+    if (nLoaded > 0) {
+        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, (GetTimeMicros() - nStart) / 1000);
+        LogPrint(BCLog::REINDEX, "Block Import: %s\n", pipeline.ToString(GetTimeMicros() - nStart, nProcessed, nConnectMicros));
     }
-    if (nLoaded > 0)
-        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
     return nLoaded > 0;
 }
 
@@ -4209,7 +5244,24 @@ CBlockFileInfo* GetBlockFileInfo(size_t n)
     return &vinfoBlockFile.at(n);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+/**
+ * mempool.dat versions:
+ * 1: transactions, then the prioritisation deltas.
+ * 2: adds a checksum after every transaction record and after the deltas, to detect corruption.
+ *    It is not a proof that the transactions are valid: they are fully checked again on load.
+ */
+static const uint64_t MEMPOOL_DUMP_VERSION_NO_CHECKSUM = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+
+/** Number of transactions read from mempool.dat and handed to AcceptToMemoryPoolBatch at once */
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
+
+static uint256 MempoolRecordChecksum(const CTransactionRef& tx, int64_t nTime, int64_t nFeeDelta)
+{
+    CHashWriter ss(SER_DISK, CLIENT_VERSION);
+    ss << tx << nTime << nFeeDelta;
+    return ss.GetHash();
+}
 
 bool LoadMempool(CTxMemPool& pool)
 {
@@ -4224,14 +5276,30 @@ bool LoadMempool(CTxMemPool& pool)
     int64_t count = 0;
     int64_t skipped = 0;
     int64_t failed = 0;
+    int64_t corrupted = 0;
     int64_t nNow = GetTime();
 
+    std::vector<CTransactionRef> vtx;
+    std::vector<int64_t> vAcceptTime;
+    auto acceptBatch = [&]() {
+        for (const MemPoolAcceptResult& result : AcceptToMemoryPoolBatch(pool, vtx, true, vAcceptTime)) {
+            if (result.fAccepted) {
+                ++count;
+            } else {
+                ++failed;
+            }
+        }
+        vtx.clear();
+        vAcceptTime.clear();
+    };
+
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_NO_CHECKSUM) {
             return false;
         }
+        const bool fChecksums = version != MEMPOOL_DUMP_VERSION_NO_CHECKSUM;
         uint64_t num;
         file >> num;
         while (num--) {
@@ -4241,19 +5309,24 @@ bool LoadMempool(CTxMemPool& pool)
             file >> tx;
             file >> nTime;
             file >> nFeeDelta;
+            if (fChecksums) {
+                uint256 checksum;
+                file >> checksum;
+                if (checksum != MempoolRecordChecksum(tx, nTime, nFeeDelta)) {
+                    ++corrupted;
+                    continue;
+                }
+            }
 
             CAmount amountdelta = nFeeDelta;
             if (amountdelta) {
                 pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
-            CValidationState state;
             if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(pool, state, tx, true, NULL, nTime);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    ++failed;
+                vtx.emplace_back(std::move(tx));
+                vAcceptTime.emplace_back(nTime);
+                if (vtx.size() >= MEMPOOL_LOAD_BATCH_SIZE) {
+                    acceptBatch();
                 }
             } else {
                 ++skipped;
@@ -4261,8 +5334,20 @@ bool LoadMempool(CTxMemPool& pool)
             if (ShutdownRequested())
                 return false;
         }
+        if (!vtx.empty()) {
+            acceptBatch();
+        }
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
+        if (fChecksums) {
+            uint256 checksum;
+            file >> checksum;
+            if (checksum != SerializeHash(mapDeltas)) {
+                // The transactions are already loaded, only the deltas are dropped
+                LogPrintf("Mempool prioritisation data on disk is corrupted, ignoring it.\n");
+                mapDeltas.clear();
+            }
+        }
 
         for (const auto& i : mapDeltas) {
             pool.PrioritiseTransaction(i.first, i.second);
@@ -4272,7 +5357,8 @@ bool LoadMempool(CTxMemPool& pool)
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i successes, %i failed, %i expired\n", count, failed, skipped);
+    LogPrintf("Imported mempool transactions from disk: %i successes, %i failed, %i expired, %i corrupted\n",
+              count, failed, skipped, corrupted);
     return true;
 }
 
@@ -4309,13 +5395,17 @@ bool DumpMempool(const CTxMemPool& pool)
 
         file << (uint64_t)vinfo.size();
         for (const auto& i : vinfo) {
+            const int64_t nTime = i.nTime;
+            const int64_t nFeeDelta = i.nFeeDelta;
             file << i.tx;
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
+            file << nTime;
+            file << nFeeDelta;
+            file << MempoolRecordChecksum(i.tx, nTime, nFeeDelta);
             mapDeltas.erase(i.tx->GetHash());
         }
 
         file << mapDeltas;
+        file << SerializeHash(mapDeltas);
         if (!FileCommit(file.Get()))
             throw std::runtime_error("FileCommit failed");
         file.fclose();
@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <atomic>
 #include <exception>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
@@ -74,9 +75,15 @@ static const unsigned int MAX_STANDARD_TX_SIZE = 150000;
 static const unsigned int MAX_ZEROCOIN_TX_SIZE = 180000;
 /** Maximum kilobytes for transactions to store for processing during reorg */
 static const unsigned int MAX_DISCONNECTED_TX_POOL_SIZE = 20000;
+/** Minimum time (in seconds) between a block and the best header for -assumevalid to skip its script checks */
+static const int64_t ASSUMEVALID_MIN_BURIAL_TIME = 60 * 60 * 24 * 7 * 2;
 /** Default for -checkblocks */
 static const signed int DEFAULT_CHECKBLOCKS = 6;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
+/** Default for -backgroundverify */
+static const bool DEFAULT_BACKGROUND_VERIFY = false;
+/** Maximum number of blocks read ahead of the block verification at startup */
+static const unsigned int MAX_VERIFYDB_BLOCKS_IN_FLIGHT = 64;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
@@ -87,6 +94,10 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum amount of block data (in bytes) read ahead by the block import pipeline */
+static const uint64_t MAX_IMPORT_BYTES_IN_FLIGHT = 64 * 1024 * 1024;
+/** Time (in seconds) between block import progress reports */
+static const int64_t IMPORT_PROGRESS_INTERVAL = 30;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -99,6 +110,21 @@ static const unsigned int MAX_HEADERS_RESULTS = 2000;
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
  *  harder). We'll probably want to make this a per-peer adaptive value at some point. */
 static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
+/** Headers download timeout expressed in microseconds.
+ *  Timeout = base + per_header * (expected number of headers) */
+static const int64_t HEADERS_DOWNLOAD_TIMEOUT_BASE = 15 * 60 * 1000000; // 15 minutes
+static const int64_t HEADERS_DOWNLOAD_TIMEOUT_PER_HEADER = 1000; // 1ms/header
+/** Maximum number of "headers" messages that don't connect to our header tree before the sender is penalized. */
+static const int MAX_UNCONNECTING_HEADERS = 10;
+/** How far above the active tip headers are accepted. The proof of stake of a header can only be
+ *  checked with its block, so header-only index entries are kept close to the verified chain. */
+static const int MAX_HEADERS_AHEAD = 2 * MAX_HEADERS_RESULTS;
+/** Maximum number of header-only index entries (whose block wasn't received yet) a peer can create. */
+static const int MAX_UNVERIFIED_HEADERS_PER_PEER = MAX_HEADERS_AHEAD + MAX_HEADERS_RESULTS;
+/** Maximum number of blocks downloaded from one peer that can wait for their parent. */
+static const int MAX_BLOCKS_PENDING_PARENT_PER_PEER = 4 * MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+/** Maximum total size (in bytes) of the blocks waiting for their parent. */
+static const size_t MAX_BLOCKS_PENDING_PARENT_SIZE = 32 * 1000 * 1000;
 /** Time to wait (in seconds) between writing blocks/block index to disk. */
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
@@ -107,8 +133,6 @@ static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
 static constexpr std::chrono::hours AVG_LOCAL_ADDRESS_BROADCAST_INTERVAL{24};
 /** Average delay between peer address broadcasts */
 static constexpr std::chrono::seconds AVG_ADDRESS_BROADCAST_INTERVAL{30};
-/** Default multiplier used in the computation for shielded txes min fee */
-static const unsigned int DEFAULT_SHIELDEDTXFEE_K = 100;
 /** Enable bloom filter */
  static const bool DEFAULT_PEERBLOOMFILTERS = true;
 /** If the tip is older than this (in seconds), the node is considered to be in initial block download. */
@@ -140,6 +164,8 @@ extern std::atomic<bool> fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
 extern bool fRequireStandard;
+/** Block hash whose ancestors we will assume to have valid scripts (-assumevalid) */
+extern uint256 hashAssumeValid;
 extern bool fCheckBlockIndex;
 extern size_t nCoinCacheUsage;
 extern CFeeRate minRelayTxFee;
@@ -180,7 +206,10 @@ FILE* OpenBlockFile(const FlatFilePos& pos, bool fReadOnly = false);
 FILE* OpenUndoFile(const FlatFilePos& pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
 fs::path GetBlockPosFilename(const FlatFilePos &pos);
-/** Import blocks from an external file */
+/** Import blocks from an external file.
+ * The file is scanned on a dedicated thread, blocks are deserialized and pre-checked
+ * (merkle root, block signature) by a pool of workers, and connected in file order
+ * by the calling thread. */
 bool LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp = NULL);
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock();
@@ -195,6 +224,10 @@ void UnloadBlockIndex();
 int ActiveProtocol();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the parallel task thread, see ParallelForEach */
+void ThreadParallelTask();
+/** Run fn(0) .. fn(n - 1) on the parallel task threads, the calling one included. */
+void ParallelForEach(size_t n, const std::function<void(size_t)>& fn);
 
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
@@ -218,7 +251,11 @@ CBlockIndex* InsertBlockIndex(uint256 hash);
 void FlushStateToDisk();
 
 
-/** (try to) add transaction to memory pool **/
+/**
+ * (try to) add transaction to memory pool.
+ * cs_main is taken internally and released while the Sapling proofs and input scripts are
+ * checked, so callers should not hold it (holding it is correct, but serializes the checks).
+ */
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransactionRef& tx, bool fLimitFree, bool* pfMissingInputs, bool fOverrideMempoolLimit = false, bool fRejectInsaneFee = false, bool ignoreFees = false);
 
 /** (try to) add transaction to memory pool with a specified acceptance time **/
@@ -226,6 +263,33 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
                                 bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit = false,
                                 bool fRejectInsaneFee = false, bool ignoreFees = false);
 
+/** Outcome of one transaction of AcceptToMemoryPoolBatch */
+struct MemPoolAcceptResult
+{
+    bool fAccepted{false};
+    bool fMissingInputs{false};
+    CValidationState state;
+};
+
+/**
+ * (try to) add a batch of transactions to memory pool, with the same policy as AcceptToMemoryPool.
+ * Transactions are accepted parents first, whatever their order in vtx. Locks are taken once per
+ * dependency level rather than once per transaction, the proof and script checks of a level run
+ * on the script check threads, and the mempool is expired and trimmed once at the end.
+ * Results are in the order of vtx.
+ * vAcceptTime, if not empty, holds the acceptance time of each transaction (default: now).
+ * fConsensusVerified skips the Sapling proofs and the mandatory-flags script pass, for
+ * transactions known to satisfy the consensus rules of the next block (eg. just disconnected
+ * from the tip); scripts are still checked against the standard flags. The full checks are
+ * done if the tip changes while the batch is processed and the spent coins or script flags differ.
+ * fOverrideMempoolLimit leaves trimming the mempool to the caller.
+ * Holding cs_main and pool.cs across the call is allowed (reorgs), the checks then just don't
+ * run concurrently with the rest of the node.
+ */
+std::vector<MemPoolAcceptResult> AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& vtx, bool fLimitFree,
+                                                         const std::vector<int64_t>& vAcceptTime = {}, bool fConsensusVerified = false,
+                                                         bool fOverrideMempoolLimit = false);
+
 /** Convert CValidationState to a human-readable message for logging */
 std::string FormatStateMessage(const CValidationState &state);
 
@@ -254,6 +318,8 @@ CAmount GetShieldedTxMinFee(const CTransaction& tx);
  * instead of being performed inline.
  */
 bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck>* pvChecks = NULL);
+/** As above, with the height the inputs are spent at given, so that cs_main isn't needed. */
+bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view, int nSpendHeight, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck>* pvChecks = NULL);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight, bool fSkipInvalid = false);
@@ -324,7 +390,19 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
 
 /** Functions for validating blocks and updating the block tree */
 
+/**
+ * Whether the script checks of pindex can be skipped in ConnectBlock: it must be an ancestor of
+ * the assumed-valid block, which must be in the best header chain, and be buried deep enough
+ * (ASSUMEVALID_MIN_BURIAL_TIME) below the best header. UTXO accounting is never skipped.
+ */
+bool IsAssumedValid(const CBlockIndex* pindex, const CBlockIndex* pindexAssumeValid, const CBlockIndex* pindexBestHeaderIn);
+/** Same as above, using hashAssumeValid and pindexBestHeader. Requires cs_main. */
+bool IsAssumedValid(const CBlockIndex* pindex);
+
 /** Context-independent validity checks */
+/** Merkle root / malleability and block signature checks. Safe to call without cs_main, results are cached in the block. */
+bool CheckMerkleRoot(const CBlock& block, CValidationState& state);
+bool CheckBlockSig(const CBlock& block, CValidationState& state);
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckSig = true);
 bool CheckWork(const CBlock& block, const CBlockIndex* const pindexPrev);
 
@@ -337,15 +415,45 @@ bool TestBlockValidity(CValidationState& state, const CBlock& block, CBlockIndex
 
 bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex** ppindex = nullptr, CBlockIndex* pindexPrev = nullptr);
 
+/**
+ * Process a sequence of headers received during headers-first sync, adding them to the
+ * block index without their data. Headers must be continuous. Requires cs_main.
+ *
+ * @param[in]   headers    The headers, in chain order.
+ * @param[out]  state      Reason of the failure, if any.
+ * @param[out]  ppindex    If set, the index entry of the last header.
+ * @return True if all the headers are valid (or already known).
+ */
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, CBlockIndex** ppindex = nullptr);
+
 
 /** RAII wrapper for VerifyDB: Verify consistency of the block and coin databases */
 class CVerifyDB
 {
+private:
+    bool VerifyDBInternal(CCoinsView* coinsview, int chainHeight, int nCheckLevel, int nCheckDepth);
+
 public:
     CVerifyDB();
     ~CVerifyDB();
     bool VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth);
+    /** Verify levels 0-2 only (block data and undo data), without holding cs_main for the whole run.
+     *  Meant to be executed in background while the node is already running. */
+    bool VerifyBlocks(int nCheckLevel, int nCheckDepth);
+};
+
+/** Progress of the startup block verification (CVerifyDB), reported by getblockchaininfo */
+struct VerifyDBStatus
+{
+    enum State { NOT_STARTED, RUNNING, DONE, FAILED };
+    State state{NOT_STARTED};
+    bool fBackground{false};
+    int nCheckLevel{0};
+    int nCheckDepth{0};
+    int nVerified{0};
+    int nProgress{0};
 };
+VerifyDBStatus GetVerifyDBStatus();
 
 /** Replay blocks that aren't fully applied to the database. */
 bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
@@ -410,7 +518,7 @@ CBlockFileInfo* GetBlockFileInfo(size_t n);
 /** Dump the mempool to disk. */
 bool DumpMempool(const CTxMemPool& pool);
 
-/** Load the mempool from disk. */
+/** Load the mempool from disk, in batches. Every transaction goes through the full checks. */
 bool LoadMempool(CTxMemPool& pool);
 
 #endif // BITCOIN_MAIN_H
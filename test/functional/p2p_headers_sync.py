@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The TrumpCoin developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php.
+"""Test headers-first block sync, and the getblocks fallback for older peers.
+
+- node1 syncs the chain of node0 with getheaders/headers.
+- A peer at HEADERS_FIRST_VERSION is asked for headers when the sync starts, and
+  a block it announces with an inv is fetched after its header.
+- A peer at the previous protocol version gets getblocks, its announced blocks
+  are requested directly, and its getheaders is still answered with headers.
+"""
+
+from test_framework.blocktools import create_block, create_coinbase
+from test_framework.messages import CBlockHeader, CBlockLocator, CInv, MSG_BLOCK, msg_getheaders, msg_headers, msg_inv
+from test_framework.mininode import P2PDataStore, mininode_lock
+from test_framework.test_framework import TrumpCoinTestFramework
+from test_framework.util import assert_equal, connect_nodes, wait_until
+
+HEADERS_FIRST_VERSION = 72100
+OLD_PROTOCOL_VERSION = 72000
+
+
+class VersionedPeer(P2PDataStore):
+    """A data store peer that announces the given protocol version."""
+    def __init__(self, version):
+        super().__init__()
+        self.version = version
+
+    def peer_connect(self, *args, **kwargs):
+        create_conn = super().peer_connect(*args, **kwargs)
+        self.on_connection_send_msg.nVersion = self.version
+        return create_conn
+
+
+class HeadersSyncTest(TrumpCoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def setup_network(self):
+        self.setup_nodes()
+        # The nodes are connected later
+
+    def next_block(self, node):
+        tip = node.getblock(node.getbestblockhash())
+        block = create_block(int(tip["hash"], 16), create_coinbase(tip["height"] + 1), tip["time"] + 1)
+        block.solve()
+        return block
+
+    def run_test(self):
+        node0 = self.nodes[0]
+        node0.generate(150)
+
+        self.log.info("Sync node1 from node0 with headers first")
+        with self.nodes[1].assert_debug_log(["initial getheaders (0) to peer="]):
+            connect_nodes(self.nodes[1], 0)
+            self.sync_blocks()
+        assert_equal(self.nodes[1].getbestblockhash(), node0.getbestblockhash())
+
+        self.log.info("A peer at the current protocol version is synced with getheaders")
+        new_peer = node0.add_p2p_connection(VersionedPeer(HEADERS_FIRST_VERSION))
+        new_peer.wait_for_verack()
+        new_peer.wait_until(lambda: new_peer.message_count["getheaders"] > 0)
+        assert_equal(new_peer.message_count["getblocks"], 0)
+
+        block = self.next_block(node0)
+        with mininode_lock:
+            new_peer.block_store[block.sha256] = block
+            new_peer.last_message.pop("getheaders", None)
+        new_peer.send_message(msg_inv([CInv(MSG_BLOCK, block.sha256)]))
+        new_peer.wait_for_getheaders()
+        new_peer.send_message(msg_headers([CBlockHeader(block)]))
+        wait_until(lambda: node0.getbestblockhash() == block.hash)
+
+        self.log.info("A peer at the previous protocol version is synced with getblocks")
+        old_peer = node0.add_p2p_connection(VersionedPeer(OLD_PROTOCOL_VERSION))
+        old_peer.wait_for_verack()
+        old_peer.wait_until(lambda: old_peer.message_count["getblocks"] > 0)
+        assert_equal(old_peer.message_count["getheaders"], 0)
+
+        block = self.next_block(node0)
+        with mininode_lock:
+            old_peer.block_store[block.sha256] = block
+        old_peer.send_message(msg_inv([CInv(MSG_BLOCK, block.sha256)]))
+        old_peer.wait_for_getdata()
+        wait_until(lambda: node0.getbestblockhash() == block.hash)
+        assert_equal(old_peer.message_count["getheaders"], 0)
+
+        self.log.info("getheaders from a peer at the previous protocol version is answered with headers")
+        start_hash = node0.getblockhash(140)
+        getheaders = msg_getheaders()
+        getheaders.locator = CBlockLocator()
+        getheaders.locator.vHave = [int(start_hash, 16)]
+        old_peer.send_and_ping(getheaders)
+        with mininode_lock:
+            headers = old_peer.last_message["headers"].headers
+            assert_equal(len(headers), node0.getblockcount() - 140)
+            assert_equal(headers[-1].rehash(), int(node0.getbestblockhash(), 16))
+
+
+if __name__ == '__main__':
+    HeadersSyncTest().main()
@@ -55,11 +55,14 @@ class BlockchainTest(TrumpCoinTestFramework):
             'softforks',
             'upgrades',
             'verificationprogress',
+            'verifydb',
             'warnings',
         ]
         res = self.nodes[0].getblockchaininfo()
         # result should have these additional pruning keys if manual pruning is enabled
         assert_equal(sorted(res.keys()), sorted(keys))
+        assert_equal(res['verifydb']['status'], 'done')
+        assert_equal(res['verifydb']['background'], False)
 
     def _test_gettxoutsetinfo(self):
         node = self.nodes[0]
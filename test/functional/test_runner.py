@@ -131,6 +131,7 @@ BASE_SCRIPTS= [
     'wallet_autocombine.py',                    # ~ 49 sec
     'mining_v5_upgrade.py',                     # ~ 48 sec
     'p2p_mempool.py',                           # ~ 46 sec
+    'p2p_headers_sync.py',
     'rpc_named_arguments.py',                   # ~ 45 sec
     'feature_filelock.py',
     'feature_help.py',                          # ~ 30 sec
@@ -334,7 +334,7 @@ class PatriotnodeGovernanceBasicTest(TrumpCoinTier2TestFramework):
         # stop and remove everything
         self.stop_node(self.ownerTwoPos)
         ownerTwoDir = os.path.join(get_datadir_path(self.options.tmpdir, self.ownerTwoPos), "regtest")
-        for entry in ['chainstate', 'blocks', 'sporks', 'evodb', 'zerocoin', "mncache.dat", "budget.dat", "mnpayments.dat", "peers.dat"]:
+        for entry in ['chainstate', 'blocks', 'sporks', 'evodb', 'zerocoin', "mncache.dat", "budget", "mnpayments", "peers.dat"]:
             rem_path = os.path.join(ownerTwoDir, entry)
             shutil.rmtree(rem_path) if os.path.isdir(rem_path) else os.remove(rem_path)
 